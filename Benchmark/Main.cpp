@@ -0,0 +1,485 @@
+#include "Platform.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <lyra/lyra.hpp>
+
+#include "PEImage.h"
+#include "ExportEntry.h"
+#include "EmitPipeline.h"
+#include "RunStats.h"
+#include "Def File Generator.h"
+#include "Pragma File Generator.h"
+#include "Asm File Generator.h"
+#include "Obj File Generator.h"
+#include "Manifest Generator.h"
+#include "Lib File Generator.h"
+#include "Native Proxy Generator.h"
+
+/*
+	Times each stage of proxy generation on its own over DLLs written by the
+	fixture generator: header and export parsing, RVA classification, and
+	every emitter driven through a single emitter pipeline like Main does.
+
+	Each stage runs Iterations times with stats off and the fastest run is
+	reported, then once more with RunStats counting to get its allocations.
+	Stages marked (endl) write the way the generators did before output was
+	buffered, as the baseline for the emitters that follow them, and
+	resolve names (scan) is the name lookup parsing used before it went
+	linear. Given several DLLs the parse stages are summarised per export
+	so it shows how they grow with the export count.
+*/
+struct StageResult
+{
+	UINT64 Nanoseconds;
+	UINT64 Items;
+	UINT64 Bytes;
+	UINT64 Allocations;
+	UINT64 AllocatedBytes;
+};
+
+/* Fastest run of every stage measured on one DLL, kept for the scaling summary */
+struct DLLResult
+{
+	UINT64                               NumberOfExports;
+	UINT64                               NumberOfNames;
+	std::map< std::string, StageResult > Stages;
+};
+
+/* One run of a stage, sets Items and Bytes to what it got through */
+typedef std::function< bool( UINT64& Items, UINT64& Bytes ) > Stage;
+
+bool MeasureStage(
+	_In_  const Stage& Run,
+	_In_  UINT32       Iterations,
+	_Out_ StageResult& Result
+)
+{
+	Result = {};
+	Result.Nanoseconds = ~0ULL;
+
+	for ( UINT32 Iteration = 0; Iteration < Iterations; Iteration++ )
+	{
+		const auto Start = RunStats::Now();
+
+		if ( !Run( Result.Items, Result.Bytes ) )
+			return false;
+
+		Result.Nanoseconds = std::min( Result.Nanoseconds, RunStats::Now() - Start );
+	}
+
+	const auto Allocations    = RunStats::GetAllocations();
+	const auto AllocatedBytes = RunStats::GetAllocatedBytes();
+
+	RunStats::Enable();
+
+	const bool Succeeded = Run( Result.Items, Result.Bytes );
+
+	RunStats::Disable();
+
+	Result.Allocations    = RunStats::GetAllocations() - Allocations;
+	Result.AllocatedBytes = RunStats::GetAllocatedBytes() - AllocatedBytes;
+
+	return Succeeded;
+}
+
+void PrintStage(
+	_In_ const char*        Name,
+	_In_ const StageResult& Result
+)
+{
+	const double Seconds = Result.Nanoseconds / 1e9;
+
+	char Throughput[ 32 ] = "-";
+
+	/* Stages that only read what is already parsed have no bytes to show */
+	if ( Result.Bytes && Seconds > 0 )
+		snprintf( Throughput, sizeof( Throughput ), "%.1f", Result.Bytes / Seconds / ( 1024 * 1024 ) );
+
+	printf( "  %-22s %10.3f ms %14.0f exports/s %10s MB/s %10llu allocs %12llu bytes\n",
+		Name,
+		Result.Nanoseconds / 1e6,
+		Seconds > 0 ? Result.Items / Seconds : 0.0,
+		Throughput,
+		(unsigned long long)Result.Allocations,
+		(unsigned long long)Result.AllocatedBytes );
+}
+
+/* Runs one opened generator through a pipeline of its own, output bytes count towards MB/s */
+Stage MakeEmitterStage(
+	_In_ const ExportTable&                                            Entries,
+	_In_ std::function< std::shared_ptr< ExportGenerator >() >         Create,
+	_In_ SIZE_T                                                        NumberOfEntries,
+	_In_ bool                                                          IncludeData,
+	_In_ std::string                                                   ForwardTo = ""
+)
+{
+	return [ &Entries, Create, NumberOfEntries, IncludeData, ForwardTo ]( UINT64& Items, UINT64& Bytes )
+	{
+		auto Generator = Create();
+
+		/* A leftover output would be compared instead of written */
+		std::error_code Error;
+
+		std::filesystem::remove( Generator->GetPath(), Error );
+
+		if ( !Generator->Open() )
+			return false;
+
+		EmitPipeline Pipeline;
+
+		Pipeline.AddGenerator( "emit", Generator, Entries.GetMachine(), NumberOfEntries, IncludeData, ForwardTo );
+
+		if ( !Pipeline.Run( Entries, false, false ) )
+			return false;
+
+		Items = Entries.size();
+		Bytes = std::filesystem::file_size( Generator->GetPath(), Error );
+
+		return !Error;
+	};
+}
+
+/*
+	The DEF and ASM writers as they were before OutputBuffer, streaming into
+	an ofstream and flushing every line with std::endl. Only here to measure
+	the buffered emitters against.
+*/
+Stage MakeLineFlushedStage(
+	_In_ const ExportTable&           Entries,
+	_In_ const std::filesystem::path& Path,
+	_In_ bool                         Stubs
+)
+{
+	return [ &Entries, Path, Stubs ]( UINT64& Items, UINT64& Bytes )
+	{
+		std::ofstream File( Path );
+
+		if ( !File.is_open() )
+			return false;
+
+		const bool        IsAMD64   = Entries.GetMachine() == IMAGE_FILE_MACHINE_AMD64;
+		const std::string TableName = IsAMD64 ? "g_FunctionTable" : "_g_FunctionTable";
+
+		if ( Stubs )
+		{
+			if ( !IsAMD64 )
+				File << ".MODEL FLAT" << std::endl;
+
+			File << "EXTERN " << TableName << ( IsAMD64 ? ":QWORD" : ":DWORD" ) << std::endl;
+			File << std::endl << ".CODE" << std::endl;
+		}
+		else
+		{
+			File << "LIBRARY" << std::endl;
+			File << "EXPORTS" << std::endl;
+		}
+
+		for ( const auto Export : Entries )
+		{
+			if ( Export.IsData() )
+				continue;
+
+			const auto SymbolName = Export.HasName() ? std::string( Export.GetName() ) : "Ordinal_" + std::to_string( Export.GetOrdinal() );
+
+			if ( Stubs )
+			{
+				File << "ALIGN 8" << std::endl;
+				File << SymbolName << " PROC" << std::endl;
+				File << "\tjmp [" << TableName << " + " << Export.GetOrdinalIndex() << " * " << ( IsAMD64 ? 8 : 4 ) << "]" << std::endl;
+				File << SymbolName << " ENDP" << std::endl;
+				File << std::endl;
+			}
+			else if ( Export.HasName() )
+			{
+				File << "\t" << Export.GetName() << std::endl;
+			}
+			else
+			{
+				File << "\t" << SymbolName << " @ " << Export.GetOrdinal() << " NONAME" << std::endl;
+			}
+		}
+
+		if ( Stubs )
+			File << "END" << std::endl;
+
+		File.close();
+
+		std::error_code Error;
+
+		Items = Entries.size();
+		Bytes = std::filesystem::file_size( Path, Error );
+
+		return !File.fail() && !Error;
+	};
+}
+
+/*
+	Name resolution on its own, the way GetExportEntries does it and the
+	nested scan over AddressOfNameOrdinals it replaced. Both find the index
+	of the first name for every ordinal.
+*/
+Stage MakeResolveNamesStage(
+	_In_ const PEImage& Image,
+	_In_ bool           Scan
+)
+{
+	return [ &Image, Scan ]( UINT64& Items, UINT64& Bytes )
+	{
+		const auto ExportDirectoryEntry = Image.GetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXPORT );
+		const auto ImageExportDirectory = ExportDirectoryEntry ? Image.RvaToPointer<IMAGE_EXPORT_DIRECTORY>( ExportDirectoryEntry->VirtualAddress ) : NULL;
+
+		if ( ImageExportDirectory == NULL )
+			return false;
+
+		const auto NumberOfFunctions = ImageExportDirectory->NumberOfFunctions;
+		const auto NumberOfNames     = ImageExportDirectory->NumberOfNames;
+		const auto NameOrdinalArray  = Image.RvaToPointer<UINT16>( ImageExportDirectory->AddressOfNameOrdinals, NumberOfNames );
+
+		if ( NumberOfNames != 0 && NameOrdinalArray == NULL )
+			return false;
+
+		volatile UINT64 Named = 0;
+
+		if ( Scan )
+		{
+			for ( UINT32 OrdinalIndex = 0; OrdinalIndex < NumberOfFunctions; OrdinalIndex++ )
+			{
+				for ( UINT32 NameOrdinalIndex = 0; NameOrdinalIndex < NumberOfNames; NameOrdinalIndex++ )
+				{
+					if ( NameOrdinalArray[ NameOrdinalIndex ] == OrdinalIndex )
+					{
+						Named = Named + 1;
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			std::vector< UINT32 > NameIndexForOrdinal;
+
+			ExportEntry::GetNameIndexForOrdinals( NameOrdinalArray, NumberOfNames, NumberOfFunctions, NameIndexForOrdinal );
+
+			for ( UINT32 OrdinalIndex = 0; OrdinalIndex < NumberOfFunctions; OrdinalIndex++ )
+			{
+				if ( NameIndexForOrdinal[ OrdinalIndex ] != ExportEntry::NoName )
+					Named = Named + 1;
+			}
+		}
+
+		Items = NumberOfFunctions;
+		Bytes = 0;
+
+		return true;
+	};
+}
+
+bool BenchmarkDLL(
+	_In_  const std::filesystem::path& Path,
+	_In_  const std::filesystem::path& OutDir,
+	_In_  UINT32                       Iterations,
+	_In_  const std::string&           Filter,
+	_Out_ DLLResult&                   Measured
+)
+{
+	std::ifstream Stream( Path, std::ios::in | std::ios::binary );
+	std::string   Data( ( std::istreambuf_iterator< char >( Stream ) ), std::istreambuf_iterator< char >() );
+
+	if ( !Stream.good() && !Stream.eof() )
+	{
+		printf( "Failed to read %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	PEImage     Image;
+	ExportTable Entries;
+
+	if ( !Image.Open( Data.data(), Data.size() ) || !ExportEntry::GetExportEntries( Image, Entries, false, NULL ) )
+	{
+		printf( "Failed to parse %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	printf( "%s: %zu exports, %zu bytes\n", Path.filename().string().c_str(), Entries.size(), Data.size() );
+
+	Measured = {};
+	Measured.NumberOfExports = Entries.size();
+
+	for ( const auto Export : Entries )
+	{
+		if ( Export.HasName() )
+			Measured.NumberOfNames++;
+	}
+
+	std::vector< std::pair< const char*, Stage > > Stages;
+
+	/* The export walk classifies as it goes, classify is also timed alone so it can be told apart */
+	Stages.emplace_back( "parse", [ &Data ]( UINT64& Items, UINT64& Bytes )
+	{
+		PEImage     ParsedImage;
+		ExportTable ParsedEntries;
+
+		if ( !ParsedImage.Open( Data.data(), Data.size() ) || !ExportEntry::GetExportEntries( ParsedImage, ParsedEntries, false, NULL ) )
+			return false;
+
+		Items = ParsedEntries.size();
+		Bytes = Data.size();
+
+		return true;
+	} );
+
+	Stages.emplace_back( "resolve names", MakeResolveNamesStage( Image, false ) );
+	Stages.emplace_back( "resolve names (scan)", MakeResolveNamesStage( Image, true ) );
+
+	Stages.emplace_back( "classify", [ &Image, &Entries ]( UINT64& Items, UINT64& Bytes )
+	{
+		volatile UINT64 NumberOfData = 0;
+
+		for ( const auto Export : Entries )
+		{
+			if ( !Export.IsForwarded() && ExportEntry::IsRVAInDataSection( Image, Export.GetRVA() ) )
+				NumberOfData = NumberOfData + 1;
+		}
+
+		Items = Entries.size();
+		Bytes = 0;
+
+		return true;
+	} );
+
+	const auto Name = Path.stem().string();
+
+	Stages.emplace_back( "emit def", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< DefFileGenerator >( OutDir / ( Name + ".def" ) ); }, 0, false ) );
+	Stages.emplace_back( "emit def (endl)", MakeLineFlushedStage( Entries, OutDir / ( Name + "Flushed.def" ), false ) );
+	Stages.emplace_back( "emit forwarded def", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< DefFileGenerator >( OutDir / ( Name + "Forward.def" ) ); }, 0, true, Name + "_orig" ) );
+	Stages.emplace_back( "emit pragma", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< PragmaFileGenerator >( OutDir / ( Name + "Exports.h" ) ); }, 0, false ) );
+	Stages.emplace_back( "emit asm stubs", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< ASMFileGenerator >( OutDir / ( Name + "ASMStubs.asm" ) ); }, Entries.GetOrdinalCount(), false ) );
+	Stages.emplace_back( "emit asm stubs (endl)", MakeLineFlushedStage( Entries, OutDir / ( Name + "FlushedStubs.asm" ), true ) );
+	Stages.emplace_back( "emit lazy asm stubs", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< ASMFileGenerator >( OutDir / ( Name + "LazyStubs.asm" ), true ); }, Entries.GetOrdinalCount(), false ) );
+	Stages.emplace_back( "emit obj stubs", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< ObjFileGenerator >( OutDir / ( Name + "Stubs.obj" ) ); }, Entries.GetOrdinalCount(), false ) );
+	Stages.emplace_back( "emit manifest", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< ManifestGenerator >( OutDir / ( Name + "Exports.ndjson" ), Name, Entries ); }, Entries.size(), true ) );
+	Stages.emplace_back( "emit import library", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< ImportLibraryGenerator >( OutDir / ( Name + ".lib" ), Name ); }, Entries.size(), false ) );
+	Stages.emplace_back( "emit native proxy", MakeEmitterStage( Entries, [ & ]() { return std::make_shared< NativeProxyGenerator >( OutDir / ( Name + ".dll" ), Name ); }, Entries.GetOrdinalCount(), true, Name + "_orig" ) );
+
+	for ( const auto& Entry : Stages )
+	{
+		if ( Filter.size() && std::string( Entry.first ).find( Filter ) == std::string::npos )
+			continue;
+
+		StageResult Result;
+
+		if ( !MeasureStage( Entry.second, Iterations, Result ) )
+		{
+			printf( "  %-22s failed\n", Entry.first );
+			return false;
+		}
+
+		PrintStage( Entry.first, Result );
+
+		Measured.Stages[ Entry.first ] = Result;
+	}
+
+	return true;
+}
+
+/*
+	Nanoseconds per export of the parse stages for every DLL, smallest first.
+	A stage that stays linear keeps roughly the same figure all the way down.
+*/
+void PrintScaling(
+	_In_ std::vector< DLLResult > Results
+)
+{
+	const char* ScalingStages[] = { "parse", "resolve names", "resolve names (scan)" };
+
+	std::stable_sort( Results.begin(), Results.end(), []( const DLLResult& Left, const DLLResult& Right )
+	{
+		return Left.NumberOfExports < Right.NumberOfExports;
+	} );
+
+	printf( "\nns per export\n  %10s %10s", "exports", "names" );
+
+	for ( const auto StageName : ScalingStages )
+		printf( " %22s", StageName );
+
+	printf( "\n" );
+
+	for ( const auto& Result : Results )
+	{
+		printf( "  %10llu %10llu", (unsigned long long)Result.NumberOfExports, (unsigned long long)Result.NumberOfNames );
+
+		for ( const auto StageName : ScalingStages )
+		{
+			const auto Found = Result.Stages.find( StageName );
+
+			if ( Found == Result.Stages.end() || Result.NumberOfExports == 0 )
+				printf( " %22s", "-" );
+			else
+				printf( " %22.2f", (double)Found->second.Nanoseconds / Result.NumberOfExports );
+		}
+
+		printf( "\n" );
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	std::vector< std::string > DLLPaths;
+	std::string                OutDir;
+	std::string                Filter;
+	UINT32                     Iterations = 5;
+	bool                       ShowHelp   = false;
+
+	auto CommandLineParser = lyra::cli();
+
+	CommandLineParser.add_argument( lyra::help( ShowHelp ) );
+	CommandLineParser.add_argument( lyra::opt ( Iterations, "N" )       [ "-n" ] [ "--iterations" ] ( "Runs per stage, the fastest is reported" ) );
+	CommandLineParser.add_argument( lyra::opt ( OutDir,     "OUTDIR" )  [ "-o" ] [ "--out" ]        ( "Scratch directory for emitter output, defaults to a temp directory" ) );
+	CommandLineParser.add_argument( lyra::opt ( Filter,     "STAGE" )   [ "--stage" ]               ( "Only run stages whose name contains STAGE" ) );
+	CommandLineParser.add_argument( lyra::arg ( DLLPaths,   "DLLPATH" )                             ( "Fixture DLLs to measure" ).cardinality( 1, 0 ) );
+
+	auto ParsedArgs = CommandLineParser.parse( { argc, argv } );
+
+	if ( !ParsedArgs )
+	{
+		std::cerr << ParsedArgs.errorMessage() << std::endl;
+		return 1;
+	}
+
+	if ( ShowHelp )
+	{
+		std::cout << CommandLineParser << std::endl;
+		return 0;
+	}
+
+	std::error_code Error;
+
+	const std::filesystem::path ScratchDir = OutDir.size() ? std::filesystem::path( OutDir ) : std::filesystem::temp_directory_path( Error ) / "dpg-benchmark";
+
+	std::filesystem::create_directories( ScratchDir, Error );
+
+	if ( !std::filesystem::is_directory( ScratchDir ) )
+	{
+		printf( "Cant create scratch directory %s\n", ScratchDir.string().c_str() );
+		return 1;
+	}
+
+	Iterations = std::max< UINT32 >( Iterations, 1 );
+
+	std::vector< DLLResult > Results( DLLPaths.size() );
+
+	for ( SIZE_T Index = 0; Index < DLLPaths.size(); Index++ )
+	{
+		if ( !BenchmarkDLL( DLLPaths[ Index ], ScratchDir, Iterations, Filter, Results[ Index ] ) )
+			return 2;
+	}
+
+	if ( Results.size() > 1 )
+		PrintScaling( Results );
+
+	return 0;
+}
\ No newline at end of file
@@ -1,16 +1,41 @@
 #pragma once
 #include "Export Generator.h"
+#include <vector>
 
 class ASMFileGenerator : public ExportGenerator
 {
 public:
+	/*
+		With more than one shard each generator writes only the stubs whose
+		name hashes to ShardIndex. Shard 0 owns the lazy resolver thunk, the
+		others reference it as EXTERN, so MSBuild can assemble the files in
+		parallel and an added export touches one shard.
+	*/
 	ASMFileGenerator( 
-		_In_ std::filesystem::path Path
-	) :	ExportGenerator( Path ), FunctionTableName( "" ), MachinePointerSize( 0 )
+		_In_ std::filesystem::path Path,
+		_In_ bool                  LazyResolve    = false,
+		_In_ bool                  Instrument     = false,
+		_In_ SIZE_T                ShardIndex     = 0,
+		_In_ SIZE_T                NumberOfShards = 1
+	) :	ExportGenerator( Path ), FunctionTableName( "" ), CounterTableName( "" ), MachinePointerSize( 0 ), MachineType( 0 ), LazyResolve( LazyResolve ), Instrument( Instrument ), ShardIndex( ShardIndex ), NumberOfShards( NumberOfShards ? NumberOfShards : 1 )
 	{
 
 	}
 
+	/* Stable across runs and export order so shards only change when their own exports do */
+	static SIZE_T GetShardIndex(
+		_In_ const std::string& SymbolName,
+		_In_ SIZE_T             NumberOfShards
+	)
+	{
+		UINT32 Hash = 2166136261u;
+
+		for ( const auto Character : SymbolName )
+			Hash = ( Hash ^ (UINT8)Character ) * 16777619u;
+
+		return NumberOfShards > 1 ? Hash % NumberOfShards : 0;
+	}
+
 	virtual bool Begin(
 		_In_opt_ UINT16 MachineType,
 		_In_opt_ SIZE_T NumberOfEntries
@@ -19,36 +44,58 @@ public:
 		if ( NumberOfEntries == 0 )
 			return false;
 
+		File.Reserve( NumberOfEntries * 96 );
+
+		this->MachineType = MachineType;
+
+		/* g_FunctionTable lives in DLLMain.cpp where it can be cache line aligned */
 		switch ( MachineType )
 		{
 			case IMAGE_FILE_MACHINE_AMD64:
-				File << ".DATA" << std::endl;
-				File << "g_FunctionTable QWORD " << NumberOfEntries << " dup(?)" << std::endl;
-				File << "PUBLIC g_FunctionTable" << std::endl << std::endl;
 				FunctionTableName = "g_FunctionTable";
 				MachinePointerSize = sizeof( UINT64 );
+				File << "EXTERN g_FunctionTable:QWORD\n";
 				break;
 			case IMAGE_FILE_MACHINE_I386:
-				File << ".MODEL FLAT" << std::endl;
-				File << ".DATA" << std::endl;
-				File << "_g_FunctionTable DWORD " << NumberOfEntries << " dup(?)" << std::endl;
-				File << "PUBLIC _g_FunctionTable" << std::endl << std::endl;
 				FunctionTableName = "_g_FunctionTable"; // shitty calling convention decoration
 				MachinePointerSize = sizeof( UINT32 );
+				File << ".MODEL FLAT\n";
+				File << "EXTERN _g_FunctionTable:DWORD\n";
 				break;
 			default:
 				printf( "Unknown machine type %04X\n", MachineType );
 				return false;
 		}
 
-		File << ".CODE" << std::endl;
+		if ( this->LazyResolve && this->ShardIndex == 0 )
+			File << "EXTERN " << this->GetDecoration() << "ResolveExport:PROC\n";
+		else if ( this->LazyResolve )
+			File << "EXTERN LazyResolverThunk:PROC\n";
+
+		this->DeclareCounters();
+
+		/* .CODE is only paragraph aligned, wider stubs get a segment of their own that the linker merges into .text */
+		if ( GetStubAlignment( MachineType, this->Instrument ) > 16 )
+			File << "\nOPTION DOTNAME\n.text$ SEGMENT ALIGN(" << GetStubAlignment( MachineType, this->Instrument ) << ") 'CODE'\n";
+		else
+			File << "\n.CODE\n";
 
 		return true;
 	}
 
 	virtual bool End()
 	{
-		File << "END" << std::endl;
+		/* The thunk and lazy entries run once per export, keep them away from the hot stubs */
+		if ( this->LazyResolve && this->ShardIndex == 0 )
+			this->WriteLazyResolverThunk();
+
+		for ( const auto OrdinalIndex : this->LazyEntries )
+			this->WriteLazyEntry( OrdinalIndex );
+
+		if ( GetStubAlignment( this->MachineType, this->Instrument ) > 16 )
+			File << ".text$ ENDS\n";
+
+		File << "END\n";
 		return true;
 	}
 
@@ -60,17 +107,20 @@ public:
 		/*
 			Generate Stub Like
 
+			ALIGN StubAlignment
 			SymbolName PROC
 				jmp [FunctionTableName + FunctionIndex * MachinePointerSize]
 			SymbolName ENDP
-		
+
+			The jmp is 6 bytes, aligning to 8 packs eight stubs to a cache
+			line and never splits one across two.
 		*/
 
 		if ( Export.IsData() )
 		{
 			if ( Export.HasName() )
 			{
-				printf( "Warning export %s is data\n", Export.GetName().c_str() );
+				printf( "Warning export %s is data\n", Export.GetName().data() );
 			}
 			else
 			{
@@ -80,14 +130,42 @@ public:
 			return false;
 		}
 
-		File << SymbolName << " PROC" << std::endl;
-		File << "\tjmp [" << this->FunctionTableName << " + " << Export.GetOrdinalIndex() << " * " << this->MachinePointerSize << "]" << std::endl;
-		File << SymbolName << " ENDP" << std::endl;
-		File << std::endl;
+		if ( GetShardIndex( SymbolName, this->NumberOfShards ) != this->ShardIndex )
+			return true;
+
+		File << "ALIGN " << GetStubAlignment( this->MachineType, this->Instrument ) << "\n";
+		File << SymbolName << " PROC\n";
+
+		if ( this->Instrument )
+			this->AddCounterIncrement( Export.GetOrdinalIndex() );
+
+		File << "\tjmp [" << this->FunctionTableName << " + " << Export.GetOrdinalIndex() << " * " << this->MachinePointerSize << "]\n";
+		File << SymbolName << " ENDP\n";
+		File << "\n";
+
+		if ( this->LazyResolve )
+			this->LazyEntries.push_back( Export.GetOrdinalIndex() );
 
 		return true;
 	}
 
+	/*
+		Smallest power of two a whole stub fits in so none straddles a cache line.
+		The jmp is 6 bytes, the locked increment in front of it adds 8 on AMD64
+		and 16 on I386 where the 64 bit counter takes an add and an adc, 14 and
+		22 bytes in total.
+	*/
+	static SIZE_T GetStubAlignment(
+		_In_ UINT16 MachineType,
+		_In_ bool   Instrument
+	)
+	{
+		if ( !Instrument )
+			return 8;
+
+		return MachineType == IMAGE_FILE_MACHINE_I386 ? 32 : 16;
+	}
+
 	virtual bool AddForwardedExportEntry(
 		_In_ const ExportEntry& Export,
 		_In_ const std::string& DLLNameToForwardTo
@@ -107,6 +185,114 @@ public:
 	}
 
 protected:
-	std::string FunctionTableName;
-	SIZE_T      MachinePointerSize;
+	/* C symbols from DLLMain.cpp and the lazy entries it references carry an underscore on I386 */
+	const char* GetDecoration() const
+	{
+		return ( this->MachineType == IMAGE_FILE_MACHINE_I386 ) ? "_" : "";
+	}
+
+	/*
+		Lazy mode starts every table slot at a tiny per export entry that
+		hands its index to a shared thunk. The thunk preserves the argument
+		registers, calls ResolveExport in DLLMain.cpp which patches the slot,
+		then tail jumps to the target so later calls go straight through the
+		stub. Shard 0 owns the thunk, the others reference it as EXTERN.
+	*/
+	void WriteLazyResolverThunk()
+	{
+		if ( this->MachineType == IMAGE_FILE_MACHINE_AMD64 )
+		{
+			File << "LazyResolverThunk PROC FRAME\n";
+			File << "\tpush rcx\n\t.pushreg rcx\n";
+			File << "\tpush rdx\n\t.pushreg rdx\n";
+			File << "\tpush r8\n\t.pushreg r8\n";
+			File << "\tpush r9\n\t.pushreg r9\n";
+			File << "\tsub rsp, 68h\n\t.allocstack 68h\n";
+			File << "\tmovdqa [rsp + 20h], xmm0\n\t.savexmm128 xmm0, 20h\n";
+			File << "\tmovdqa [rsp + 30h], xmm1\n\t.savexmm128 xmm1, 30h\n";
+			File << "\tmovdqa [rsp + 40h], xmm2\n\t.savexmm128 xmm2, 40h\n";
+			File << "\tmovdqa [rsp + 50h], xmm3\n\t.savexmm128 xmm3, 50h\n";
+			File << "\t.endprolog\n";
+			File << "\tmov rcx, rax\n";
+			File << "\tcall ResolveExport\n";
+			File << "\tmovdqa xmm0, [rsp + 20h]\n";
+			File << "\tmovdqa xmm1, [rsp + 30h]\n";
+			File << "\tmovdqa xmm2, [rsp + 40h]\n";
+			File << "\tmovdqa xmm3, [rsp + 50h]\n";
+			File << "\tadd rsp, 68h\n";
+			File << "\tpop r9\n\tpop r8\n\tpop rdx\n\tpop rcx\n";
+			File << "\tjmp rax\n";
+			File << "LazyResolverThunk ENDP\n\n";
+		}
+		else
+		{
+			File << "LazyResolverThunk PROC\n";
+			File << "\tpush ecx\n";
+			File << "\tpush edx\n";
+			File << "\tpush dword ptr [esp + 8]\n";
+			File << "\tcall _ResolveExport\n";
+			File << "\tadd esp, 4\n";
+			File << "\tpop edx\n";
+			File << "\tpop ecx\n";
+			File << "\tadd esp, 4\n";
+			File << "\tjmp eax\n";
+			File << "LazyResolverThunk ENDP\n\n";
+		}
+	}
+
+	/*
+		Each export owns a 64 byte slot in g_CallCounters so threads hammering
+		different exports never share a cache line. A locked add is the whole
+		hot path cost, nothing is emitted when instrumentation is off.
+	*/
+	void DeclareCounters()
+	{
+		if ( !this->Instrument )
+			return;
+
+		CounterTableName = std::string( this->GetDecoration() ) + "g_CallCounters";
+
+		File << "EXTERN " << CounterTableName << ":BYTE\n";
+	}
+
+	void AddCounterIncrement(
+		_In_ UINT32 OrdinalIndex
+	)
+	{
+		if ( this->MachineType == IMAGE_FILE_MACHINE_AMD64 )
+		{
+			File << "\tlock inc qword ptr [" << CounterTableName << " + " << OrdinalIndex << " * 64]\n";
+		}
+		else
+		{
+			File << "\tlock add dword ptr [" << CounterTableName << " + " << OrdinalIndex << " * 64], 1\n";
+			File << "\tlock adc dword ptr [" << CounterTableName << " + " << OrdinalIndex << " * 64 + 4], 0\n";
+		}
+	}
+
+	/* Decorated like a C function so the table initializer in DLLMain.cpp can name it */
+	void WriteLazyEntry(
+		_In_ UINT32 OrdinalIndex
+	)
+	{
+		File << this->GetDecoration() << "LazyEntry_" << OrdinalIndex << " PROC\n";
+
+		if ( this->MachineType == IMAGE_FILE_MACHINE_AMD64 )
+			File << "\tmov eax, " << OrdinalIndex << "\n";
+		else
+			File << "\tpush " << OrdinalIndex << "\n";
+
+		File << "\tjmp LazyResolverThunk\n";
+		File << this->GetDecoration() << "LazyEntry_" << OrdinalIndex << " ENDP\n\n";
+	}
+
+	std::string           FunctionTableName;
+	std::string           CounterTableName;
+	SIZE_T                MachinePointerSize;
+	UINT16                MachineType;
+	bool                  LazyResolve;
+	bool                  Instrument;
+	SIZE_T                ShardIndex;
+	SIZE_T                NumberOfShards;
+	std::vector< UINT32 > LazyEntries;
 };
\ No newline at end of file
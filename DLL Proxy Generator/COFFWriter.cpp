@@ -0,0 +1,206 @@
+#include "COFFWriter.h"
+#include "PEWriter.h"
+#include <algorithm>
+#include <cstring>
+
+SIZE_T COFFWriter::AddSection(
+	_In_ const char* Name,
+	_In_ UINT32      Characteristics
+)
+{
+	Section NewSection = {};
+
+	/* Zero padded like in images, a name of exactly eight bytes has no terminator */
+	memcpy( NewSection.Name, Name, std::min< SIZE_T >( strlen( Name ), IMAGE_SIZEOF_SHORT_NAME ) );
+	NewSection.Characteristics = Characteristics;
+
+	this->Sections.push_back( std::move( NewSection ) );
+
+	const auto Index = this->Sections.size() - 1;
+
+	this->Sections[ Index ].Symbol = this->AddSymbolRecord( { Name, 0, (INT32)Index + 1, 0, IMAGE_SYM_CLASS_STATIC, Index, true } );
+
+	return Index;
+}
+
+UINT32 COFFWriter::AddSymbol(
+	_In_ std::string_view Name,
+	_In_ SIZE_T           Section,
+	_In_ UINT32           Offset,
+	_In_ bool             Function,
+	_In_ bool             External
+)
+{
+	const UINT16 Type         = Function ? ( IMAGE_SYM_DTYPE_FUNCTION << 4 ) : 0;
+	const BYTE   StorageClass = External ? IMAGE_SYM_CLASS_EXTERNAL : IMAGE_SYM_CLASS_STATIC;
+
+	return this->AddSymbolRecord( { std::string( Name ), Offset, (INT32)Section + 1, Type, StorageClass, 0, false } );
+}
+
+UINT32 COFFWriter::AddExternal(
+	_In_ std::string_view Name,
+	_In_ bool             Function
+)
+{
+	const UINT16 Type = Function ? ( IMAGE_SYM_DTYPE_FUNCTION << 4 ) : 0;
+
+	return this->AddSymbolRecord( { std::string( Name ), 0, IMAGE_SYM_UNDEFINED, Type, IMAGE_SYM_CLASS_EXTERNAL, 0, false } );
+}
+
+UINT32 COFFWriter::AddSectionReference(
+	_In_ std::string_view Name
+)
+{
+	return this->AddSymbolRecord( { std::string( Name ), 0, IMAGE_SYM_UNDEFINED, 0, IMAGE_SYM_CLASS_SECTION, 0, false } );
+}
+
+UINT32 COFFWriter::AddAbsolute(
+	_In_ std::string_view Name,
+	_In_ UINT32           Value
+)
+{
+	return this->AddSymbolRecord( { std::string( Name ), Value, IMAGE_SYM_ABSOLUTE, 0, IMAGE_SYM_CLASS_STATIC, 0, false } );
+}
+
+UINT32 COFFWriter::AddSymbolRecord(
+	_In_ Symbol&& Record
+)
+{
+	const auto Index = this->NumberOfSymbolRecords;
+
+	this->NumberOfSymbolRecords += Record.IsSectionSymbol ? 2 : 1;
+	this->Symbols.push_back( std::move( Record ) );
+
+	return Index;
+}
+
+bool COFFWriter::Build(
+	_Inout_ std::string& Object
+)
+{
+	std::vector< BYTE > Data;
+	std::vector< BYTE > Strings;
+
+	/* The string table size prefix counts itself */
+	PEWriter::AppendU32( Strings, 0 );
+
+	const auto SectionHeaders = sizeof( IMAGE_FILE_HEADER ) + this->Sections.size() * sizeof( IMAGE_SECTION_HEADER );
+
+	Data.resize( SectionHeaders, 0 );
+
+	for ( SIZE_T Index = 0; Index < this->Sections.size(); Index++ )
+	{
+		const auto&          Entry  = this->Sections[ Index ];
+		IMAGE_SECTION_HEADER Header = {};
+
+		memcpy( Header.Name, Entry.Name, sizeof( Header.Name ) );
+		Header.Characteristics = Entry.Characteristics;
+
+		if ( Entry.Characteristics & IMAGE_SCN_CNT_UNINITIALIZED_DATA )
+		{
+			Header.SizeOfRawData = Entry.UninitializedSize;
+		}
+		else if ( Entry.Data.size() )
+		{
+			Header.SizeOfRawData    = (DWORD)Entry.Data.size();
+			Header.PointerToRawData = (DWORD)Data.size();
+
+			PEWriter::Append( Data, Entry.Data.data(), Entry.Data.size() );
+		}
+
+		if ( Entry.Relocations.size() )
+		{
+			Header.PointerToRelocations = (DWORD)Data.size();
+
+			/* Past 0xFFFF the real count moves into a leading dummy relocation */
+			if ( Entry.Relocations.size() >= 0xFFFF )
+			{
+				Header.NumberOfRelocations  = 0xFFFF;
+				Header.Characteristics     |= IMAGE_SCN_LNK_NRELOC_OVFL;
+
+				PEWriter::AppendU32( Data, (UINT32)Entry.Relocations.size() + 1 );
+				PEWriter::AppendU32( Data, 0 );
+				PEWriter::AppendU16( Data, 0 );
+			}
+			else
+			{
+				Header.NumberOfRelocations = (WORD)Entry.Relocations.size();
+			}
+
+			for ( const auto& Fixup : Entry.Relocations )
+			{
+				const SIZE_T Width = ( this->Machine == IMAGE_FILE_MACHINE_AMD64 && Fixup.Type == IMAGE_REL_AMD64_ADDR64 ) ? sizeof( UINT64 ) : sizeof( UINT32 );
+
+				if ( Fixup.Offset + Width > Entry.Data.size() )
+				{
+					printf( "Relocation outside of section data\n" );
+					return false;
+				}
+
+				PEWriter::AppendU32( Data, Fixup.Offset );
+				PEWriter::AppendU32( Data, Fixup.Symbol );
+				PEWriter::AppendU16( Data, Fixup.Type );
+			}
+		}
+
+		memcpy( Data.data() + sizeof( IMAGE_FILE_HEADER ) + Index * sizeof( Header ), &Header, sizeof( Header ) );
+	}
+
+	const auto SymbolTable = (UINT32)Data.size();
+
+	for ( const auto& Entry : this->Symbols )
+	{
+		BYTE ShortName[ IMAGE_SIZEOF_SHORT_NAME ] = {};
+
+		/* Longer names are an offset into the string table behind four zero bytes */
+		if ( Entry.Name.size() > sizeof( ShortName ) )
+		{
+			const UINT32 Offset = (UINT32)Strings.size();
+
+			memcpy( ShortName + sizeof( UINT32 ), &Offset, sizeof( Offset ) );
+			PEWriter::AppendString( Strings, Entry.Name );
+		}
+		else
+		{
+			memcpy( ShortName, Entry.Name.data(), Entry.Name.size() );
+		}
+
+		PEWriter::Append( Data, ShortName, sizeof( ShortName ) );
+		PEWriter::AppendU32( Data, Entry.Value );
+		PEWriter::AppendU16( Data, (UINT16)Entry.SectionNumber );
+		PEWriter::AppendU16( Data, Entry.Type );
+		Data.push_back( Entry.StorageClass );
+		Data.push_back( Entry.IsSectionSymbol ? 1 : 0 );
+
+		if ( Entry.IsSectionSymbol )
+		{
+			const auto& Described = this->Sections[ Entry.Section ];
+			const auto  Length    = ( Described.Characteristics & IMAGE_SCN_CNT_UNINITIALIZED_DATA ) ? Described.UninitializedSize : (UINT32)Described.Data.size();
+
+			PEWriter::AppendU32( Data, Length );
+			PEWriter::AppendU16( Data, (UINT16)std::min< SIZE_T >( Described.Relocations.size(), 0xFFFF ) );
+			PEWriter::AppendU16( Data, 0 );
+			PEWriter::AppendU32( Data, 0 );
+			PEWriter::AppendU16( Data, 0 );
+			Data.resize( Data.size() + 4, 0 );
+		}
+	}
+
+	const UINT32 StringsSize = (UINT32)Strings.size();
+
+	memcpy( Strings.data(), &StringsSize, sizeof( StringsSize ) );
+	PEWriter::Append( Data, Strings.data(), Strings.size() );
+
+	IMAGE_FILE_HEADER FileHeader = {};
+
+	FileHeader.Machine              = this->Machine;
+	FileHeader.NumberOfSections     = (WORD)this->Sections.size();
+	FileHeader.PointerToSymbolTable = SymbolTable;
+	FileHeader.NumberOfSymbols      = this->NumberOfSymbolRecords;
+
+	memcpy( Data.data(), &FileHeader, sizeof( FileHeader ) );
+
+	Object.append( (const char*)Data.data(), Data.size() );
+
+	return true;
+}
\ No newline at end of file
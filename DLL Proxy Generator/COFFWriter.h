@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	Builds a relocatable COFF object in memory, what ml/ml64 would have
+	produced from the same code.
+
+	Callers fill sections with bytes, define or import symbols and record
+	relocations against them. Addends live in the patched field itself like
+	MSVC objects, the linker adds the symbol address on top. Every section
+	gets the usual static section symbol so data can point into it.
+*/
+class COFFWriter
+{
+public:
+	COFFWriter(
+		_In_ UINT16 Machine
+	) : Machine( Machine ), NumberOfSymbolRecords( 0 )
+	{
+
+	}
+
+	UINT16 GetMachine() const
+	{
+		return this->Machine;
+	}
+
+	SIZE_T AddSection(
+		_In_ const char* Name,
+		_In_ UINT32      Characteristics
+	);
+
+	std::vector< BYTE >& GetData(
+		_In_ SIZE_T Section
+	)
+	{
+		return this->Sections[ Section ].Data;
+	}
+
+	UINT32 GetSize(
+		_In_ SIZE_T Section
+	) const
+	{
+		return (UINT32)this->Sections[ Section ].Data.size();
+	}
+
+	/* Zero filled space with no bytes in the file, only for uninitialized data sections */
+	void SetUninitializedSize(
+		_In_ SIZE_T Section,
+		_In_ UINT32 Size
+	)
+	{
+		this->Sections[ Section ].UninitializedSize = Size;
+	}
+
+	/* Index of the static symbol naming the start of Section */
+	UINT32 GetSectionSymbol(
+		_In_ SIZE_T Section
+	) const
+	{
+		return this->Sections[ Section ].Symbol;
+	}
+
+	/* Defines Name at Offset in Section, visible to the linker unless External is false */
+	UINT32 AddSymbol(
+		_In_ std::string_view Name,
+		_In_ SIZE_T           Section,
+		_In_ UINT32           Offset,
+		_In_ bool             Function,
+		_In_ bool             External = true
+	);
+
+	/* A symbol some other object defines */
+	UINT32 AddExternal(
+		_In_ std::string_view Name,
+		_In_ bool             Function
+	);
+
+	/* The start of a grouped section other objects contribute to, like .idata$4 */
+	UINT32 AddSectionReference(
+		_In_ std::string_view Name
+	);
+
+	/* Absolute value symbols, like @feat.00 */
+	UINT32 AddAbsolute(
+		_In_ std::string_view Name,
+		_In_ UINT32           Value
+	);
+
+	void AddRelocation(
+		_In_ SIZE_T Section,
+		_In_ UINT32 Offset,
+		_In_ UINT32 Symbol,
+		_In_ UINT16 Type
+	)
+	{
+		this->Sections[ Section ].Relocations.push_back( { Offset, Symbol, Type } );
+	}
+
+	/* Appends the finished object to Object */
+	bool Build(
+		_Inout_ std::string& Object
+	);
+
+private:
+	struct Relocation
+	{
+		UINT32 Offset;
+		UINT32 Symbol;
+		UINT16 Type;
+	};
+
+	struct Section
+	{
+		char                      Name[ IMAGE_SIZEOF_SHORT_NAME ];
+		UINT32                    Characteristics;
+		std::vector< BYTE >       Data;
+		UINT32                    UninitializedSize;
+		UINT32                    Symbol;
+		std::vector< Relocation > Relocations;
+	};
+
+	struct Symbol
+	{
+		std::string Name;
+		UINT32      Value;
+		INT32       SectionNumber;
+		UINT16      Type;
+		BYTE        StorageClass;
+		SIZE_T      Section; // Section symbols carry an aux record describing it
+		bool        IsSectionSymbol;
+	};
+
+	UINT32 AddSymbolRecord(
+		_In_ Symbol&& Record
+	);
+
+	UINT16                 Machine;
+	UINT32                 NumberOfSymbolRecords;
+	std::vector< Section > Sections;
+	std::vector< Symbol >  Symbols;
+};
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
+#include "Platform.h"
+#include <string>
 #include <filesystem>
-#include <fstream>
+#include <string_view>
+#include "OutputBuffer.h"
 
 class DLLMainGenerator
 {
@@ -14,57 +17,62 @@ public:
 
 	bool Open()
 	{
-		File.open( Path.c_str() );
+		return File.Open( Path );
+	}
 
-		if ( !File.is_open() )
-		{
-			printf( "Failed to open file", Path.string().c_str() );
-			return false;
-		}
+	const std::filesystem::path& GetPath() const
+	{
+		return Path;
+	}
 
-		return true;
+	void AddInclude( std::string_view Text )
+	{
+		Includes << Text;
 	}
 
-	void AddInclude( const std::string Text )
+	void AddBody( std::string_view Text )
 	{
-		Includes += Text;
+		BodyText << Text;
 	}
 
-	void AddBody( const std::string Text )
+	void AddProcessAttach( std::string_view Text )
 	{
-		BodyText += Text;
+		ProcessAttachText << Text;
 	}
 
-	void AddProcessAttach( const std::string Text )
+	void AddProcessDetach( std::string_view Text )
 	{
-		ProcessAttachText += Text;
+		ProcessDetachText << Text;
 	}
 
-	void AddProcessDetach( const std::string Text )
+	/* For bulk output, format straight into the body instead of building temporaries for AddBody */
+	OutputBuffer& GetBody()
 	{
-		ProcessDetachText += Text;
+		return BodyText;
 	}
 
-	void Write()
+	bool Write()
 	{
-		File << "#include <Windows.h>" << std::endl;
+		File << "#include <Windows.h>\n";
 
-		File << BodyText << std::endl;
+		File << BodyText << "\n";
 
-		File << "DWORD WINAPI ProcessAttach(\n\t_In_ LPVOID Parameter\n)\n{\n\tif ( Parameter == NULL )\n\t\treturn FALSE;\n" << std::endl;
-		File << ProcessAttachText << "\n\treturn TRUE;\n}" << std::endl;
+		File << "DWORD WINAPI ProcessAttach(\n\t_In_ LPVOID Parameter\n)\n{\n\tif ( Parameter == NULL )\n\t\treturn FALSE;\n\n";
+		File << ProcessAttachText << "\n\treturn TRUE;\n}\n";
 
-		File << "DWORD WINAPI ProcessDetach(\n\t_In_ LPVOID Parameter\n)\n{\n\tif ( Parameter == NULL )\n\t\treturn FALSE;\n" << std::endl;
-		File << ProcessDetachText << "\n\treturn TRUE;\n}" << std::endl;
+		File << "DWORD WINAPI ProcessDetach(\n\t_In_ LPVOID Parameter\n)\n{\n\tif ( Parameter == NULL )\n\t\treturn FALSE;\n\n";
+		File << ProcessDetachText << "\n\treturn TRUE;\n}\n";
 
 		File << "BOOL APIENTRY DllMain( \n\t_In_ HINSTANCE Instance,\n\t_In_ DWORD     Reason,\n\t_In_ LPVOID    Reserved \n)\n{\n\tswitch ( Reason )\n\t{\n\t\tcase DLL_PROCESS_ATTACH:\n\t\t\tDisableThreadLibraryCalls( Instance ); // Disable DLL_THREAD_ATTACH and DLL_THREAD_DETACH notifications\n\t\t\treturn ProcessAttach( Instance );\n\t\tcase DLL_PROCESS_DETACH:\n\t\t\treturn ProcessDetach( Instance );\n\t}\n\n\treturn TRUE;\n}\n";
+
+		return File.Close();
 	}
 
 protected:
 	std::filesystem::path Path;
-	std::ofstream File;
-	std::string Includes;
-	std::string BodyText;
-	std::string ProcessAttachText;
-	std::string ProcessDetachText;
+	OutputBuffer File;
+	OutputBuffer Includes;
+	OutputBuffer BodyText;
+	OutputBuffer ProcessAttachText;
+	OutputBuffer ProcessDetachText;
 };
\ No newline at end of file
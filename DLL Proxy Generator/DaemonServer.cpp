@@ -0,0 +1,341 @@
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+/* Winsock 2 has to come before Windows.h drags in the old winsock.h */
+#include <winsock2.h>
+#include <afunix.h>
+#endif
+
+#include "DaemonServer.h"
+#include "RunStats.h"
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#if defined( _WIN32 )
+#define SHUT_RD   SD_RECEIVE
+#define SHUT_RDWR SD_BOTH
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+DaemonServer::DaemonServer(
+	_In_ SIZE_T NumberOfThreads
+) : Pool( NumberOfThreads ), ListenSocket( NoSocket ), Stopping( false ), Queued( 0 ), Running( 0 ), Requests( 0 ), Failed( 0 ), NextLatency( 0 )
+{
+#if defined( _WIN32 )
+	WSADATA Data;
+	WSAStartup( MAKEWORD( 2, 2 ), &Data );
+#endif
+}
+
+DaemonServer::~DaemonServer()
+{
+	CloseSocket( this->ListenSocket );
+
+#if defined( _WIN32 )
+	WSACleanup();
+#endif
+}
+
+bool DaemonServer::Listen(
+	_In_ const std::filesystem::path& SocketPath
+)
+{
+	sockaddr_un Address = {};
+
+	const auto PathText = SocketPath.string();
+
+	if ( PathText.size() >= sizeof( Address.sun_path ) )
+	{
+		printf( "Socket path too long %s\n", PathText.c_str() );
+		return false;
+	}
+
+	Address.sun_family = AF_UNIX;
+	memcpy( Address.sun_path, PathText.c_str(), PathText.size() + 1 );
+
+	/* Connecting tells a running daemon apart from a socket file left behind */
+	const auto Probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( Probe != NoSocket )
+	{
+		const bool Answered = connect( Probe, (const sockaddr*)&Address, sizeof( Address ) ) == 0;
+
+		CloseSocket( Probe );
+
+		if ( Answered )
+		{
+			printf( "Another daemon is already listening on %s\n", PathText.c_str() );
+			return false;
+		}
+	}
+
+	std::error_code Error;
+
+#if !defined( _WIN32 )
+	/* Never delete something that isnt a socket because the path was mistyped */
+	if ( std::filesystem::exists( SocketPath, Error ) && !std::filesystem::is_socket( SocketPath, Error ) )
+	{
+		printf( "%s exists and is not a socket\n", PathText.c_str() );
+		return false;
+	}
+#endif
+
+	std::filesystem::remove( SocketPath, Error );
+
+	this->ListenSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( this->ListenSocket == NoSocket || bind( this->ListenSocket, (const sockaddr*)&Address, sizeof( Address ) ) != 0 || listen( this->ListenSocket, SOMAXCONN ) != 0 )
+	{
+		printf( "Failed to listen on %s\n", PathText.c_str() );
+		return false;
+	}
+
+	this->SocketPath = SocketPath;
+
+	return true;
+}
+
+void DaemonServer::Run(
+	_In_ Handler OnRequest
+)
+{
+	while ( !this->Stopping )
+	{
+		const auto Client = accept( this->ListenSocket, NULL, NULL );
+
+		if ( Client == NoSocket )
+		{
+			/* Out of descriptors and the like, back off instead of spinning */
+			if ( !this->Stopping )
+				std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+			continue;
+		}
+
+		{
+			std::lock_guard< std::mutex > Guard( this->ConnectionLock );
+
+			if ( this->Stopping )
+			{
+				CloseSocket( Client );
+				break;
+			}
+
+			this->Connections.insert( Client );
+		}
+
+		std::thread( &DaemonServer::ServeConnection, this, Client, std::cref( OnRequest ) ).detach();
+	}
+
+	/* Stop shut the read side of every connection, they finish their current request and leave */
+	{
+		std::unique_lock< std::mutex > Guard( this->ConnectionLock );
+
+		this->ConnectionsClosed.wait( Guard, [ this ]() { return this->Connections.empty(); } );
+	}
+
+	std::error_code Error;
+	std::filesystem::remove( this->SocketPath, Error );
+}
+
+void DaemonServer::Stop()
+{
+	std::lock_guard< std::mutex > Guard( this->ConnectionLock );
+
+	this->Stopping = true;
+
+#if defined( _WIN32 )
+	/* Winsock only wakes a blocked accept by closing the socket */
+	CloseSocket( this->ListenSocket );
+	this->ListenSocket = NoSocket;
+#else
+	shutdown( this->ListenSocket, SHUT_RDWR );
+#endif
+
+	for ( const auto Client : this->Connections )
+		shutdown( Client, SHUT_RD );
+}
+
+void DaemonServer::ServeConnection(
+	_In_ Socket         Client,
+	_In_ const Handler& OnRequest
+)
+{
+	std::string Buffer;
+	char        Chunk[ 4096 ];
+	bool        Open = true;
+
+	while ( Open )
+	{
+		const auto Received = recv( Client, Chunk, sizeof( Chunk ), 0 );
+
+		if ( Received <= 0 )
+			break;
+
+		Buffer.append( Chunk, (SIZE_T)Received );
+
+		SIZE_T LineStart = 0;
+		SIZE_T LineEnd;
+
+		while ( Open && ( LineEnd = Buffer.find( '\n', LineStart ) ) != std::string::npos )
+		{
+			auto Request = Buffer.substr( LineStart, LineEnd - LineStart );
+
+			LineStart = LineEnd + 1;
+
+			if ( Request.size() && Request.back() == '\r' )
+				Request.pop_back();
+
+			if ( Request.empty() )
+				continue;
+
+			const auto Start = RunStats::Now();
+
+			std::string          Response;
+			bool                 Success = false;
+			std::promise< void > Done;
+			auto                 Finished = Done.get_future();
+
+			/* Latency includes the time spent queued, that is what the client waits for */
+			this->Queued++;
+
+			this->Pool.Submit( [ this, &OnRequest, &Request, &Response, &Success, &Done ]()
+			{
+				this->Queued--;
+				this->Running++;
+
+				Success = OnRequest( Request, Response );
+
+				this->Running--;
+
+				Done.set_value();
+			} );
+
+			Finished.wait();
+
+			this->Requests++;
+			this->Failed += !Success;
+			this->RecordLatency( RunStats::Now() - Start );
+
+			if ( Response.empty() || Response.back() != '\n' )
+				Response += '\n';
+
+			Open = SendAll( Client, Response );
+		}
+
+		Buffer.erase( 0, LineStart );
+
+		if ( Buffer.size() > MaximumRequest )
+		{
+			SendAll( Client, "ERROR request too long\n" );
+			break;
+		}
+	}
+
+	/* Notified under the lock, once Run sees the last connection gone nothing here touches the server again */
+	std::lock_guard< std::mutex > Guard( this->ConnectionLock );
+
+	this->Connections.erase( Client );
+	CloseSocket( Client );
+
+	this->ConnectionsClosed.notify_all();
+}
+
+void DaemonServer::RecordLatency(
+	_In_ UINT64 Nanoseconds
+)
+{
+	std::lock_guard< std::mutex > Guard( this->LatencyLock );
+
+	if ( this->Latencies.size() < LatencySamples )
+	{
+		this->Latencies.push_back( Nanoseconds );
+	}
+	else
+	{
+		this->Latencies[ this->NextLatency ] = Nanoseconds;
+		this->NextLatency                    = ( this->NextLatency + 1 ) % LatencySamples;
+	}
+}
+
+void DaemonServer::AppendCounters(
+	_Inout_ std::string& Response
+)
+{
+	std::vector< UINT64 > Sorted;
+	SIZE_T                NumberOfConnections;
+
+	{
+		std::lock_guard< std::mutex > Guard( this->LatencyLock );
+		Sorted = this->Latencies;
+	}
+
+	{
+		std::lock_guard< std::mutex > Guard( this->ConnectionLock );
+		NumberOfConnections = this->Connections.size();
+	}
+
+	std::sort( Sorted.begin(), Sorted.end() );
+
+	const auto Percentile = [ &Sorted ]( double Fraction )
+	{
+		if ( Sorted.empty() )
+			return 0.0;
+
+		return Sorted[ std::min( (SIZE_T)( Fraction * Sorted.size() ), Sorted.size() - 1 ) ] / 1e6;
+	};
+
+	char Line[ 512 ];
+
+	snprintf( Line, sizeof( Line ),
+		"requests %llu\nfailed %llu\nconnections %zu\nqueue_depth %zu\nrunning %zu\nworkers %zu\n"
+		"latency_p50_ms %.3f\nlatency_p90_ms %.3f\nlatency_p99_ms %.3f\nlatency_max_ms %.3f\n",
+		(unsigned long long)this->Requests, (unsigned long long)this->Failed, NumberOfConnections, (SIZE_T)this->Queued, (SIZE_T)this->Running, this->Pool.GetThreadCount(),
+		Percentile( 0.50 ), Percentile( 0.90 ), Percentile( 0.99 ), Percentile( 1.0 ) );
+
+	Response += Line;
+}
+
+bool DaemonServer::SendAll(
+	_In_ Socket             Client,
+	_In_ const std::string& Text
+)
+{
+	SIZE_T Offset = 0;
+
+	while ( Offset < Text.size() )
+	{
+		const auto Sent = send( Client, Text.data() + Offset, (int)std::min< SIZE_T >( Text.size() - Offset, 0x10000000 ), MSG_NOSIGNAL );
+
+		if ( Sent <= 0 )
+			return false;
+
+		Offset += (SIZE_T)Sent;
+	}
+
+	return true;
+}
+
+void DaemonServer::CloseSocket(
+	_In_ Socket Handle
+)
+{
+	if ( Handle == NoSocket )
+		return;
+
+#if defined( _WIN32 )
+	closesocket( Handle );
+#else
+	close( Handle );
+#endif
+}
\ No newline at end of file
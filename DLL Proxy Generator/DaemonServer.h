@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Platform.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+	Line based request server on a Unix domain socket. Every connection gets
+	a thread that reads its requests, each request then waits for a worker
+	in the pool so a burst of clients queues up instead of oversubscribing
+	the machine. Responses go back on the connection in request order.
+*/
+class DaemonServer
+{
+public:
+	/* Fills Response with the complete reply, false counts the request as failed */
+	typedef std::function< bool( const std::string& Request, std::string& Response ) > Handler;
+
+	/* Latency percentiles cover this many of the most recent requests */
+	static const SIZE_T LatencySamples = 4096;
+
+	/* Longer request lines close the connection */
+	static const SIZE_T MaximumRequest = 64 * 1024;
+
+	DaemonServer(
+		_In_ SIZE_T NumberOfThreads
+	);
+
+	~DaemonServer();
+
+	DaemonServer( const DaemonServer& ) = delete;
+	DaemonServer& operator=( const DaemonServer& ) = delete;
+
+	/* Refuses a socket another daemon still answers on, a stale one left by a crash is replaced */
+	bool Listen(
+		_In_ const std::filesystem::path& SocketPath
+	);
+
+	/* Serves until Stop, then waits for open connections to finish their requests */
+	void Run(
+		_In_ Handler OnRequest
+	);
+
+	/* Safe to call from inside a handler, the reply to that request still goes out */
+	void Stop();
+
+	/* Appends "name value" lines for requests served, queue depth and latency percentiles */
+	void AppendCounters(
+		_Inout_ std::string& Response
+	);
+
+private:
+#if defined( _WIN32 )
+	typedef UINT_PTR Socket;
+#else
+	typedef int Socket;
+#endif
+
+	static const Socket NoSocket = (Socket)-1;
+
+	void ServeConnection(
+		_In_ Socket         Client,
+		_In_ const Handler& OnRequest
+	);
+
+	void RecordLatency(
+		_In_ UINT64 Nanoseconds
+	);
+
+	static bool SendAll(
+		_In_ Socket             Client,
+		_In_ const std::string& Text
+	);
+
+	static void CloseSocket(
+		_In_ Socket Handle
+	);
+
+	ThreadPool              Pool;
+	std::filesystem::path   SocketPath;
+	Socket                  ListenSocket;
+	std::atomic< bool >     Stopping;
+	std::atomic< SIZE_T >   Queued;
+	std::atomic< SIZE_T >   Running;
+	std::atomic< UINT64 >   Requests;
+	std::atomic< UINT64 >   Failed;
+	std::mutex              ConnectionLock;
+	std::condition_variable ConnectionsClosed;
+	std::set< Socket >      Connections;
+	std::mutex              LatencyLock;
+	std::vector< UINT64 >   Latencies;
+	SIZE_T                  NextLatency;
+};
\ No newline at end of file
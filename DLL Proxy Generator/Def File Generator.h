@@ -17,8 +17,8 @@ public:
 		_In_opt_ SIZE_T NumberOfEntries = 0
 	)
 	{
-		File << "LIBRARY" << std::endl;
-		File << "EXPORTS" << std::endl;
+		File << "LIBRARY\n";
+		File << "EXPORTS\n";
 		return true;
 	}
 
@@ -34,11 +34,11 @@ public:
 	{
 		if ( Export.HasName() )
 		{
-			File << "\t" << Export.GetName() << std::endl;
+			File << "\t" << Export.GetName() << "\n";
 		}
 		else
 		{
-			File << "\t" << SymbolName << " @ " << Export.GetOrdinal() << " NONAME" << std::endl;
+			File << "\t" << SymbolName << " @ " << Export.GetOrdinal() << " NONAME\n";
 		}
 
 		return true;
@@ -81,7 +81,7 @@ public:
 			}
 		}
 
-		File << std::endl;
+		File << "\n";
 
 		return true;
 	}
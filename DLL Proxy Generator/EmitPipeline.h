@@ -0,0 +1,183 @@
+#pragma once
+
+#include "Platform.h"
+#include "ExportEntry.h"
+#include "Export Generator.h"
+#include "RunStats.h"
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	Fans one walk over an export table out to every registered output. The
+	walk classifies each export and works out its stub symbol once, then every
+	emitter consumes the shared records on its own thread into its own buffer,
+	so adding an output costs wall clock only if it is the slowest one.
+*/
+class EmitPipeline
+{
+public:
+	struct Record
+	{
+		UINT32      Index;
+		ExportEntry Export;
+		std::string SymbolName;
+	};
+
+	typedef std::function< bool( const std::vector< Record >& ) > Emitter;
+
+	/* Emitters see records in ordinal order, they must only touch their own output. Name is the --timings phase */
+	void AddEmitter(
+		_In_ const char* Name,
+		_In_ Emitter     Emit
+	)
+	{
+		this->Emitters.push_back( { Name, std::move( Emit ) } );
+	}
+
+	/*
+		Drives an opened generator through Begin, one Add per record and End,
+		then writes it. Data exports are skipped unless IncludeData is set. A
+		non empty ForwardTo feeds AddForwardedExportEntry instead, and Source
+		lets a generator read the same rows from a rewritten copy of the table.
+	*/
+	void AddGenerator(
+		_In_     const char*                        Name,
+		_In_     std::shared_ptr< ExportGenerator > Generator,
+		_In_opt_ UINT16                             MachineType,
+		_In_opt_ SIZE_T                             NumberOfEntries,
+		_In_     bool                               IncludeData,
+		_In_     std::string                        ForwardTo = "",
+		_In_opt_ const ExportTable*                 Source    = NULL
+	)
+	{
+		this->AddOutput( Generator->GetPath() );
+
+		this->AddEmitter( Name, [ = ]( const std::vector< Record >& Records )
+		{
+			if ( !Generator->Begin( MachineType, NumberOfEntries ) )
+			{
+				printf( "Generator for %s failed to begin\n", Generator->GetPath().filename().string().c_str() );
+				return false;
+			}
+
+			for ( const auto& Entry : Records )
+			{
+				const auto Export = Source != NULL ? ( *Source )[ Entry.Index ] : Entry.Export;
+
+				if ( Export.IsData() && !IncludeData )
+					continue;
+
+				if ( ForwardTo.size() )
+					Generator->AddForwardedExportEntry( Export, ForwardTo );
+				else
+					Generator->AddExportEntry( Export, Entry.SymbolName );
+			}
+
+			Generator->End();
+
+			if ( !Generator->Close() )
+			{
+				printf( "Failed to write %s\n", Generator->GetPath().string().c_str() );
+				return false;
+			}
+
+			return true;
+		} );
+	}
+
+	/* Files written by the emitters, recorded for the regeneration cache */
+	void AddOutput(
+		_In_ const std::filesystem::path& Path
+	)
+	{
+		this->Outputs.push_back( Path );
+	}
+
+	const std::vector< std::filesystem::path >& GetOutputs() const
+	{
+		return this->Outputs;
+	}
+
+	/* Walks Entries once and runs every emitter, concurrently unless Parallel is false */
+	bool Run(
+		_In_ const ExportTable& Entries,
+		_In_ bool               WarnOnData,
+		_In_ bool               Parallel
+	)
+	{
+		std::vector< Record > Records;
+
+		Records.reserve( Entries.size() );
+
+		for ( UINT32 Index = 0; Index < Entries.size(); Index++ )
+		{
+			const auto Export = Entries[ Index ];
+
+			if ( WarnOnData && Export.IsData() )
+			{
+				if ( Export.HasName() )
+					printf( "Warning export %s is data\n", Export.GetName().data() );
+				else
+					printf( "Warning export ordinal %i is data\n", Export.GetOrdinal() );
+			}
+
+			if ( Export.HasName() )
+				Records.push_back( { Index, Export, std::string( Export.GetName() ) } );
+			else
+				Records.push_back( { Index, Export, "Ordinal_" + std::to_string( Export.GetOrdinal() ) } );
+		}
+
+		std::vector< char > Results( this->Emitters.size(), false );
+
+		if ( !Parallel || this->Emitters.size() < 2 )
+		{
+			for ( SIZE_T EmitterIndex = 0; EmitterIndex < this->Emitters.size(); EmitterIndex++ )
+				Results[ EmitterIndex ] = this->RunEmitter( EmitterIndex, Records );
+		}
+		else
+		{
+			/* The calling thread takes the first emitter instead of idling in join */
+			std::vector< std::thread > Workers;
+
+			for ( SIZE_T EmitterIndex = 1; EmitterIndex < this->Emitters.size(); EmitterIndex++ )
+			{
+				Workers.emplace_back( [ this, EmitterIndex, &Records, &Results ]()
+				{
+					Results[ EmitterIndex ] = this->RunEmitter( EmitterIndex, Records );
+				} );
+			}
+
+			Results[ 0 ] = this->RunEmitter( 0, Records );
+
+			for ( auto& Worker : Workers )
+				Worker.join();
+		}
+
+		return std::find( Results.begin(), Results.end(), false ) == Results.end();
+	}
+
+private:
+	struct NamedEmitter
+	{
+		const char* Name;
+		Emitter     Emit;
+	};
+
+	bool RunEmitter(
+		_In_ SIZE_T                       EmitterIndex,
+		_In_ const std::vector< Record >& Records
+	)
+	{
+		RunStats::Timer Timer( this->Emitters[ EmitterIndex ].Name );
+
+		return this->Emitters[ EmitterIndex ].Emit( Records );
+	}
+
+	std::vector< NamedEmitter >          Emitters;
+	std::vector< std::filesystem::path > Outputs;
+};
\ No newline at end of file
@@ -1,31 +1,35 @@
 #pragma once
 
-#include <fstream>
 #include <filesystem>
-#include <basetsd.h>
+#include "Platform.h"
 #include "ExportEntry.h"
+#include "OutputBuffer.h"
 
 class ExportGenerator
 {
 public:
 	ExportGenerator(
-		_In_ std::filesystem::path Path
-	) :	Path( Path )
+		_In_ std::filesystem::path Path,
+		_In_ bool                  Binary = false
+	) :	Path( Path ), Binary( Binary )
 	{
 		/*Guess this can fail but we will handle outside to make sure path exists etc*/
 	}
 
 	bool Open()
 	{
-		File.open( Path.c_str() );
+		return File.Open( Path, Binary );
+	}
 
-		if ( !File.is_open() )
-		{
-			printf( "Failed to open file", Path.string().c_str() );
-			return false;
-		}
+	const std::filesystem::path& GetPath() const
+	{
+		return Path;
+	}
 
-		return true;
+	/* Writes the buffered output to disk, call once after End */
+	bool Close()
+	{
+		return File.Close();
 	}
 
 	virtual bool Begin( 
@@ -47,5 +51,6 @@ public:
 
 protected:
 	std::filesystem::path Path;
-	std::ofstream File;
+	bool                  Binary;
+	OutputBuffer          File;
 };
\ No newline at end of file
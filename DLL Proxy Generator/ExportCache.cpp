@@ -0,0 +1,112 @@
+#include "ExportCache.h"
+
+ExportCache::ExportCache(
+	_In_ SIZE_T MaximumBytes
+) : MaximumBytes( MaximumBytes ), UsedBytes( 0 ), Hits( 0 ), Misses( 0 )
+{
+
+}
+
+std::filesystem::path ExportCache::GetKey(
+	_In_ const std::filesystem::path& Path
+)
+{
+	std::error_code Error;
+
+	/* Requests name the same DLL through different relative paths */
+	auto Key = std::filesystem::weakly_canonical( Path, Error );
+
+	return Error ? Path : Key;
+}
+
+std::shared_ptr< const ExportTable > ExportCache::Find(
+	_In_  const std::filesystem::path& Path,
+	_Out_ Stamp&                       Current
+)
+{
+	std::error_code Error;
+
+	Current.Valid     = false;
+	Current.Size      = std::filesystem::file_size( Path, Error );
+	Current.WriteTime = Error ? std::filesystem::file_time_type() : std::filesystem::last_write_time( Path, Error );
+
+	/* Without a stamp a table could never be proven current */
+	if ( Error )
+	{
+		this->Misses++;
+		return NULL;
+	}
+
+	Current.Valid = true;
+
+	const auto Key = GetKey( Path );
+
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	const auto Found = this->Index.find( Key );
+
+	if ( Found == this->Index.end() || Found->second->Parsed.Size != Current.Size || Found->second->Parsed.WriteTime != Current.WriteTime )
+	{
+		this->Misses++;
+		return NULL;
+	}
+
+	this->Entries.splice( this->Entries.begin(), this->Entries, Found->second );
+	this->Hits++;
+
+	return Found->second->Table;
+}
+
+void ExportCache::Insert(
+	_In_ const std::filesystem::path&         Path,
+	_In_ const Stamp&                         Parsed,
+	_In_ std::shared_ptr< const ExportTable > Table
+)
+{
+	const auto Bytes = Table->GetMemoryUsage() + sizeof( Entry );
+
+	if ( !Parsed.Valid || Bytes > this->MaximumBytes )
+		return;
+
+	const auto Key = GetKey( Path );
+
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	/* Concurrent misses on one DLL both parse it, the later one wins */
+	const auto Found = this->Index.find( Key );
+
+	if ( Found != this->Index.end() )
+	{
+		this->UsedBytes -= Found->second->Bytes;
+		this->Entries.erase( Found->second );
+		this->Index.erase( Found );
+	}
+
+	this->Entries.push_front( { Key, Parsed, std::move( Table ), Bytes } );
+	this->Index[ Key ] = this->Entries.begin();
+	this->UsedBytes   += Bytes;
+
+	/* Tables still in use by a request stay alive through their shared_ptr after eviction */
+	while ( this->UsedBytes > this->MaximumBytes )
+	{
+		auto& Oldest = this->Entries.back();
+
+		this->UsedBytes -= Oldest.Bytes;
+		this->Index.erase( Oldest.Path );
+		this->Entries.pop_back();
+	}
+}
+
+SIZE_T ExportCache::GetCount()
+{
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	return this->Entries.size();
+}
+
+SIZE_T ExportCache::GetBytes()
+{
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	return this->UsedBytes;
+}
\ No newline at end of file
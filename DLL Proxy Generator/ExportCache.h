@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Platform.h"
+#include "ExportEntry.h"
+#include <atomic>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/*
+	Least recently used set of parsed export tables, kept by the daemon so
+	a DLL that is asked for again is not parsed again. A table is only
+	handed out while its file still has the size and write time it had
+	when it was parsed, a rebuilt DLL simply misses. The budget is bytes of
+	table memory, one table can easily be a hundred times another.
+*/
+class ExportCache
+{
+public:
+	struct Stamp
+	{
+		bool                            Valid;
+		UINT64                          Size;
+		std::filesystem::file_time_type WriteTime;
+	};
+
+	ExportCache(
+		_In_ SIZE_T MaximumBytes
+	);
+
+	ExportCache( const ExportCache& ) = delete;
+	ExportCache& operator=( const ExportCache& ) = delete;
+
+	/* Reads the current stamp of Path into Current, then returns the table cached for it if it still matches */
+	std::shared_ptr< const ExportTable > Find(
+		_In_  const std::filesystem::path& Path,
+		_Out_ Stamp&                       Current
+	);
+
+	/* Parsed must be read before the image was, a file replaced in between then misses next time instead of going stale */
+	void Insert(
+		_In_ const std::filesystem::path&         Path,
+		_In_ const Stamp&                         Parsed,
+		_In_ std::shared_ptr< const ExportTable > Table
+	);
+
+	UINT64 GetHits() const
+	{
+		return this->Hits;
+	}
+
+	UINT64 GetMisses() const
+	{
+		return this->Misses;
+	}
+
+	SIZE_T GetCount();
+
+	SIZE_T GetBytes();
+
+private:
+	struct Entry
+	{
+		std::filesystem::path                Path;
+		Stamp                                Parsed;
+		std::shared_ptr< const ExportTable > Table;
+		SIZE_T                               Bytes;
+	};
+
+	static std::filesystem::path GetKey(
+		_In_ const std::filesystem::path& Path
+	);
+
+	std::mutex                                                      Lock;
+	std::list< Entry >                                              Entries; // Most recently used first
+	std::map< std::filesystem::path, std::list< Entry >::iterator > Index;
+	SIZE_T                                                          MaximumBytes;
+	SIZE_T                                                          UsedBytes;
+	std::atomic< UINT64 >                                           Hits;
+	std::atomic< UINT64 >                                           Misses;
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "ExportDiff.h"
+#include "RunStats.h"
+#include <algorithm>
+
+static const UINT32 NoOrdinal = 0;
+
+void ExportDiff::Compare(
+	_In_ const ExportTable& Old,
+	_In_ const ExportTable& New
+)
+{
+	RunStats::Timer Timer( "export diff" );
+
+	this->Changes.clear();
+	this->Unchanged = 0;
+
+	const auto SortedNames = []( const ExportTable& Table, std::vector< UINT32 >& Unnamed )
+	{
+		std::vector< std::pair< std::string_view, UINT32 > > Names;
+
+		Names.reserve( Table.size() );
+
+		for ( UINT32 Index = 0; Index < Table.size(); Index++ )
+		{
+			if ( Table[ Index ].HasName() )
+				Names.emplace_back( Table[ Index ].GetName(), Index );
+			else
+				Unnamed.push_back( Index );
+		}
+
+		std::sort( Names.begin(), Names.end() );
+
+		return Names;
+	};
+
+	std::vector< UINT32 > OldLeft;
+	std::vector< UINT32 > NewLeft;
+
+	const auto OldNames = SortedNames( Old, OldLeft );
+	const auto NewNames = SortedNames( New, NewLeft );
+
+	for ( SIZE_T OldIndex = 0, NewIndex = 0; OldIndex < OldNames.size() || NewIndex < NewNames.size(); )
+	{
+		if ( NewIndex == NewNames.size() || ( OldIndex < OldNames.size() && OldNames[ OldIndex ].first < NewNames[ NewIndex ].first ) )
+		{
+			OldLeft.push_back( OldNames[ OldIndex++ ].second );
+		}
+		else if ( OldIndex == OldNames.size() || NewNames[ NewIndex ].first < OldNames[ OldIndex ].first )
+		{
+			NewLeft.push_back( NewNames[ NewIndex++ ].second );
+		}
+		else
+		{
+			const auto OldExport = Old[ OldNames[ OldIndex++ ].second ];
+			const auto NewExport = New[ NewNames[ NewIndex++ ].second ];
+			const bool Moved     = OldExport.GetOrdinal() != NewExport.GetOrdinal();
+
+			if ( Moved )
+				this->AddChange( OrdinalChanged, NewExport, OldExport.GetOrdinal(), NewExport.GetOrdinal() );
+
+			this->CompareBodies( OldExport, NewExport, Moved );
+		}
+	}
+
+	/* Table rows are in ordinal order, sorting the leftover rows restores it */
+	std::sort( OldLeft.begin(), OldLeft.end() );
+	std::sort( NewLeft.begin(), NewLeft.end() );
+
+	for ( SIZE_T OldIndex = 0, NewIndex = 0; OldIndex < OldLeft.size() || NewIndex < NewLeft.size(); )
+	{
+		const auto OldOrdinal = OldIndex < OldLeft.size() ? Old[ OldLeft[ OldIndex ] ].GetOrdinal() : 0;
+		const auto NewOrdinal = NewIndex < NewLeft.size() ? New[ NewLeft[ NewIndex ] ].GetOrdinal() : 0;
+
+		if ( NewIndex == NewLeft.size() || ( OldIndex < OldLeft.size() && OldOrdinal < NewOrdinal ) )
+		{
+			this->AddChange( Removed, Old[ OldLeft[ OldIndex++ ] ], OldOrdinal, NoOrdinal );
+		}
+		else if ( OldIndex == OldLeft.size() || NewOrdinal < OldOrdinal )
+		{
+			this->AddChange( Added, New[ NewLeft[ NewIndex++ ] ], NoOrdinal, NewOrdinal );
+		}
+		else
+		{
+			const auto OldExport = Old[ OldLeft[ OldIndex++ ] ];
+			const auto NewExport = New[ NewLeft[ NewIndex++ ] ];
+			const bool Renamed   = OldExport.GetName() != NewExport.GetName();
+
+			if ( Renamed )
+				this->AddChange( ExportDiff::Renamed, NewExport, OldOrdinal, NewOrdinal, OldExport.GetName() );
+
+			this->CompareBodies( OldExport, NewExport, Renamed );
+		}
+	}
+
+	std::stable_sort( this->Changes.begin(), this->Changes.end(), []( const Change& Left, const Change& Right )
+	{
+		return ( Left.NewOrdinal ? Left.NewOrdinal : Left.OldOrdinal ) < ( Right.NewOrdinal ? Right.NewOrdinal : Right.OldOrdinal );
+	} );
+}
+
+void ExportDiff::CompareBodies(
+	_In_ const ExportEntry& Old,
+	_In_ const ExportEntry& New,
+	_In_ bool               Changed
+)
+{
+	const auto OldOrdinal = Old.GetOrdinal();
+	const auto NewOrdinal = New.GetOrdinal();
+	const auto Before     = this->Changes.size();
+
+	/* RVAs move with every rebuild, only what the proxy generates from counts */
+	if ( !Old.IsForwarded() && New.IsForwarded() )
+		this->AddChange( BecameForwarded, New, OldOrdinal, NewOrdinal, New.GetForwardedName() );
+	else if ( Old.IsForwarded() && !New.IsForwarded() )
+		this->AddChange( StoppedForwarding, New, OldOrdinal, NewOrdinal, Old.GetForwardedName() );
+	else if ( Old.IsForwarded() && Old.GetForwardedName() != New.GetForwardedName() )
+		this->AddChange( ForwarderChanged, New, OldOrdinal, NewOrdinal, New.GetForwardedName() );
+
+	if ( !Old.IsForwarded() && !New.IsForwarded() && Old.IsData() != New.IsData() )
+		this->AddChange( New.IsData() ? BecameData : BecameCode, New, OldOrdinal, NewOrdinal );
+
+	if ( !Changed && this->Changes.size() == Before )
+		this->Unchanged++;
+}
+
+void ExportDiff::AddChange(
+	_In_ ChangeType         Type,
+	_In_ const ExportEntry& Export,
+	_In_ UINT32             OldOrdinal,
+	_In_ UINT32             NewOrdinal,
+	_In_ std::string_view   Detail
+)
+{
+	this->Changes.push_back( { Type, std::string( Export.GetName() ), std::string( Detail ), OldOrdinal, NewOrdinal } );
+}
+
+void ExportDiff::Print() const
+{
+	SIZE_T Added   = 0;
+	SIZE_T Removed = 0;
+
+	for ( const auto& Entry : this->Changes )
+	{
+		const auto Name = Entry.Name.size() ? Entry.Name.c_str() : "[NONAME]";
+
+		switch ( Entry.Type )
+		{
+			case ExportDiff::Added:
+				printf( "+ %-60s @%u\n", Name, Entry.NewOrdinal );
+				Added++;
+				break;
+			case ExportDiff::Removed:
+				printf( "- %-60s @%u\n", Name, Entry.OldOrdinal );
+				Removed++;
+				break;
+			case ExportDiff::Renamed:
+				printf( "~ %-60s @%u renamed from %s\n", Name, Entry.NewOrdinal, Entry.Detail.size() ? Entry.Detail.c_str() : "[NONAME]" );
+				break;
+			case ExportDiff::OrdinalChanged:
+				printf( "~ %-60s @%u moved from @%u\n", Name, Entry.NewOrdinal, Entry.OldOrdinal );
+				break;
+			case ExportDiff::BecameForwarded:
+				printf( "~ %-60s @%u now forwarded to %s\n", Name, Entry.NewOrdinal, Entry.Detail.c_str() );
+				break;
+			case ExportDiff::StoppedForwarding:
+				printf( "~ %-60s @%u no longer forwarded to %s\n", Name, Entry.NewOrdinal, Entry.Detail.c_str() );
+				break;
+			case ExportDiff::ForwarderChanged:
+				printf( "~ %-60s @%u forwarded to %s instead\n", Name, Entry.NewOrdinal, Entry.Detail.c_str() );
+				break;
+			case ExportDiff::BecameData:
+				printf( "~ %-60s @%u code became data\n", Name, Entry.NewOrdinal );
+				break;
+			case ExportDiff::BecameCode:
+				printf( "~ %-60s @%u data became code\n", Name, Entry.NewOrdinal );
+				break;
+		}
+	}
+
+	printf( "%zu added, %zu removed, %zu changes, %zu unchanged\n", Added, Removed, this->Changes.size() - Added - Removed, this->Unchanged );
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Platform.h"
+#include "ExportEntry.h"
+#include <string>
+#include <vector>
+
+/*
+	Export set changes between two builds of a DLL.
+
+	Named exports are paired by name with one merge over both name lists
+	sorted by bytes. Whatever is left, nameless exports and names that
+	appear on one side only, is paired by ordinal with a second merge, so a
+	renamed export shows up as a rename instead of an add and a remove.
+*/
+class ExportDiff
+{
+public:
+	enum ChangeType
+	{
+		Added,
+		Removed,
+		Renamed,
+		OrdinalChanged,
+		BecameForwarded,
+		StoppedForwarding,
+		ForwarderChanged,
+		BecameData,
+		BecameCode
+	};
+
+	struct Change
+	{
+		ChangeType  Type;
+		std::string Name;       // Name in the new build, the old one for Removed, empty for NONAME
+		std::string Detail;     // Old name for Renamed, the forwarder for forwarding changes
+		UINT32      OldOrdinal;
+		UINT32      NewOrdinal;
+	};
+
+	ExportDiff() : Unchanged( 0 )
+	{
+
+	}
+
+	void Compare(
+		_In_ const ExportTable& Old,
+		_In_ const ExportTable& New
+	);
+
+	/* Sorted by ordinal, the old one for removed exports */
+	const std::vector< Change >& GetChanges() const
+	{
+		return this->Changes;
+	}
+
+	SIZE_T GetUnchanged() const
+	{
+		return this->Unchanged;
+	}
+
+	/* One line per change then a summary */
+	void Print() const;
+
+private:
+	/* Forwarding and code or data changes between two exports already paired up */
+	void CompareBodies(
+		_In_ const ExportEntry& Old,
+		_In_ const ExportEntry& New,
+		_In_ bool               Changed
+	);
+
+	void AddChange(
+		_In_ ChangeType         Type,
+		_In_ const ExportEntry& Export,
+		_In_ UINT32             OldOrdinal,
+		_In_ UINT32             NewOrdinal,
+		_In_ std::string_view   Detail = ""
+	);
+
+	std::vector< Change > Changes;
+	SIZE_T                Unchanged;
+};
\ No newline at end of file
@@ -1,39 +1,57 @@
 #include "ExportEntry.h"
+#include "RunStats.h"
+#include <algorithm>
 
 bool ExportEntry::IsRVAInDataSection( 
-	_In_ PLOADED_IMAGE Image,
-	_In_ UINT32        RVA 
+	_In_ const PEImage& Image,
+	_In_ UINT32         RVA 
 )
 {
-	for ( ULONG SectionIndex = 0; SectionIndex < Image->NumberOfSections; SectionIndex++ )
-	{
-		const auto Section = Image->Sections[ SectionIndex ];
+	const auto Section = Image.FindSection( RVA );
 
-		if( RVA >= Section.VirtualAddress && 
-			RVA <  Section.VirtualAddress + Section.Misc.VirtualSize )
-		{
-			/*Found section rva is in*/
+	if ( Section == NULL )
+		return false;
 
-			if ( Section.Characteristics & IMAGE_SCN_CNT_CODE )
-				return false;
+	/*Found section rva is in*/
 
-			return true;
-		}
-	}
+	if ( Section->Characteristics & IMAGE_SCN_CNT_CODE )
+		return false;
 
-	return false;
+	return true;
+}
+
+/*
+	Invert AddressOfNameOrdinals in one pass so each ordinal finds its name in O(1).
+	If several names point at the same ordinal the first one wins like the old scan.
+*/
+void ExportEntry::GetNameIndexForOrdinals(
+	_In_  const UINT16*          NameOrdinalArray,
+	_In_  UINT32                 NumberOfNames,
+	_In_  UINT32                 NumberOfFunctions,
+	_Out_ std::vector< UINT32 >& NameIndexForOrdinal
+)
+{
+	NameIndexForOrdinal.assign( NumberOfFunctions, NoName );
+
+	for ( UINT32 NameOrdinalIndex = 0; NameOrdinalIndex < NumberOfNames; NameOrdinalIndex++ )
+	{
+		const auto OrdinalIndex = NameOrdinalArray[ NameOrdinalIndex ];
+
+		if ( OrdinalIndex < NameIndexForOrdinal.size() && NameIndexForOrdinal[ OrdinalIndex ] == NoName )
+			NameIndexForOrdinal[ OrdinalIndex ] = NameOrdinalIndex;
+	}
 }
 
 bool ExportEntry::GetExportEntries(
 	_In_  const std::filesystem::path& Path,
-	_Out_ std::vector< ExportEntry >&  Entries,
+	_Out_ ExportTable&                 Entries,
 	_In_  bool                         Verbose,
 	_Out_ UINT16*                      MachineType
 )
 {
-	Entries = std::vector<ExportEntry>();
+	Entries.Clear();
 
-	LOADED_IMAGE LoadedImage;
+	PEImage Image;
 
 	if ( !std::filesystem::exists( Path ) )
 	{
@@ -41,104 +59,162 @@ bool ExportEntry::GetExportEntries(
 		return false;
 	}
 
-	if ( MapAndLoad( Path.string().c_str(), NULL, &LoadedImage, TRUE, TRUE ) )
+	if ( !Image.Open( Path ) )
+		return false;
+
+	return ExportEntry::GetExportEntries( Image, Entries, Verbose, MachineType );
+}
+
+bool ExportEntry::GetExportEntries(
+	_In_  const void*  Data,
+	_In_  SIZE_T       Size,
+	_Out_ ExportTable& Entries,
+	_In_  bool         Verbose,
+	_Out_ UINT16*      MachineType
+)
+{
+	Entries.Clear();
+
+	PEImage Image;
+
+	if ( !Image.Open( Data, Size ) )
+		return false;
+
+	return ExportEntry::GetExportEntries( Image, Entries, Verbose, MachineType );
+}
+
+bool ExportEntry::GetExportEntries(
+	_In_  const PEImage& Image,
+	_Out_ ExportTable&   Entries,
+	_In_  bool           Verbose,
+	_Out_ UINT16*        MachineType
+)
+{
+	RunStats::Timer Timer( "export walk" );
+
+	Entries.Clear();
+
+	if ( !Image.IsDLL() )
 	{
-		if ( !( LoadedImage.FileHeader->FileHeader.Characteristics & IMAGE_FILE_DLL ) )
-		{
-			printf( "File Not A DLL\n" );
+		printf( "File Not A DLL\n" );
+		return false;
+	}
 
-			UnMapAndLoad( &LoadedImage );
+	if( MachineType != NULL)
+		*MachineType = Image.GetMachine();
 
-			return false;
-		}
+	const auto ExportDirectoryEntry = Image.GetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXPORT );
 
-		if( MachineType != NULL)
-			*MachineType = LoadedImage.FileHeader->FileHeader.Machine;
+	if ( ExportDirectoryEntry == NULL )
+		return false;
 
-		ULONG ImageDirectorySize = 0;
+	const auto ExportDirectoryStart = ExportDirectoryEntry->VirtualAddress;
+	const auto ExportDirectorySize  = ExportDirectoryEntry->Size;
+	const auto ImageExportDirectory = Image.RvaToPointer<IMAGE_EXPORT_DIRECTORY>( ExportDirectoryStart );
 
-		auto ImageExportDirectory = (IMAGE_EXPORT_DIRECTORY*)ImageDirectoryEntryToData( LoadedImage.MappedAddress, FALSE, IMAGE_DIRECTORY_ENTRY_EXPORT, &ImageDirectorySize );
+	if ( ImageExportDirectory == NULL )
+	{
+		printf( "ERROR: Export directory out of bounds\n" );
+		return false;
+	}
 
-		if ( ImageExportDirectory == NULL )
-			return false;
+	if ( Verbose )
+	{
+		printf( "Characteristics    %08X\n",      ImageExportDirectory->Characteristics );
+		printf( "Time Date Stamp    %08X\n",      ImageExportDirectory->TimeDateStamp );
+		printf( "Ordinal Base       %i\n",        ImageExportDirectory->Base );
+		printf( "Nuber Of Functions %i\n",        ImageExportDirectory->NumberOfFunctions );
+		printf( "Nuber Of Names     %i\n",        ImageExportDirectory->NumberOfNames );
+		printf( "Version            %hu.%02hu\n", ImageExportDirectory->MajorVersion, ImageExportDirectory->MinorVersion );
+	}
 
-		if ( Verbose )
+	auto FunctionArray    = Image.RvaToPointer<UINT32>( ImageExportDirectory->AddressOfFunctions,    ImageExportDirectory->NumberOfFunctions );
+	auto NameOrdinalArray = Image.RvaToPointer<UINT16>( ImageExportDirectory->AddressOfNameOrdinals, ImageExportDirectory->NumberOfNames );
+	auto NameArray        = Image.RvaToPointer<UINT32>( ImageExportDirectory->AddressOfNames,        ImageExportDirectory->NumberOfNames );
+
+	if ( FunctionArray == NULL || ( ImageExportDirectory->NumberOfNames != 0 && ( NameOrdinalArray == NULL || NameArray == NULL ) ) )
+	{
+		printf( "ERROR: Export tables out of bounds\n" );
+		return false;
+	}
+
+	std::vector< UINT32 > NameIndexForOrdinal;
+
+	ExportEntry::GetNameIndexForOrdinals( NameOrdinalArray, ImageExportDirectory->NumberOfNames, ImageExportDirectory->NumberOfFunctions, NameIndexForOrdinal );
+
+	Entries.SetOrdinalBase( ImageExportDirectory->Base );
+	Entries.SetImageInfo( Image.GetMachine(), Image.GetTimeDateStamp(), Image.GetImageBase() );
+
+	/* Names and forwarders live in the directory, but its size is only a hint from the file and cant exceed the file itself */
+	Entries.Reserve( ImageExportDirectory->NumberOfFunctions, std::min< SIZE_T >( ExportDirectorySize, Image.GetSize() ) );
+
+	/* Classification runs per export, sum it locally and record it once */
+	const bool TimeClassify     = RunStats::IsEnabled();
+	UINT64     ClassifyTime     = 0;
+	UINT64     NumberOfClassify = 0;
+
+	for ( UINT32 OrdinalIndex = 0; OrdinalIndex < ImageExportDirectory->NumberOfFunctions; OrdinalIndex++ )
+	{
+		auto Ordinal          = ImageExportDirectory->Base + OrdinalIndex;
+		auto FunctionRVA      = FunctionArray[ OrdinalIndex ];
+		auto NameOrdinalIndex = NameIndexForOrdinal[ OrdinalIndex ];
+		auto Name             = "";
+		auto ForwardedName    = "";
+		auto IsData           = false;
+
+		if ( NameOrdinalIndex != NoName )
 		{
-			printf( "Characteristics    %08X\n",      ImageExportDirectory->Characteristics );
-			printf( "Time Date Stamp    %08X\n",      ImageExportDirectory->TimeDateStamp );
-			printf( "Ordinal Base       %i\n",        ImageExportDirectory->Base );
-			printf( "Nuber Of Functions %i\n",        ImageExportDirectory->NumberOfFunctions );
-			printf( "Nuber Of Names     %i\n",        ImageExportDirectory->NumberOfNames );
-			printf( "Version            %hu.%02hu\n", ImageExportDirectory->MajorVersion, ImageExportDirectory->MinorVersion );
-		}
+			/*Found the ordinal in the name ordinal array now use that index in the name array*/
 
-		auto FunctionArray    = (UINT32*)ImageRvaToVa( LoadedImage.FileHeader, LoadedImage.MappedAddress, ImageExportDirectory->AddressOfFunctions, NULL );
-		auto NameOrdinalArray = (UINT16*)ImageRvaToVa( LoadedImage.FileHeader, LoadedImage.MappedAddress, ImageExportDirectory->AddressOfNameOrdinals, NULL );
-		auto NameArray        = (UINT32*)ImageRvaToVa( LoadedImage.FileHeader, LoadedImage.MappedAddress, ImageExportDirectory->AddressOfNames, NULL );
+			Name = Image.RvaToString( NameArray[ NameOrdinalIndex ] );
 
-		for ( UINT32 OrdinalIndex = 0; OrdinalIndex < ImageExportDirectory->NumberOfFunctions; OrdinalIndex++ )
+			if ( Name == NULL )
+			{
+				printf( "ERROR: Ordinal %i had invalid name\n", Ordinal );
+				return false;
+			}
+		}
+
+		/* If function address is within the image export directory its a forwarded entry */
+		if ( FunctionRVA >= ExportDirectoryStart &&
+			 FunctionRVA - ExportDirectoryStart < ExportDirectorySize )
 		{
-			auto Export          = ExportEntry( ImageExportDirectory->Base + OrdinalIndex, OrdinalIndex );
-			auto FunctionRVA     = FunctionArray[ OrdinalIndex ];
-			auto FunctionAddress = (UINT_PTR)ImageRvaToVa( LoadedImage.FileHeader, LoadedImage.MappedAddress, FunctionRVA, NULL );
+			ForwardedName = Image.RvaToString( FunctionRVA );
 
-			for ( UINT32 NameOrdinalIndex = 0; NameOrdinalIndex < ImageExportDirectory->NumberOfNames; NameOrdinalIndex++ )
+			if ( ForwardedName == NULL )
 			{
-				if ( OrdinalIndex == NameOrdinalArray[ NameOrdinalIndex ] )
-				{
-					/*Found the ordinal in the name ordinal array now use that index in the name array*/
-					
-					auto Name = (const char*)ImageRvaToVa( LoadedImage.FileHeader, LoadedImage.MappedAddress, NameArray[ NameOrdinalIndex ], NULL );
-
-					if ( Name == NULL )
-					{
-						printf( "ERROR: Ordinal %i had invalid name\n", Export.GetOrdinal() );
-						return false;
-					}
-
-					Export.SetName( Name );
-
-					break;
-				}
+				printf( "ERROR: Ordinal %i had invalid forwarded name\n", Ordinal );
+				return false;
 			}
+		}
+		else
+		{
+			if ( FunctionRVA == 0 )
+				continue; // Ordinal not used
 
-			/* If function address is within the image export directory its a forwarded entry */
-			if ( FunctionAddress >=   (UINT_PTR)ImageExportDirectory &&
-				 FunctionAddress <  ( (UINT_PTR)ImageExportDirectory + ImageDirectorySize ) )
+			if ( TimeClassify )
 			{
-				auto ForwardedName = (const char*)FunctionAddress;
+				const auto Start = RunStats::Now();
 
-				if ( ForwardedName == NULL )
-				{
-					printf( "ERROR: Ordinal %i had invalid forwarded name\n", Export.GetOrdinal() );
-					return false;
-				}
+				IsData = ExportEntry::IsRVAInDataSection( Image, FunctionRVA );
 
-				Export.SetForwardedName( ForwardedName );
+				ClassifyTime += RunStats::Now() - Start;
+				NumberOfClassify++;
 			}
 			else
 			{
-				if ( FunctionRVA == NULL )
-					continue; // Ordinal not used
-
-				Export.SetFunctionRVA( FunctionRVA );
+				IsData = ExportEntry::IsRVAInDataSection( Image, FunctionRVA );
 			}
-
-			if ( !Export.IsForwarded() )
-			{
-				Export.SetIsData( ExportEntry::IsRVAInDataSection( &LoadedImage, Export.GetRVA() ) );
-			}
-
-			if(Verbose )
-				Export.Print();
-
-			Entries.push_back( Export );
 		}
 
-		UnMapAndLoad( &LoadedImage );
+		Entries.Add( OrdinalIndex, FunctionRVA, Name, ForwardedName, IsData );
 
-		return true;
+		if ( Verbose )
+			Entries[ Entries.size() - 1 ].Print();
 	}
 
-	return false;
-}
\ No newline at end of file
+	if ( TimeClassify )
+		RunStats::AddTime( "classify rva", ClassifyTime, NumberOfClassify );
+
+	return true;
+}
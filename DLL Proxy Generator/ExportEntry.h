@@ -1,74 +1,76 @@
 #pragma once
 
-#include <Windows.h>
-#include <imagehlp.h>
+#include "Platform.h"
+#include "PEImage.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 
+class ExportTable;
+
+/*
+	Lightweight view of one row of an ExportTable, cheap to copy and only
+	valid while the table it came from is alive. Names are views into the
+	table's string pool and are always null terminated.
+*/
 class ExportEntry
 {
 public:
+	/* Slot value of ordinals without a name in GetNameIndexForOrdinals */
+	static constexpr UINT32 NoName = 0xFFFFFFFF;
+
 	static bool IsRVAInDataSection(
-		_In_ PLOADED_IMAGE Image,
-		_In_ UINT32        RVA
+		_In_ const PEImage& Image,
+		_In_ UINT32         RVA
 	);
 
 	static bool GetExportEntries(
 		_In_  const std::filesystem::path& Path,
-		_Out_ std::vector< ExportEntry >&  Entries,
+		_Out_ ExportTable&                 Entries,
 		_In_  bool                         Verbose,
 		_Out_ UINT16*                      MachineType
 	);
 
-	UINT32 GetOrdinal() const
-	{
-		return this->Ordinal;
-	}
+	/* Same as above for an image the caller already holds in memory */
+	static bool GetExportEntries(
+		_In_  const void*  Data,
+		_In_  SIZE_T       Size,
+		_Out_ ExportTable& Entries,
+		_In_  bool         Verbose,
+		_Out_ UINT16*      MachineType
+	);
 
-	UINT32 GetOrdinalIndex() const
-	{
-		return this->OrdinalIndex;
-	}
+	static bool GetExportEntries(
+		_In_  const PEImage& Image,
+		_Out_ ExportTable&   Entries,
+		_In_  bool           Verbose,
+		_Out_ UINT16*        MachineType
+	);
 
-	bool HasName() const
-	{
-		return this->Name.size() > 0;
-	}
+	/* Inverts AddressOfNameOrdinals into the index of the first name of every ordinal, or NoName */
+	static void GetNameIndexForOrdinals(
+		_In_  const UINT16*          NameOrdinalArray,
+		_In_  UINT32                 NumberOfNames,
+		_In_  UINT32                 NumberOfFunctions,
+		_Out_ std::vector< UINT32 >& NameIndexForOrdinal
+	);
 
-	bool IsForwarded() const
-	{
-		return this->ForwardedName.size() > 0;
-	}
+	inline UINT32 GetOrdinal() const;
 
-	bool IsData() const
-	{
-		return this->IsDataReference;
-	}
+	inline UINT32 GetOrdinalIndex() const;
 
-	std::string GetName() const
-	{
-		if ( !this->HasName() )
-			return "";
+	inline bool HasName() const;
 
-		return this->Name;
-	}
+	inline bool IsForwarded() const;
 
-	std::string GetForwardedName() const
-	{
-		if ( !this->IsForwarded() )
-			return "";
+	inline bool IsData() const;
 
-		return this->ForwardedName;
-	}
+	inline std::string_view GetName() const;
 
-	UINT32 GetRVA() const
-	{
-		if ( this->IsForwarded() )
-			return NULL;
+	inline std::string_view GetForwardedName() const;
 
-		return this->RVA;
-	}
+	inline UINT32 GetRVA() const;
 
 	void Print() const
 	{
@@ -77,11 +79,11 @@ public:
 		if ( !this->HasName() )
 			Name = "[NONAME]";
 
-		printf( "Ordinal: %4i Name: %-60s", this->GetOrdinal(), Name.c_str() );
+		printf( "Ordinal: %4i Name: %-60.*s", this->GetOrdinal(), (int)Name.size(), Name.data() );
 
 		if ( this->IsForwarded() )
 		{
-			printf( "RVA:   (Forwarded) ->  %-60s", ForwardedName.c_str() );
+			printf( "RVA:   (Forwarded) ->  %-60s", this->GetForwardedName().data() );
 		}
 		else
 		{
@@ -101,38 +103,273 @@ public:
 	}
 
 private:
+	friend class ExportTable;
+
 	ExportEntry( 
-		_In_ UINT32 Ordinal,
-		_In_ UINT32 OrdinalIndex
-	) : Ordinal( Ordinal ), OrdinalIndex( OrdinalIndex ), Name( "" ), ForwardedName( "" ), RVA( 0 ), IsDataReference(false)
+		_In_ const ExportTable* Table,
+		_In_ UINT32             Index
+	) : Table( Table ), Index( Index )
+	{
+
+	}
+
+	const ExportTable* Table;
+	UINT32             Index;
+};
+
+/*
+	Structure of arrays export set. Scalars live in parallel arrays and every
+	name and forwarder string is appended to a single pool, so a table costs
+	a handful of allocations no matter how many exports it holds.
+*/
+class ExportTable
+{
+public:
+	class Iterator
+	{
+	public:
+		Iterator(
+			_In_ const ExportTable* Table,
+			_In_ UINT32             Index
+		) : Table( Table ), Index( Index )
+		{
+
+		}
+
+		ExportEntry operator*() const
+		{
+			return ExportEntry( this->Table, this->Index );
+		}
+
+		Iterator& operator++()
+		{
+			this->Index++;
+			return *this;
+		}
+
+		bool operator!=( const Iterator& Other ) const
+		{
+			return this->Index != Other.Index;
+		}
+
+	private:
+		const ExportTable* Table;
+		UINT32             Index;
+	};
+
+	ExportTable()
+	{
+		this->Clear();
+	}
+
+	void Clear()
+	{
+		this->OrdinalBase   = 0;
+		this->Machine       = 0;
+		this->TimeDateStamp = 0;
+		this->ImageBase     = 0;
+		this->OrdinalIndices.clear();
+		this->RVAs.clear();
+		this->NameOffsets.clear();
+		this->ForwarderOffsets.clear();
+		this->Flags.clear();
+		this->Strings.assign( 1, '\0' ); // Offset 0 is the shared empty string
+	}
+
+	void Reserve(
+		_In_ SIZE_T NumberOfEntries,
+		_In_ SIZE_T NumberOfStringBytes
+	)
+	{
+		this->OrdinalIndices.reserve( NumberOfEntries );
+		this->RVAs.reserve( NumberOfEntries );
+		this->NameOffsets.reserve( NumberOfEntries );
+		this->ForwarderOffsets.reserve( NumberOfEntries );
+		this->Flags.reserve( NumberOfEntries );
+		this->Strings.reserve( NumberOfStringBytes + 1 );
+	}
+
+	void SetOrdinalBase(
+		_In_ UINT32 Base
+	)
 	{
+		this->OrdinalBase = Base;
+	}
+
+	UINT32 GetOrdinalBase() const
+	{
+		return this->OrdinalBase;
+	}
 
+	/* Header fields of the image the table was read from, carried along for manifests */
+	void SetImageInfo(
+		_In_ UINT16 Machine,
+		_In_ UINT32 TimeDateStamp,
+		_In_ UINT64 ImageBase
+	)
+	{
+		this->Machine       = Machine;
+		this->TimeDateStamp = TimeDateStamp;
+		this->ImageBase     = ImageBase;
+	}
+
+	UINT16 GetMachine() const
+	{
+		return this->Machine;
+	}
+
+	UINT32 GetTimeDateStamp() const
+	{
+		return this->TimeDateStamp;
+	}
+
+	UINT64 GetImageBase() const
+	{
+		return this->ImageBase;
+	}
+
+	void Add(
+		_In_ UINT32           OrdinalIndex,
+		_In_ UINT32           RVA,
+		_In_ std::string_view Name,
+		_In_ std::string_view ForwardedName,
+		_In_ bool             IsData
+	)
+	{
+		this->OrdinalIndices.push_back( OrdinalIndex );
+		this->RVAs.push_back( ForwardedName.size() ? 0 : RVA );
+		this->NameOffsets.push_back( this->AddString( Name ) );
+		this->ForwarderOffsets.push_back( this->AddString( ForwardedName ) );
+		this->Flags.push_back( IsData ? FlagData : 0 );
+	}
+
+	/* Points an entry at a different forwarder, the old string stays in the pool */
+	void SetForwardedName(
+		_In_ SIZE_T           Index,
+		_In_ std::string_view ForwardedName
+	)
+	{
+		this->RVAs[ Index ]             = 0;
+		this->ForwarderOffsets[ Index ] = this->AddString( ForwardedName );
+	}
+
+	SIZE_T size() const
+	{
+		return this->OrdinalIndices.size();
+	}
+
+	bool empty() const
+	{
+		return this->OrdinalIndices.empty();
+	}
+
+	/* Size of a table indexed by ordinal index, unused ordinals leave holes so this can exceed size() */
+	UINT32 GetOrdinalCount() const
+	{
+		return this->OrdinalIndices.empty() ? 0 : this->OrdinalIndices.back() + 1;
 	}
 
-	void SetIsData( bool IsData )
+	ExportEntry operator[]( SIZE_T Index ) const
 	{
-		this->IsDataReference = IsData;
+		return ExportEntry( this, (UINT32)Index );
 	}
 
-	void SetFunctionRVA( UINT32 RVA )
+	Iterator begin() const
 	{
-		this->RVA = RVA;
+		return Iterator( this, 0 );
 	}
 
-	void SetName( const std::string& Name )
+	Iterator end() const
 	{
-		this->Name = Name;
+		return Iterator( this, (UINT32)this->size() );
 	}
 
-	void SetForwardedName( const std::string& ForwardedName )
+	/* Bytes held by the table, including unused capacity */
+	SIZE_T GetMemoryUsage() const
 	{
-		this->ForwardedName = ForwardedName;
+		return this->OrdinalIndices.capacity()   * sizeof( UINT32 ) +
+			   this->RVAs.capacity()             * sizeof( UINT32 ) +
+			   this->NameOffsets.capacity()      * sizeof( UINT32 ) +
+			   this->ForwarderOffsets.capacity() * sizeof( UINT32 ) +
+			   this->Flags.capacity()            * sizeof( UINT8 ) +
+			   this->Strings.capacity();
 	}
 
-	UINT32 Ordinal;
-	UINT32 OrdinalIndex;
-	std::string Name;
-	std::string ForwardedName;
-	UINT32 RVA;
-	bool IsDataReference;
-};
\ No newline at end of file
+private:
+	friend class ExportEntry;
+
+	static const UINT8 FlagData = 1;
+
+	UINT32 AddString(
+		_In_ std::string_view String
+	)
+	{
+		if ( String.size() == 0 )
+			return 0;
+
+		auto Offset = (UINT32)this->Strings.size();
+
+		this->Strings.insert( this->Strings.end(), String.begin(), String.end() );
+		this->Strings.push_back( '\0' );
+
+		return Offset;
+	}
+
+	std::string_view GetString(
+		_In_ UINT32 Offset
+	) const
+	{
+		return std::string_view( this->Strings.data() + Offset );
+	}
+
+	UINT32                OrdinalBase;
+	UINT16                Machine;
+	UINT32                TimeDateStamp;
+	UINT64                ImageBase;
+	std::vector< UINT32 > OrdinalIndices;
+	std::vector< UINT32 > RVAs;
+	std::vector< UINT32 > NameOffsets;
+	std::vector< UINT32 > ForwarderOffsets;
+	std::vector< UINT8 >  Flags;
+	std::vector< char >   Strings;
+};
+
+inline UINT32 ExportEntry::GetOrdinal() const
+{
+	return this->Table->OrdinalBase + this->GetOrdinalIndex();
+}
+
+inline UINT32 ExportEntry::GetOrdinalIndex() const
+{
+	return this->Table->OrdinalIndices[ this->Index ];
+}
+
+inline bool ExportEntry::HasName() const
+{
+	return this->Table->NameOffsets[ this->Index ] != 0;
+}
+
+inline bool ExportEntry::IsForwarded() const
+{
+	return this->Table->ForwarderOffsets[ this->Index ] != 0;
+}
+
+inline bool ExportEntry::IsData() const
+{
+	return ( this->Table->Flags[ this->Index ] & ExportTable::FlagData ) != 0;
+}
+
+inline std::string_view ExportEntry::GetName() const
+{
+	return this->Table->GetString( this->Table->NameOffsets[ this->Index ] );
+}
+
+inline std::string_view ExportEntry::GetForwardedName() const
+{
+	return this->Table->GetString( this->Table->ForwarderOffsets[ this->Index ] );
+}
+
+inline UINT32 ExportEntry::GetRVA() const
+{
+	return this->Table->RVAs[ this->Index ];
+}
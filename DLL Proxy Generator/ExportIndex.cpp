@@ -0,0 +1,462 @@
+#include "ExportIndex.h"
+#include "ExportEntry.h"
+#include "RunStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+
+static const char IndexMagic[ 8 ] = { 'D', 'P', 'G', 'I', 'N', 'D', 'E', 'X' };
+
+static UINT64 AlignSection(
+	_In_ UINT64 Offset
+)
+{
+	return ( Offset + 7 ) & ~7ULL;
+}
+
+bool ExportIndex::Open(
+	_In_ const std::filesystem::path& Path
+)
+{
+	this->Close();
+
+	if ( !this->File.Open( Path ) )
+		return false;
+
+	const auto Base = this->File.GetData();
+	const auto Size = (UINT64)this->File.GetSize();
+
+	if ( Size < sizeof( Header ) )
+	{
+		printf( "Index file too small\n" );
+		this->Close();
+		return false;
+	}
+
+	const auto IndexHeader = (const Header*)Base;
+
+	if ( memcmp( IndexHeader->Magic, IndexMagic, sizeof( IndexMagic ) ) != 0 || IndexHeader->Version != ExportIndex::Version )
+	{
+		printf( "Not an export index or built by another version\n" );
+		this->Close();
+		return false;
+	}
+
+	const auto SectionFits = [ Size ]( UINT64 Offset, UINT64 Count, UINT64 ElementSize )
+	{
+		return Offset <= Size && Count <= ( Size - Offset ) / ElementSize;
+	};
+
+	/* Bounds are checked once here so lookups can index the mapping directly */
+	if ( !SectionFits( IndexHeader->ImagesOffset,   IndexHeader->NumberOfImages,   sizeof( Image ) )   ||
+		 !SectionFits( IndexHeader->ExportsOffset,  IndexHeader->NumberOfExports,  sizeof( Export ) )  ||
+		 !SectionFits( IndexHeader->NamesOffset,    IndexHeader->NumberOfNames,    sizeof( Name ) )    ||
+		 !SectionFits( IndexHeader->PostingsOffset, IndexHeader->NumberOfPostings, sizeof( Posting ) ) ||
+		 !SectionFits( IndexHeader->StringsOffset,  IndexHeader->StringsSize,      1 )                 ||
+		 IndexHeader->StringsSize == 0 ||
+		 Base[ IndexHeader->StringsOffset + IndexHeader->StringsSize - 1 ] != '\0' )
+	{
+		printf( "Index file is damaged\n" );
+		this->Close();
+		return false;
+	}
+
+	this->Contents = IndexHeader;
+	this->Images   = (const Image*)( Base + IndexHeader->ImagesOffset );
+	this->Exports  = (const Export*)( Base + IndexHeader->ExportsOffset );
+	this->Names    = (const Name*)( Base + IndexHeader->NamesOffset );
+	this->Postings = (const Posting*)( Base + IndexHeader->PostingsOffset );
+	this->Strings  = (const char*)( Base + IndexHeader->StringsOffset );
+
+	for ( UINT32 ImageIndex = 0; ImageIndex < IndexHeader->NumberOfImages; ImageIndex++ )
+	{
+		const auto& Entry = this->Images[ ImageIndex ];
+
+		if ( Entry.FirstExport > IndexHeader->NumberOfExports || Entry.NumberOfExports > IndexHeader->NumberOfExports - Entry.FirstExport )
+		{
+			printf( "Index file is damaged\n" );
+			this->Close();
+			return false;
+		}
+	}
+
+	/*
+		Lookups read the image and export a posting names directly, so each
+		has to name one of its own image's exports. An index below FirstExport
+		wraps around and fails the same check.
+	*/
+	for ( UINT32 PostingIndex = 0; PostingIndex < IndexHeader->NumberOfPostings; PostingIndex++ )
+	{
+		const auto& Entry = this->Postings[ PostingIndex ];
+
+		if ( Entry.ImageIndex >= IndexHeader->NumberOfImages ||
+			 Entry.ExportIndex - this->Images[ Entry.ImageIndex ].FirstExport >= this->Images[ Entry.ImageIndex ].NumberOfExports )
+		{
+			printf( "Index file is damaged\n" );
+			this->Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ExportIndex::Close()
+{
+	this->File.Close();
+
+	this->Contents = NULL;
+	this->Images   = NULL;
+	this->Exports  = NULL;
+	this->Names    = NULL;
+	this->Postings = NULL;
+	this->Strings  = NULL;
+}
+
+const ExportIndex::Name* ExportIndex::FindName(
+	_In_ std::string_view Text
+) const
+{
+	UINT32 Low  = 0;
+	UINT32 High = this->Contents->NumberOfNames;
+
+	while ( Low < High )
+	{
+		const auto Middle = Low + ( High - Low ) / 2;
+
+		if ( this->GetString( this->Names[ Middle ].StringOffset ) < Text )
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+
+	if ( Low < this->Contents->NumberOfNames && this->GetString( this->Names[ Low ].StringOffset ) == Text )
+		return &this->Names[ Low ];
+
+	return NULL;
+}
+
+std::pair< const ExportIndex::Posting*, UINT32 > ExportIndex::GetPostings(
+	_In_ const Name& Entry
+) const
+{
+	if ( Entry.FirstPosting > this->Contents->NumberOfPostings || Entry.NumberOfPostings > this->Contents->NumberOfPostings - Entry.FirstPosting )
+		return { NULL, 0 };
+
+	return { this->Postings + Entry.FirstPosting, Entry.NumberOfPostings };
+}
+
+namespace
+{
+	struct PendingImage
+	{
+		std::filesystem::path     Path;
+		std::string               PathText;
+		UINT64                    FileSize      = 0;
+		INT64                     LastWriteTime = 0;
+		const ExportIndex::Image* Previous      = NULL;
+		ExportTable               Table;
+		bool                      Parsed        = false;
+	};
+}
+
+bool ExportIndex::Build(
+	_In_  const std::filesystem::path&                Path,
+	_In_  const std::vector< std::filesystem::path >& DLLPaths,
+	_In_  SIZE_T                                      NumberOfJobs,
+	_Out_ BuildStats*                                 Stats
+)
+{
+	BuildStats  LocalStats;
+	ExportIndex Previous;
+
+	std::error_code Error;
+
+	if ( std::filesystem::exists( Path, Error ) && !Previous.Open( Path ) )
+		printf( "Rebuilding %s from scratch\n", Path.string().c_str() );
+
+	std::unordered_map< std::string_view, UINT32 > PreviousImages;
+
+	if ( Previous.IsOpen() )
+	{
+		for ( UINT32 ImageIndex = 0; ImageIndex < Previous.GetNumberOfImages(); ImageIndex++ )
+			PreviousImages.emplace( Previous.GetString( Previous.GetImage( ImageIndex ).PathOffset ), ImageIndex );
+	}
+
+	/* Only DLLs that are new or changed since the last build get parsed */
+	std::vector< PendingImage > Pending( DLLPaths.size() );
+
+	{
+		ThreadPool Pool( NumberOfJobs );
+
+		for ( SIZE_T Index = 0; Index < DLLPaths.size(); Index++ )
+		{
+			auto& Entry = Pending[ Index ];
+
+			Entry.Path          = DLLPaths[ Index ];
+			Entry.PathText      = Entry.Path.string();
+			Entry.FileSize      = std::filesystem::file_size( Entry.Path, Error );
+			Entry.LastWriteTime = (INT64)std::filesystem::last_write_time( Entry.Path, Error ).time_since_epoch().count();
+
+			const auto Found = PreviousImages.find( Entry.PathText );
+
+			if ( Found != PreviousImages.end() )
+			{
+				const auto& Candidate = Previous.GetImage( Found->second );
+
+				if ( Candidate.FileSize == Entry.FileSize && Candidate.LastWriteTime == Entry.LastWriteTime )
+				{
+					Entry.Previous = &Candidate;
+					continue;
+				}
+			}
+
+			Pool.Submit( [ &Entry ]()
+			{
+				PEImage Image;
+
+				Entry.Parsed = Image.Open( Entry.Path ) && ExportEntry::GetExportEntries( Image, Entry.Table, false, NULL );
+			} );
+		}
+
+		Pool.Wait();
+	}
+
+	/*
+		Strings are pooled and deduplicated across every image. Views point into
+		the previous index mapping or the parsed tables, both outlive the build.
+	*/
+	std::vector< char >                            StringPool( 1, '\0' );
+	std::unordered_map< std::string_view, UINT32 > StringOffsets;
+	std::vector< std::string_view >                NameTexts;
+	std::unordered_map< std::string_view, UINT32 > NameIds;
+
+	const auto AddString = [ & ]( std::string_view Text ) -> UINT32
+	{
+		if ( Text.size() == 0 )
+			return 0;
+
+		const auto Inserted = StringOffsets.try_emplace( Text, (UINT32)StringPool.size() );
+
+		if ( Inserted.second )
+		{
+			StringPool.insert( StringPool.end(), Text.begin(), Text.end() );
+			StringPool.push_back( '\0' );
+		}
+
+		return Inserted.first->second;
+	};
+
+	const auto AddName = [ & ]( std::string_view Text ) -> UINT32
+	{
+		const auto Inserted = NameIds.try_emplace( Text, (UINT32)NameTexts.size() );
+
+		if ( Inserted.second )
+			NameTexts.push_back( Text );
+
+		return Inserted.first->second;
+	};
+
+	std::vector< Image >  NewImages;
+	std::vector< Export > NewExports;
+
+	NewImages.reserve( Pending.size() );
+
+	for ( const auto& Entry : Pending )
+	{
+		Image NewImage = {};
+
+		NewImage.FileSize      = Entry.FileSize;
+		NewImage.LastWriteTime = Entry.LastWriteTime;
+		NewImage.PathOffset    = AddString( Entry.PathText );
+		NewImage.FirstExport   = (UINT32)NewExports.size();
+
+		if ( Entry.Previous != NULL )
+		{
+			const auto& Old = *Entry.Previous;
+
+			for ( UINT32 RowIndex = Old.FirstExport; RowIndex < Old.FirstExport + Old.NumberOfExports; RowIndex++ )
+			{
+				auto NewExport = Previous.GetExport( RowIndex );
+
+				NewExport.NameId          = NewExport.NameId == NoName ? NoName : AddName( Previous.GetName( NewExport ) );
+				NewExport.ForwarderOffset = AddString( Previous.GetString( NewExport.ForwarderOffset ) );
+
+				NewExports.push_back( NewExport );
+			}
+
+			NewImage.TimeDateStamp = Old.TimeDateStamp;
+			NewImage.OrdinalBase   = Old.OrdinalBase;
+			NewImage.Machine       = Old.Machine;
+			NewImage.Flags         = Old.Flags;
+
+			LocalStats.Reused++;
+		}
+		else if ( Entry.Parsed )
+		{
+			for ( const auto& Row : Entry.Table )
+			{
+				Export NewExport;
+
+				NewExport.NameId          = Row.HasName() ? AddName( Row.GetName() ) : NoName;
+				NewExport.Ordinal         = Row.GetOrdinal();
+				NewExport.RVA             = Row.GetRVA();
+				NewExport.ForwarderOffset = AddString( Row.GetForwardedName() );
+				NewExport.Flags           = Row.IsData() ? ExportFlagData : 0;
+
+				NewExports.push_back( NewExport );
+			}
+
+			NewImage.TimeDateStamp = Entry.Table.GetTimeDateStamp();
+			NewImage.OrdinalBase   = Entry.Table.GetOrdinalBase();
+			NewImage.Machine       = Entry.Table.GetMachine();
+
+			LocalStats.Parsed++;
+		}
+		else
+		{
+			NewImage.Flags = ImageFlagFailed;
+
+			LocalStats.Parsed++;
+		}
+
+		if ( NewImage.Flags & ImageFlagFailed )
+			LocalStats.Failed++;
+
+		NewImage.NumberOfExports = (UINT32)NewExports.size() - NewImage.FirstExport;
+		NewImages.push_back( NewImage );
+	}
+
+	/* Sort the dictionary, then bucket every named export under its name in image order */
+	std::vector< UINT32 > Order( NameTexts.size() );
+	std::vector< UINT32 > Remap( NameTexts.size() );
+
+	std::iota( Order.begin(), Order.end(), 0 );
+	std::sort( Order.begin(), Order.end(), [ &NameTexts ]( UINT32 Left, UINT32 Right )
+	{
+		return NameTexts[ Left ] < NameTexts[ Right ];
+	} );
+
+	std::vector< Name > NewNames( NameTexts.size() );
+
+	for ( UINT32 NameIndex = 0; NameIndex < Order.size(); NameIndex++ )
+	{
+		Remap[ Order[ NameIndex ] ]          = NameIndex;
+		NewNames[ NameIndex ].StringOffset = AddString( NameTexts[ Order[ NameIndex ] ] );
+	}
+
+	for ( auto& NewExport : NewExports )
+	{
+		if ( NewExport.NameId != NoName )
+		{
+			NewExport.NameId = Remap[ NewExport.NameId ];
+			NewNames[ NewExport.NameId ].NumberOfPostings++;
+		}
+	}
+
+	UINT32 NumberOfPostings = 0;
+
+	for ( auto& NewName : NewNames )
+	{
+		NewName.FirstPosting = NumberOfPostings;
+		NumberOfPostings    += NewName.NumberOfPostings;
+		NewName.NumberOfPostings = 0;
+	}
+
+	std::vector< Posting > NewPostings( NumberOfPostings );
+
+	for ( UINT32 ImageIndex = 0; ImageIndex < NewImages.size(); ImageIndex++ )
+	{
+		const auto& NewImage = NewImages[ ImageIndex ];
+
+		for ( UINT32 RowIndex = NewImage.FirstExport; RowIndex < NewImage.FirstExport + NewImage.NumberOfExports; RowIndex++ )
+		{
+			const auto NameId = NewExports[ RowIndex ].NameId;
+
+			if ( NameId == NoName )
+				continue;
+
+			auto& NewName = NewNames[ NameId ];
+
+			NewPostings[ NewName.FirstPosting + NewName.NumberOfPostings++ ] = { ImageIndex, RowIndex };
+		}
+	}
+
+	Header IndexHeader = {};
+
+	memcpy( IndexHeader.Magic, IndexMagic, sizeof( IndexMagic ) );
+
+	IndexHeader.Version          = ExportIndex::Version;
+	IndexHeader.NumberOfImages   = (UINT32)NewImages.size();
+	IndexHeader.NumberOfExports  = (UINT32)NewExports.size();
+	IndexHeader.NumberOfNames    = (UINT32)NewNames.size();
+	IndexHeader.NumberOfPostings = NumberOfPostings;
+	IndexHeader.ImagesOffset     = AlignSection( sizeof( Header ) );
+	IndexHeader.ExportsOffset    = AlignSection( IndexHeader.ImagesOffset   + NewImages.size()   * sizeof( Image ) );
+	IndexHeader.NamesOffset      = AlignSection( IndexHeader.ExportsOffset  + NewExports.size()  * sizeof( Export ) );
+	IndexHeader.PostingsOffset   = AlignSection( IndexHeader.NamesOffset    + NewNames.size()    * sizeof( Name ) );
+	IndexHeader.StringsOffset    = AlignSection( IndexHeader.PostingsOffset + NewPostings.size() * sizeof( Posting ) );
+	IndexHeader.StringsSize      = StringPool.size();
+
+	std::vector< char > Output( IndexHeader.StringsOffset + IndexHeader.StringsSize, 0 );
+
+	memcpy( Output.data(), &IndexHeader, sizeof( IndexHeader ) );
+	memcpy( Output.data() + IndexHeader.ImagesOffset,   NewImages.data(),   NewImages.size()   * sizeof( Image ) );
+	memcpy( Output.data() + IndexHeader.ExportsOffset,  NewExports.data(),  NewExports.size()  * sizeof( Export ) );
+	memcpy( Output.data() + IndexHeader.NamesOffset,    NewNames.data(),    NewNames.size()    * sizeof( Name ) );
+	memcpy( Output.data() + IndexHeader.PostingsOffset, NewPostings.data(), NewPostings.size() * sizeof( Posting ) );
+	memcpy( Output.data() + IndexHeader.StringsOffset,  StringPool.data(),  StringPool.size() );
+
+	LocalStats.Exports = NewExports.size();
+	LocalStats.Names   = NewNames.size();
+	LocalStats.Bytes   = Output.size();
+
+	if ( Stats != NULL )
+		*Stats = LocalStats;
+
+	/* The old mapping has to go before it can be replaced, write beside it and swap */
+	Previous.Close();
+
+	/* Unique per process and call like OutputBuffer, two builds of the same index never share a temporary */
+	static std::atomic< UINT64 > NextTemporary( 0 );
+
+	auto TemporaryPath = Path;
+
+	TemporaryPath += ".tmp" + std::to_string( RunStats::Now() ) + "_" + std::to_string( NextTemporary.fetch_add( 1 ) );
+
+	{
+		std::ofstream IndexFile( TemporaryPath, std::ios::binary | std::ios::trunc );
+
+		if ( !IndexFile.is_open() )
+		{
+			printf( "Failed to open file %s\n", TemporaryPath.string().c_str() );
+			return false;
+		}
+
+		IndexFile.write( Output.data(), Output.size() );
+		IndexFile.close();
+
+		if ( IndexFile.fail() )
+		{
+			printf( "Failed to write index %s\n", TemporaryPath.string().c_str() );
+			std::filesystem::remove( TemporaryPath, Error );
+			return false;
+		}
+	}
+
+	std::filesystem::rename( TemporaryPath, Path, Error );
+
+	if ( Error )
+	{
+		printf( "Failed to replace index %s\n", Path.string().c_str() );
+		std::filesystem::remove( TemporaryPath, Error );
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
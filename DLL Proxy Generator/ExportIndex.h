@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Platform.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+/*
+	Binary index over the exports of many DLLs, mapped and queried in place.
+
+	Layout, every section is an array of fixed size records and all strings
+	live in one pool referenced by offset:
+
+		Header
+		Image[ NumberOfImages ]     one per DLL, owning a contiguous run of exports
+		Export[ NumberOfExports ]   grouped by image, in ordinal order
+		Name[ NumberOfNames ]       every distinct export name, sorted by bytes
+		Posting[ NumberOfPostings ] per name, the named exports in image order
+		Strings                     null terminated, offset 0 is the empty string
+
+	Rebuilding reuses the records of any DLL whose path, size and write
+	time still match the previous index instead of parsing it again.
+*/
+class ExportIndex
+{
+public:
+	static constexpr UINT32 Version = 1;
+	static constexpr UINT32 NoName  = 0xFFFFFFFF;
+
+	static constexpr UINT32 ExportFlagData  = 1;
+	static constexpr UINT16 ImageFlagFailed = 1; // No readable export table, kept so the DLL is not parsed again until it changes
+
+	struct Header
+	{
+		char   Magic[ 8 ];
+		UINT32 Version;
+		UINT32 NumberOfImages;
+		UINT32 NumberOfExports;
+		UINT32 NumberOfNames;
+		UINT32 NumberOfPostings;
+		UINT32 Reserved;
+		UINT64 ImagesOffset;
+		UINT64 ExportsOffset;
+		UINT64 NamesOffset;
+		UINT64 PostingsOffset;
+		UINT64 StringsOffset;
+		UINT64 StringsSize;
+	};
+
+	struct Image
+	{
+		UINT64 FileSize;
+		INT64  LastWriteTime;
+		UINT32 PathOffset;
+		UINT32 FirstExport;
+		UINT32 NumberOfExports;
+		UINT32 TimeDateStamp;
+		UINT32 OrdinalBase;
+		UINT16 Machine;
+		UINT16 Flags;
+	};
+
+	struct Export
+	{
+		UINT32 NameId;
+		UINT32 Ordinal;
+		UINT32 RVA;
+		UINT32 ForwarderOffset;
+		UINT32 Flags;
+	};
+
+	struct Name
+	{
+		UINT32 StringOffset;
+		UINT32 FirstPosting;
+		UINT32 NumberOfPostings;
+	};
+
+	struct Posting
+	{
+		UINT32 ImageIndex;
+		UINT32 ExportIndex;
+	};
+
+	struct BuildStats
+	{
+		SIZE_T Parsed  = 0;
+		SIZE_T Reused  = 0;
+		SIZE_T Failed  = 0;
+		SIZE_T Exports = 0;
+		SIZE_T Names   = 0;
+		SIZE_T Bytes   = 0;
+	};
+
+	/* Writes a new index for DLLPaths, reusing unchanged entries from the index already at Path */
+	static bool Build(
+		_In_  const std::filesystem::path&                Path,
+		_In_  const std::vector< std::filesystem::path >& DLLPaths,
+		_In_  SIZE_T                                      NumberOfJobs,
+		_Out_ BuildStats*                                 Stats
+	);
+
+	ExportIndex() : Contents( NULL )
+	{
+
+	}
+
+	bool Open(
+		_In_ const std::filesystem::path& Path
+	);
+
+	void Close();
+
+	bool IsOpen() const
+	{
+		return this->Contents != NULL;
+	}
+
+	UINT32 GetNumberOfImages() const
+	{
+		return this->Contents->NumberOfImages;
+	}
+
+	const Image& GetImage(
+		_In_ UINT32 Index
+	) const
+	{
+		return this->Images[ Index ];
+	}
+
+	const Export& GetExport(
+		_In_ UINT32 Index
+	) const
+	{
+		return this->Exports[ Index ];
+	}
+
+	/* Out of range offsets read as the empty string */
+	std::string_view GetString(
+		_In_ UINT32 Offset
+	) const
+	{
+		if ( Offset >= this->Contents->StringsSize )
+			return std::string_view();
+
+		return std::string_view( this->Strings + Offset );
+	}
+
+	std::string_view GetName(
+		_In_ const Export& Entry
+	) const
+	{
+		if ( Entry.NameId >= this->Contents->NumberOfNames )
+			return std::string_view();
+
+		return this->GetString( this->Names[ Entry.NameId ].StringOffset );
+	}
+
+	/* Binary search of the name dictionary, NULL if no indexed DLL exports Text */
+	const Name* FindName(
+		_In_ std::string_view Text
+	) const;
+
+	/* Postings of a name, empty if the record is damaged */
+	std::pair< const Posting*, UINT32 > GetPostings(
+		_In_ const Name& Entry
+	) const;
+
+private:
+	MappedFile     File;
+	const Header*  Contents;
+	const Image*   Images;
+	const Export*  Exports;
+	const Name*    Names;
+	const Posting* Postings;
+	const char*    Strings;
+};
\ No newline at end of file
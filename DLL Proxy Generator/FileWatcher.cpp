@@ -0,0 +1,200 @@
+#include "FileWatcher.h"
+#include <chrono>
+#include <thread>
+
+#if defined( __linux__ )
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+FileWatcher::FileWatcher()
+#if defined( __linux__ )
+	: Descriptor( inotify_init1( IN_CLOEXEC | IN_NONBLOCK ) )
+#endif
+{
+#if defined( __linux__ )
+	if ( this->Descriptor < 0 )
+		printf( "inotify unavailable, polling for changes every %u ms\n", PollMilliseconds );
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined( __linux__ )
+	if ( this->Descriptor >= 0 )
+		close( this->Descriptor );
+#elif defined( _WIN32 )
+	for ( const auto Handle : this->ChangeHandles )
+		FindCloseChangeNotification( Handle );
+#endif
+}
+
+bool FileWatcher::AddDirectory(
+	_In_ const std::filesystem::path& Directory
+)
+{
+	std::error_code Error;
+
+	auto Absolute = std::filesystem::weakly_canonical( Directory, Error );
+
+	if ( Error || !std::filesystem::is_directory( Absolute, Error ) )
+	{
+		printf( "Cant watch %s\n", Directory.string().c_str() );
+		return false;
+	}
+
+	for ( const auto& Existing : this->Directories )
+	{
+		if ( Existing == Absolute )
+			return true;
+	}
+
+	this->Directories.push_back( Absolute );
+
+#if defined( __linux__ )
+	if ( this->Descriptor >= 0 )
+	{
+		/* Close after write covers in place rebuilds, moved to covers write then rename */
+		const int Watch = inotify_add_watch( this->Descriptor, Absolute.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY );
+
+		if ( Watch < 0 )
+		{
+			printf( "Failed to watch %s\n", Absolute.string().c_str() );
+			return false;
+		}
+
+		this->Watches[ Watch ] = Absolute;
+		return true;
+	}
+#elif defined( _WIN32 )
+	const auto Handle = FindFirstChangeNotificationW( Absolute.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE );
+
+	if ( Handle == INVALID_HANDLE_VALUE )
+	{
+		printf( "Failed to watch %s\n", Absolute.string().c_str() );
+		return false;
+	}
+
+	this->ChangeHandles.push_back( Handle );
+#endif
+
+	/* Without inotify changes are found by comparing against this first scan */
+	this->Scan( Absolute, NULL );
+
+	return true;
+}
+
+void FileWatcher::Wait(
+	_Out_ std::vector< std::filesystem::path >& Changed,
+	_In_  UINT32                                QuietMilliseconds
+)
+{
+	std::set< std::filesystem::path > Pending;
+
+	Changed.clear();
+
+	while ( Pending.empty() )
+		this->Collect( PollMilliseconds, Pending );
+
+	/* Quiet only counts once every writer closed its file, up to a limit for writers that never do */
+	const auto Start = std::chrono::steady_clock::now();
+
+	while ( this->Collect( QuietMilliseconds, Pending ) || ( this->Writing.size() && std::chrono::steady_clock::now() - Start < std::chrono::milliseconds( WriteMilliseconds ) ) )
+		;
+
+	this->Writing.clear();
+
+	Changed.assign( Pending.begin(), Pending.end() );
+}
+
+bool FileWatcher::Collect(
+	_In_    UINT32                             Milliseconds,
+	_Inout_ std::set< std::filesystem::path >& Changed
+)
+{
+	const auto Before = Changed.size();
+
+#if defined( __linux__ )
+	if ( this->Descriptor >= 0 )
+	{
+		pollfd Poll = { this->Descriptor, POLLIN, 0 };
+
+		if ( poll( &Poll, 1, (int)Milliseconds ) <= 0 )
+			return false;
+
+		alignas( inotify_event ) char Events[ 16 * 1024 ];
+		ssize_t                       Length;
+
+		/* Every event names the file inside the watched directory, no scan needed */
+		while ( ( Length = read( this->Descriptor, Events, sizeof( Events ) ) ) > 0 )
+		{
+			for ( char* Cursor = Events; Cursor < Events + Length; )
+			{
+				const auto Event = (const inotify_event*)Cursor;
+				const auto Watch = this->Watches.find( Event->wd );
+
+				if ( Event->len != 0 && Watch != this->Watches.end() )
+				{
+					const auto Path = Watch->second / Event->name;
+
+					/* A file modified but not yet closed is still being written */
+					if ( Event->mask & IN_MODIFY )
+						this->Writing.insert( Path );
+					else
+						this->Writing.erase( Path );
+
+					Changed.insert( Path );
+				}
+
+				Cursor += sizeof( inotify_event ) + Event->len;
+			}
+		}
+
+		return Changed.size() != Before;
+	}
+#endif
+
+#if defined( _WIN32 )
+	const auto Count  = (DWORD)std::min< SIZE_T >( this->ChangeHandles.size(), MAXIMUM_WAIT_OBJECTS );
+	const auto Result = Count ? WaitForMultipleObjects( Count, this->ChangeHandles.data(), FALSE, Milliseconds ) : WAIT_TIMEOUT;
+
+	/* Past MAXIMUM_WAIT_OBJECTS directories the timeout doubles as the poll */
+	if ( Result >= WAIT_OBJECT_0 && Result < WAIT_OBJECT_0 + Count )
+		FindNextChangeNotification( this->ChangeHandles[ Result - WAIT_OBJECT_0 ] );
+	else if ( this->ChangeHandles.size() <= MAXIMUM_WAIT_OBJECTS )
+		return false;
+#else
+	std::this_thread::sleep_for( std::chrono::milliseconds( Milliseconds ) );
+#endif
+
+	for ( const auto& Directory : this->Directories )
+		this->Scan( Directory, &Changed );
+
+	return Changed.size() != Before;
+}
+
+void FileWatcher::Scan(
+	_In_    const std::filesystem::path&       Directory,
+	_Inout_ std::set< std::filesystem::path >* Changed
+)
+{
+	std::error_code Error;
+
+	for ( const auto& Entry : std::filesystem::directory_iterator( Directory, Error ) )
+	{
+		if ( !Entry.is_regular_file( Error ) )
+			continue;
+
+		const Stamp Current = { (UINT64)Entry.file_size( Error ), Entry.last_write_time( Error ) };
+		auto&       Known   = this->Stamps[ Entry.path() ];
+
+		if ( Known.Size == Current.Size && Known.WriteTime == Current.WriteTime )
+			continue;
+
+		Known = Current;
+
+		if ( Changed != NULL )
+			Changed->insert( Entry.path() );
+	}
+}
\ No newline at end of file
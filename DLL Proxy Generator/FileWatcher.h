@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Platform.h"
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+	Reports files that change inside a set of watched directories.
+
+	Directories are watched rather than files so a build that writes a new
+	DLL next to the old one and renames it over the top is still seen. Linux
+	gets the changed names straight from inotify. Windows wakes on a change
+	notification and other platforms on a timer, both then compare size and
+	write time of every file against the previous scan.
+*/
+class FileWatcher
+{
+public:
+	static constexpr UINT32 PollMilliseconds  = 250;
+	static constexpr UINT32 WriteMilliseconds = 5000;
+
+	FileWatcher();
+
+	~FileWatcher();
+
+	FileWatcher( const FileWatcher& ) = delete;
+	FileWatcher& operator=( const FileWatcher& ) = delete;
+
+	/* Adding the same directory twice is harmless */
+	bool AddDirectory(
+		_In_ const std::filesystem::path& Directory
+	);
+
+	/*
+		Blocks until a file changes, then keeps collecting until
+		QuietMilliseconds pass without another change so a linker writing a
+		DLL in several steps triggers one regeneration, not one per write.
+		Where the platform reports it, files still open for writing hold the
+		wait open for up to WriteMilliseconds.
+	*/
+	void Wait(
+		_Out_ std::vector< std::filesystem::path >& Changed,
+		_In_  UINT32                                QuietMilliseconds
+	);
+
+private:
+	struct Stamp
+	{
+		UINT64                          Size;
+		std::filesystem::file_time_type WriteTime;
+	};
+
+	/* Waits up to Milliseconds and adds whatever changed meanwhile, true if anything did */
+	bool Collect(
+		_In_    UINT32                             Milliseconds,
+		_Inout_ std::set< std::filesystem::path >& Changed
+	);
+
+	/* Adds files whose size or write time differ from the previous scan of Directory */
+	void Scan(
+		_In_    const std::filesystem::path&       Directory,
+		_Inout_ std::set< std::filesystem::path >* Changed
+	);
+
+	std::vector< std::filesystem::path >     Directories;
+	std::map< std::filesystem::path, Stamp > Stamps;
+	std::set< std::filesystem::path >        Writing;
+#if defined( __linux__ )
+	int                                      Descriptor;
+	std::map< int, std::filesystem::path >   Watches;
+#elif defined( _WIN32 )
+	std::vector< HANDLE >                    ChangeHandles;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "ForwarderResolver.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+ForwarderResolver::ForwarderResolver(
+	_In_ const std::filesystem::path& SearchDirectory
+)
+{
+	if ( SearchDirectory.empty() )
+		return;
+
+	/* Forwarders name modules without extension and in any case, index the directory once to match them */
+	std::error_code Error;
+
+	for ( const auto& Entry : std::filesystem::directory_iterator( SearchDirectory, Error ) )
+	{
+		if ( !Entry.is_regular_file( Error ) )
+			continue;
+
+		auto Name = ToLower( Entry.path().filename().string() );
+
+		if ( Name.size() > 4 && Name.compare( Name.size() - 4, 4, ".dll" ) == 0 )
+			this->ModulePaths.emplace( Name.substr( 0, Name.size() - 4 ), Entry.path() );
+	}
+
+	if ( Error )
+		printf( "Failed to list forwarder search directory %s\n", SearchDirectory.string().c_str() );
+}
+
+bool ForwarderResolver::LoadApiSetSchema(
+	_In_ const std::filesystem::path& Path
+)
+{
+	std::ifstream SchemaFile( Path );
+
+	if ( !SchemaFile.is_open() )
+	{
+		printf( "Failed to open API set schema %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	std::string Line;
+
+	while ( std::getline( SchemaFile, Line ) )
+	{
+		const auto Separator = Line.find( '=' );
+
+		if ( Line.size() == 0 || Line[ 0 ] == '#' || Separator == std::string::npos )
+			continue;
+
+		auto Trim = []( std::string Text )
+		{
+			while ( Text.size() && isspace( (unsigned char)Text.back() ) )
+				Text.pop_back();
+
+			Text.erase( 0, std::min( Text.size(), Text.find_first_not_of( " \t" ) ) );
+
+			return Text;
+		};
+
+		auto Name = Trim( Line.substr( 0, Separator ) );
+		auto Host = Trim( Line.substr( Separator + 1 ) );
+
+		if ( Host.size() > 4 && ToLower( Host.substr( Host.size() - 4 ) ) == ".dll" )
+			Host.resize( Host.size() - 4 );
+
+		if ( Name.size() && Host.size() )
+			this->ApiSets[ GetApiSetKey( Name ) ] = Host;
+	}
+
+	return true;
+}
+
+std::string ForwarderResolver::ToLower(
+	_In_ std::string_view Text
+)
+{
+	std::string Lower( Text );
+
+	for ( auto& Character : Lower )
+		Character = (char)tolower( (unsigned char)Character );
+
+	return Lower;
+}
+
+std::string ForwarderResolver::GetApiSetKey(
+	_In_ std::string_view Name
+)
+{
+	auto Key = ToLower( Name );
+	auto Dash = Key.rfind( '-' );
+
+	if ( Dash != std::string::npos && Dash + 1 < Key.size() && std::all_of( Key.begin() + Dash + 1, Key.end(), ::isdigit ) )
+		Key.resize( Dash );
+
+	return Key;
+}
+
+const ForwarderResolver::Module* ForwarderResolver::GetModule(
+	_In_ const std::string& Name
+)
+{
+	const auto Cached = this->Modules.find( Name );
+
+	if ( Cached != this->Modules.end() )
+		return Cached->second.get();
+
+	auto& Slot = this->Modules[ Name ];
+	auto  Path = this->ModulePaths.find( Name );
+
+	if ( Path == this->ModulePaths.end() )
+		return NULL;
+
+	auto Loaded = std::make_unique< Module >();
+
+	if ( !ExportEntry::GetExportEntries( Path->second, Loaded->Table, false, NULL ) )
+		return NULL;
+
+	/* Names are views into the table's pool which lives as long as the module */
+	for ( SIZE_T Index = 0; Index < Loaded->Table.size(); Index++ )
+	{
+		const auto Export = Loaded->Table[ Index ];
+
+		if ( Export.HasName() )
+			Loaded->Names.emplace( Export.GetName(), (UINT32)Index );
+
+		Loaded->Ordinals.emplace( Export.GetOrdinal(), (UINT32)Index );
+	}
+
+	Slot = std::move( Loaded );
+
+	return Slot.get();
+}
+
+std::string ForwarderResolver::Resolve(
+	_In_ std::string_view Forwarder
+)
+{
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	return this->ResolveLocked( std::string( Forwarder ) );
+}
+
+std::string ForwarderResolver::ResolveLocked(
+	_In_ const std::string& Forwarder
+)
+{
+	std::vector< std::string > Chain;
+	std::string                Current = Forwarder;
+
+	for ( int Hop = 0; Hop < MaxHops; Hop++ )
+	{
+		const auto Memoized = this->Resolved.find( Current );
+
+		if ( Memoized != this->Resolved.end() )
+		{
+			Current = Memoized->second;
+			break;
+		}
+
+		/* Like the loader split at the first dot, module names in forwarders never carry an extension */
+		const auto Dot = Current.find( '.' );
+
+		if ( Dot == std::string::npos || Dot + 1 == Current.size() )
+			break;
+
+		const auto ModuleName = ToLower( std::string_view( Current ).substr( 0, Dot ) );
+		const auto ExportName = std::string_view( Current ).substr( Dot + 1 );
+
+		std::string Next;
+
+		if ( ModuleName.compare( 0, 4, "api-" ) == 0 || ModuleName.compare( 0, 4, "ext-" ) == 0 )
+		{
+			const auto ApiSet = this->ApiSets.find( GetApiSetKey( ModuleName ) );
+
+			if ( ApiSet == this->ApiSets.end() )
+				break;
+
+			Next = ApiSet->second + "." + std::string( ExportName );
+		}
+		else
+		{
+			const auto Target = this->GetModule( ModuleName );
+
+			if ( Target == NULL )
+				break;
+
+			UINT32 Index = 0;
+
+			if ( ExportName[ 0 ] == '#' )
+			{
+				const auto Found = Target->Ordinals.find( (UINT32)strtoul( ExportName.data() + 1, NULL, 10 ) );
+
+				if ( Found == Target->Ordinals.end() )
+					break;
+
+				Index = Found->second;
+			}
+			else
+			{
+				const auto Found = Target->Names.find( ExportName );
+
+				if ( Found == Target->Names.end() )
+					break;
+
+				Index = Found->second;
+			}
+
+			const auto Export = Target->Table[ Index ];
+
+			/* Implemented here, Current is the end of the chain. Prefer the name over an ordinal that may move between builds */
+			if ( !Export.IsForwarded() )
+			{
+				if ( ExportName[ 0 ] == '#' && Export.HasName() )
+					Current = Current.substr( 0, Dot + 1 ) + std::string( Export.GetName() );
+
+				break;
+			}
+
+			Next = Export.GetForwardedName();
+		}
+
+		if ( Next == Current || std::find( Chain.begin(), Chain.end(), Next ) != Chain.end() )
+		{
+			printf( "Warning forwarder cycle through %s, keeping %s\n", Next.c_str(), Forwarder.c_str() );
+
+			this->Resolved[ Forwarder ] = Forwarder;
+			return Forwarder;
+		}
+
+		Chain.push_back( Current );
+		Current = std::move( Next );
+	}
+
+	for ( const auto& Hop : Chain )
+		this->Resolved[ Hop ] = Current;
+
+	return Current;
+}
+
+SIZE_T ForwarderResolver::Collapse(
+	_Inout_ ExportTable& Entries
+)
+{
+	std::lock_guard< std::mutex > Guard( this->Lock );
+
+	SIZE_T Collapsed = 0;
+
+	for ( SIZE_T Index = 0; Index < Entries.size(); Index++ )
+	{
+		const auto Export = Entries[ Index ];
+
+		if ( !Export.IsForwarded() )
+			continue;
+
+		auto Forwarder = std::string( Export.GetForwardedName() );
+		auto Target    = this->ResolveLocked( Forwarder );
+
+		if ( Target != Forwarder )
+		{
+			Entries.SetForwardedName( Index, Target );
+			Collapsed++;
+		}
+	}
+
+	return Collapsed;
+}
\ No newline at end of file
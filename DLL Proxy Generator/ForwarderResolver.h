@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Platform.h"
+#include "ExportEntry.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+	Follows forwarder chains like kernel32 -> kernelbase -> ntdll through the
+	DLLs in a search directory so a proxy can forward straight to the module
+	that implements an export. API set contracts are mapped to their host
+	with a schema file of "api-set-name = host" lines.
+
+	Modules are parsed on first use and every resolved forwarder is memoized,
+	so a batch over many DLLs walks each hop once. Safe to share between
+	threads.
+*/
+class ForwarderResolver
+{
+public:
+	static const int MaxHops = 32;
+
+	ForwarderResolver(
+		_In_ const std::filesystem::path& SearchDirectory
+	);
+
+	bool LoadApiSetSchema(
+		_In_ const std::filesystem::path& Path
+	);
+
+	/* Final "MODULE.Export" or "MODULE.#Ordinal" for Forwarder, unchanged if nothing is known about the target */
+	std::string Resolve(
+		_In_ std::string_view Forwarder
+	);
+
+	/* Rewrites every forwarded export of Entries to its resolved target, returns how many changed */
+	SIZE_T Collapse(
+		_Inout_ ExportTable& Entries
+	);
+
+private:
+	struct Module
+	{
+		ExportTable                                    Table;
+		std::unordered_map< std::string_view, UINT32 > Names;
+		std::unordered_map< UINT32, UINT32 >           Ordinals;
+	};
+
+	static std::string ToLower(
+		_In_ std::string_view Text
+	);
+
+	/* API set names match regardless of the trailing version number, like the loader */
+	static std::string GetApiSetKey(
+		_In_ std::string_view Name
+	);
+
+	const Module* GetModule(
+		_In_ const std::string& Name
+	);
+
+	std::string ResolveLocked(
+		_In_ const std::string& Forwarder
+	);
+
+	std::unordered_map< std::string, std::filesystem::path >   ModulePaths;
+	std::unordered_map< std::string, std::string >             ApiSets;
+	std::unordered_map< std::string, std::unique_ptr<Module> > Modules;
+	std::unordered_map< std::string, std::string >             Resolved;
+	std::mutex                                                 Lock;
+};
\ No newline at end of file
@@ -0,0 +1,390 @@
+#pragma once
+
+#include "Export Generator.h"
+#include "COFFWriter.h"
+#include "PEWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/*
+	Writes the import library for a DLL with the given exports, laid out
+	like lib /def makes it. Three small objects build the import descriptor
+	and its terminators, then each export is a 20 byte short import header
+	the linker expands into the thunk and IAT slot itself.
+
+	Named exports are imported by name with a hint into the sorted name
+	table, NONAME ones by ordinal under the Ordinal_<N> symbol the stub
+	generators use. Data exports only get the __imp_ symbol.
+*/
+class ImportLibraryGenerator : public ExportGenerator
+{
+public:
+	ImportLibraryGenerator(
+		_In_ std::filesystem::path Path,
+		_In_ const std::string&    DLLName
+	) :	ExportGenerator( Path, true ), DLLName( DLLName ), MachineType( 0 )
+	{
+
+	}
+
+	virtual bool Begin(
+		_In_opt_ UINT16 MachineType,
+		_In_opt_ SIZE_T NumberOfEntries
+	)
+	{
+		switch ( MachineType )
+		{
+			case IMAGE_FILE_MACHINE_AMD64:
+			case IMAGE_FILE_MACHINE_I386:
+			case IMAGE_FILE_MACHINE_ARM64:
+				break;
+			default:
+				printf( "Unknown machine type %04X\n", MachineType );
+				return false;
+		}
+
+		this->MachineType = MachineType;
+		this->Imports.reserve( NumberOfEntries );
+
+		return true;
+	}
+
+	virtual bool End()
+	{
+		std::vector< Member > Members;
+
+		this->AddDescriptorMembers( Members );
+		this->AddImportMembers( Members );
+
+		std::string Archive;
+
+		this->WriteArchive( Members, Archive );
+
+		File << std::string_view( Archive );
+		return true;
+	}
+
+	virtual bool AddExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& SymbolName
+	)
+	{
+		this->Imports.push_back( { SymbolName, Export.HasName(), (UINT16)Export.GetOrdinal(), Export.IsData(), 0 } );
+
+		return true;
+	}
+
+	virtual bool AddForwardedExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& DLLNameToForwardTo
+	)
+	{
+		if ( Export.HasName() )
+			this->Imports.push_back( { std::string( Export.GetName() ), true, (UINT16)Export.GetOrdinal(), Export.IsData(), 0 } );
+		else
+			this->Imports.push_back( { "Ordinal_" + std::to_string( Export.GetOrdinal() ), false, (UINT16)Export.GetOrdinal(), Export.IsData(), 0 } );
+
+		return true;
+	}
+
+private:
+	/* IMPORT_OBJECT_TYPE and IMPORT_OBJECT_NAME_TYPE from winnt.h */
+	enum
+	{
+		ImportCode         = 0,
+		ImportData         = 1,
+		ImportNameOrdinal  = 0,
+		ImportName         = 1,
+		ImportNameNoPrefix = 2,
+	};
+
+	struct Import
+	{
+		std::string Name;
+		bool        HasName;
+		UINT16      Ordinal;
+		bool        IsData;
+		UINT16      Hint;
+	};
+
+	struct Member
+	{
+		std::string                Data;
+		std::vector< std::string > Symbols;
+	};
+
+	std::string GetFileName() const
+	{
+		return this->DLLName + ".dll";
+	}
+
+	UINT16 GetRVARelocation() const
+	{
+		switch ( this->MachineType )
+		{
+			case IMAGE_FILE_MACHINE_AMD64: return IMAGE_REL_AMD64_ADDR32NB;
+			case IMAGE_FILE_MACHINE_ARM64: return IMAGE_REL_ARM64_ADDR32NB;
+			default:                       return IMAGE_REL_I386_DIR32NB;
+		}
+	}
+
+	/* __IMPORT_DESCRIPTOR_<DLL> pulls in the other two, the linker concatenates the .idata$N groups in order */
+	void AddDescriptorMembers(
+		_Inout_ std::vector< Member >& Members
+	)
+	{
+		const auto        PointerSize    = ( this->MachineType == IMAGE_FILE_MACHINE_I386 ) ? sizeof( UINT32 ) : sizeof( UINT64 );
+		const auto        PointerAlign   = ( this->MachineType == IMAGE_FILE_MACHINE_I386 ) ? IMAGE_SCN_ALIGN_4BYTES : IMAGE_SCN_ALIGN_8BYTES;
+		const auto        DataFlags      = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+		const std::string DescriptorName = "__IMPORT_DESCRIPTOR_" + this->DLLName;
+		const std::string NullDescriptor = "__NULL_IMPORT_DESCRIPTOR";
+		const std::string NullThunkName  = "\x7f" + this->DLLName + "_NULL_THUNK_DATA";
+
+		{
+			COFFWriter Object( this->MachineType );
+
+			const auto Header = Object.AddSection( ".idata$2", DataFlags | IMAGE_SCN_ALIGN_4BYTES );
+			const auto Name   = Object.AddSection( ".idata$6", DataFlags | IMAGE_SCN_ALIGN_2BYTES );
+
+			Object.GetData( Header ).resize( sizeof( IMAGE_IMPORT_DESCRIPTOR ), 0 );
+			PEWriter::AppendString( Object.GetData( Name ), this->GetFileName() );
+			PEWriter::Align( Object.GetData( Name ), 2 );
+
+			Object.AddSymbol( DescriptorName, Header, 0, false );
+
+			const auto LookupTable  = Object.AddSectionReference( ".idata$4" );
+			const auto AddressTable = Object.AddSectionReference( ".idata$5" );
+
+			Object.AddExternal( NullDescriptor, false );
+			Object.AddExternal( NullThunkName, false );
+
+			Object.AddRelocation( Header, offsetof( IMAGE_IMPORT_DESCRIPTOR, Name ),       Object.GetSectionSymbol( Name ), this->GetRVARelocation() );
+			Object.AddRelocation( Header, 0,                                              LookupTable,                     this->GetRVARelocation() );
+			Object.AddRelocation( Header, offsetof( IMAGE_IMPORT_DESCRIPTOR, FirstThunk ), AddressTable,                    this->GetRVARelocation() );
+
+			Members.push_back( { "", { DescriptorName } } );
+			Object.Build( Members.back().Data );
+		}
+
+		{
+			COFFWriter Object( this->MachineType );
+
+			const auto Terminator = Object.AddSection( ".idata$3", DataFlags | IMAGE_SCN_ALIGN_4BYTES );
+
+			Object.GetData( Terminator ).resize( sizeof( IMAGE_IMPORT_DESCRIPTOR ), 0 );
+			Object.AddSymbol( NullDescriptor, Terminator, 0, false );
+
+			Members.push_back( { "", { NullDescriptor } } );
+			Object.Build( Members.back().Data );
+		}
+
+		{
+			COFFWriter Object( this->MachineType );
+
+			const auto AddressTable = Object.AddSection( ".idata$5", DataFlags | PointerAlign );
+			const auto LookupTable  = Object.AddSection( ".idata$4", DataFlags | PointerAlign );
+
+			Object.GetData( AddressTable ).resize( PointerSize, 0 );
+			Object.GetData( LookupTable ).resize( PointerSize, 0 );
+			Object.AddSymbol( NullThunkName, AddressTable, 0, false );
+
+			Members.push_back( { "", { NullThunkName } } );
+			Object.Build( Members.back().Data );
+		}
+	}
+
+	/* Only I386 C names carry the underscore, already decorated names are used as they are */
+	bool HasPrefix(
+		_In_ const std::string& Name
+	) const
+	{
+		if ( this->MachineType != IMAGE_FILE_MACHINE_I386 )
+			return false;
+
+		return Name.size() && Name[ 0 ] != '?' && Name.find( '@' ) == std::string::npos;
+	}
+
+	void AddImportMembers(
+		_Inout_ std::vector< Member >& Members
+	)
+	{
+		/* The hint is the position in the DLL's own name table, which is sorted */
+		std::vector< Import* > Named;
+
+		for ( auto& Entry : this->Imports )
+		{
+			if ( Entry.HasName )
+				Named.push_back( &Entry );
+		}
+
+		std::sort( Named.begin(), Named.end(), []( const Import* Left, const Import* Right ) { return Left->Name < Right->Name; } );
+
+		for ( SIZE_T Index = 0; Index < Named.size(); Index++ )
+			Named[ Index ]->Hint = (UINT16)Index;
+
+		const auto FileName = this->GetFileName();
+
+		for ( const auto& Entry : this->Imports )
+		{
+			const auto   Prefix   = this->HasPrefix( Entry.Name );
+			const auto   Symbol   = ( Prefix ? "_" : "" ) + Entry.Name;
+			const UINT16 NameType = !Entry.HasName ? ImportNameOrdinal : Prefix ? ImportNameNoPrefix : ImportName;
+			const UINT16 Type     = Entry.IsData ? ImportData : ImportCode;
+
+			std::vector< BYTE > Header;
+
+			PEWriter::AppendU16( Header, IMAGE_FILE_MACHINE_UNKNOWN );
+			PEWriter::AppendU16( Header, 0xFFFF );
+			PEWriter::AppendU16( Header, 0 );
+			PEWriter::AppendU16( Header, this->MachineType );
+			PEWriter::AppendU32( Header, 0 );
+			PEWriter::AppendU32( Header, (UINT32)( Symbol.size() + 1 + FileName.size() + 1 ) );
+			PEWriter::AppendU16( Header, Entry.HasName ? Entry.Hint : Entry.Ordinal );
+			PEWriter::AppendU16( Header, (UINT16)( Type | ( NameType << 2 ) ) );
+			PEWriter::AppendString( Header, Symbol );
+			PEWriter::AppendString( Header, FileName );
+
+			Member Import = { std::string( Header.begin(), Header.end() ), { "__imp_" + Symbol } };
+
+			if ( !Entry.IsData )
+				Import.Symbols.push_back( Symbol );
+
+			Members.push_back( std::move( Import ) );
+		}
+	}
+
+	static void AppendU32BE(
+		_Inout_ std::string& Data,
+		_In_    UINT32       Value
+	)
+	{
+		Data.push_back( (char)( Value >> 24 ) );
+		Data.push_back( (char)( Value >> 16 ) );
+		Data.push_back( (char)( Value >> 8 ) );
+		Data.push_back( (char)Value );
+	}
+
+	static void AppendMemberHeader(
+		_Inout_ std::string& Archive,
+		_In_    const char*  Name,
+		_In_    SIZE_T       Size
+	)
+	{
+		char Header[ 80 ];
+
+		snprintf( Header, sizeof( Header ), "%-16s%-12s%-6s%-6s%-8s%-10zu`\n", Name, "0", "0", "0", "644", Size );
+		Archive.append( Header, 60 );
+	}
+
+	static void AppendMember(
+		_Inout_ std::string&     Archive,
+		_In_    const char*      Name,
+		_In_    std::string_view Data
+	)
+	{
+		AppendMemberHeader( Archive, Name, Data.size() );
+		Archive.append( Data );
+
+		if ( Data.size() % 2 )
+			Archive.push_back( '\n' );
+	}
+
+	/*
+		The MSVC archive layout: two symbol index members, the first big endian
+		in member order for old tools, the second little endian and sorted for
+		link.exe, then the long names member since DLL file names rarely fit
+		the 16 byte header field.
+	*/
+	void WriteArchive(
+		_In_    const std::vector< Member >& Members,
+		_Inout_ std::string&                 Archive
+	)
+	{
+		const auto FileName = this->GetFileName();
+
+		std::string LongNames;
+		std::string MemberName = FileName + "/";
+
+		if ( MemberName.size() > 16 )
+		{
+			MemberName = "/0";
+			LongNames  = FileName + "/";
+			LongNames.push_back( '\0' );
+		}
+
+		std::vector< std::pair< std::string, UINT16 > > Symbols;
+		SIZE_T                                          SymbolBytes = 0;
+
+		for ( SIZE_T Index = 0; Index < Members.size(); Index++ )
+		{
+			for ( const auto& Symbol : Members[ Index ].Symbols )
+			{
+				Symbols.emplace_back( Symbol, (UINT16)( Index + 1 ) );
+				SymbolBytes += Symbol.size() + 1;
+			}
+		}
+
+		const auto Padded = []( SIZE_T Size ) { return Size + ( Size % 2 ); };
+
+		const SIZE_T FirstSize  = sizeof( UINT32 ) + Symbols.size() * sizeof( UINT32 ) + SymbolBytes;
+		const SIZE_T SecondSize = sizeof( UINT32 ) + Members.size() * sizeof( UINT32 ) + sizeof( UINT32 ) + Symbols.size() * sizeof( UINT16 ) + SymbolBytes;
+
+		SIZE_T Offset = 8 + 60 + Padded( FirstSize ) + 60 + Padded( SecondSize );
+
+		if ( LongNames.size() )
+			Offset += 60 + Padded( LongNames.size() );
+
+		std::vector< UINT32 > MemberOffsets;
+
+		for ( const auto& Entry : Members )
+		{
+			MemberOffsets.push_back( (UINT32)Offset );
+			Offset += 60 + Padded( Entry.Data.size() );
+		}
+
+		Archive.reserve( Offset );
+		Archive += "!<arch>\n";
+
+		std::string First;
+
+		AppendU32BE( First, (UINT32)Symbols.size() );
+
+		for ( const auto& Symbol : Symbols )
+			AppendU32BE( First, MemberOffsets[ Symbol.second - 1 ] );
+
+		for ( const auto& Symbol : Symbols )
+			First.append( Symbol.first.c_str(), Symbol.first.size() + 1 );
+
+		AppendMember( Archive, "/", First );
+
+		std::sort( Symbols.begin(), Symbols.end() );
+
+		std::vector< BYTE > Second;
+
+		PEWriter::AppendU32( Second, (UINT32)Members.size() );
+
+		for ( const auto MemberOffset : MemberOffsets )
+			PEWriter::AppendU32( Second, MemberOffset );
+
+		PEWriter::AppendU32( Second, (UINT32)Symbols.size() );
+
+		for ( const auto& Symbol : Symbols )
+			PEWriter::AppendU16( Second, Symbol.second );
+
+		for ( const auto& Symbol : Symbols )
+			PEWriter::AppendString( Second, Symbol.first );
+
+		AppendMember( Archive, "/", std::string_view( (const char*)Second.data(), Second.size() ) );
+
+		if ( LongNames.size() )
+			AppendMember( Archive, "//", LongNames );
+
+		for ( const auto& Entry : Members )
+			AppendMember( Archive, MemberName.c_str(), Entry.Data );
+	}
+
+	std::string           DLLName;
+	UINT16                MachineType;
+	std::vector< Import > Imports;
+};
\ No newline at end of file
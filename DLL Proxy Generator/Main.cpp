@@ -1,5 +1,11 @@
-#include <Windows.h>
+#include "Platform.h"
 #include <fstream>
+#include <iostream>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <algorithm>
 #include <lyra/lyra.hpp>
 
 #include "ExportEntry.h"
@@ -7,38 +13,52 @@
 #include "Def File Generator.h"
 #include "Pragma File Generator.h"
 #include "Asm File Generator.h"
+#include "Obj File Generator.h"
 #include "VS Generator.h"
 #include "DLLMain Generator.h"
+#include "Manifest Generator.h"
+#include "Lib File Generator.h"
+#include "Native Proxy Generator.h"
+#include "ThreadPool.h"
+#include "ProxyCache.h"
+#include "ProxyOptions.h"
+#include "ExportIndex.h"
+#include "ExportDiff.h"
+#include "EmitPipeline.h"
+#include "RunStats.h"
+#include "FileWatcher.h"
+#include "ExportCache.h"
+#include "DaemonServer.h"
 
-void GenerateForwardedExports( 
-	_Inout_ VSGenerator&                 VSProject,
-	_In_ bool                            GenerateVSProject,
-	_In_ const std::filesystem::path&    OutDir,
-	_In_ const std::string&              DLLName,
-	_In_ const std::string&              NewDLLName,
-	_In_ const std::vector<ExportEntry>& Entries,
-	_In_ bool                            UseDefFile
+bool GenerateForwardedExports( 
+	_Inout_ EmitPipeline&                       Pipeline,
+	_Inout_ VSGenerator&                        VSProject,
+	_In_    const ProxyOptions&                 Options,
+	_In_    const std::filesystem::path&        OutDir,
+	_In_    const std::string&                  DLLName,
+	_In_    const std::string&                  NewDLLName,
+	_In_    const ExportTable*                  Source
 )
 {
 	auto LinkerGenerator = std::shared_ptr<ExportGenerator>();
-	auto MainGenerator   = DLLMainGenerator( OutDir / "DLLMain.cpp" );
+	auto MainGenerator   = std::make_shared< DLLMainGenerator >( OutDir / "DLLMain.cpp" );
 
-	if ( !MainGenerator.Open() )
+	if ( !MainGenerator->Open() )
 	{
 		printf( "Failed to open DLL Main File\n" );
-		return;
+		return false;
 	}
 
 	VSProject.AddFile<VSSourceFile>( "DLLMain.cpp" );
 
-	if ( UseDefFile )
+	if ( Options.PreferDef )
 	{
 		LinkerGenerator = std::make_shared< DefFileGenerator >( OutDir / ( DLLName + ".def" ) );
 
 		if ( !LinkerGenerator->Open() )
 		{
 			printf( "Failed to open Def File\n" );
-			return;
+			return false;
 		}
 
 		VSProject.SetDefinitionFile( DLLName + ".def" );
@@ -50,174 +70,1456 @@ void GenerateForwardedExports(
 		if ( !LinkerGenerator->Open() )
 		{
 			printf( "Failed to open Pragma Exports File\n" );
-			return;
+			return false;
 		}
 
 		VSProject.AddFile<VSHeaderFile>( DLLName + "Exports.h" );
-		MainGenerator.AddInclude( DLLName + "Exports.h" );
+		MainGenerator->AddInclude( DLLName + "Exports.h" );
 	}
 
-	if ( !LinkerGenerator->Begin( NULL, NULL ) )
+	Pipeline.AddGenerator( "emit linker exports", LinkerGenerator, 0, 0, true, NewDLLName, Source );
+	Pipeline.AddOutput( MainGenerator->GetPath() );
+
+	Pipeline.AddEmitter( "emit dllmain", [ MainGenerator ]( const std::vector< EmitPipeline::Record >& )
+	{
+		return MainGenerator->Write();
+	} );
+
+	return true;
+}
+
+bool GenerateASM(
+	_Inout_ EmitPipeline&                       Pipeline,
+	_Inout_ VSGenerator&                        VSProject,
+	_In_    const ProxyOptions&                 Options,
+	_In_    const std::filesystem::path&        OutDir,
+	_In_    const std::string&                  DLLName,
+	_In_    const ExportTable&                  Entries,
+	_In_    UINT16                              MachineType
+)
+{
+	auto LinkerGenerator = std::shared_ptr<ExportGenerator>();
+	auto MainGenerator   = std::make_shared< DLLMainGenerator >( OutDir / "DLLMain.cpp" );
+
+	/* Shard 0 keeps the unsharded name, it owns the lazy resolver thunk */
+	for ( SIZE_T ShardIndex = 0; ShardIndex < Options.AsmShards; ShardIndex++ )
+	{
+		const auto ShardSuffix = ShardIndex ? "_" + std::to_string( ShardIndex ) : "";
+
+		if ( Options.ObjectStubs )
+		{
+			auto StubName      = DLLName + "Stubs" + ShardSuffix + ".obj";
+			auto StubGenerator = std::make_shared< ObjFileGenerator >( OutDir / StubName, Options.LazyResolve, Options.Instrument, ShardIndex, Options.AsmShards );
+
+			if ( !StubGenerator->Open() )
+			{
+				printf( "Failed to open Stubs Object File\n" );
+				return false;
+			}
+
+			VSProject.AddFile<VSObjectFile>( StubName );
+			Pipeline.AddGenerator( "emit obj stubs", StubGenerator, MachineType, Entries.GetOrdinalCount(), false );
+			continue;
+		}
+
+		auto StubName      = DLLName + "ASMStubs" + ShardSuffix + ".asm";
+		auto StubGenerator = std::make_shared< ASMFileGenerator >( OutDir / StubName, Options.LazyResolve, Options.Instrument, ShardIndex, Options.AsmShards );
+
+		if ( !StubGenerator->Open() )
+		{
+			printf( "Failed to open ASMStubs File\n" );
+			return false;
+		}
+
+		VSProject.AddFile<VSMASMFile>( StubName );
+		Pipeline.AddGenerator( "emit asm stubs", StubGenerator, MachineType, Entries.GetOrdinalCount(), false );
+	}
+
+	VSProject.AddFile<VSSourceFile>( "DLLMain.cpp" );
+
+	if ( !MainGenerator->Open() )
+	{
+		printf( "Failed to open DLL Main File\n" );
+		return false;
+	}
+
+	if ( Options.PreferDef )
+	{
+		LinkerGenerator = std::make_shared< DefFileGenerator >( OutDir / ( DLLName + "Stubs.def" ) );
+
+		if ( !LinkerGenerator->Open() )
+		{
+			printf( "Failed to open Def File\n" );
+			return false;
+		}
+
+		VSProject.SetDefinitionFile( DLLName + "Stubs.def" );
+	}
+	else
+	{
+		LinkerGenerator = std::make_shared< PragmaFileGenerator >( OutDir / ( DLLName + "StubExports.h" ) );
+
+		if ( !LinkerGenerator->Open() )
+		{
+			printf( "Failed to open Pragma Exports File\n" );
+			return false;
+		}
+
+		VSProject.AddFile<VSHeaderFile>( DLLName + "StubExports.h" );
+		MainGenerator->AddInclude( DLLName + "StubExports.h" );
+	}
+
+	Pipeline.AddGenerator( "emit linker exports", LinkerGenerator, MachineType, 0, false );
+	Pipeline.AddOutput( MainGenerator->GetPath() );
+
+	const auto NumberOfSlots = Entries.GetOrdinalCount();
+
+	Pipeline.AddEmitter( "emit dllmain", [ MainGenerator, Options, DLLName, NumberOfSlots ]( const std::vector< EmitPipeline::Record >& Records )
+	{
+		MainGenerator->GetBody().Reserve( Records.size() * ( Options.LazyResolve ? 160 : 96 ) );
+		MainGenerator->AddBody( "extern \"C\" void* g_FunctionTable[];\n\n" );
+
+		/* One entry per table slot, either the export name or its ordinal, shared by both resolvers */
+		MainGenerator->AddBody( "static const char* const g_ExportNames[] =\n{\n" );
+
+		std::vector<std::pair<std::string_view, UINT32>> SortedSlots;
+		UINT32                                           NextSlot = 0;
+
+		SortedSlots.reserve( Records.size() );
+
+		for ( const auto& Record : Records )
+		{
+			const auto& Export = Record.Export;
+
+			if ( Export.IsData() )
+				continue;
+
+			for ( ; NextSlot < Export.GetOrdinalIndex(); NextSlot++ )
+				MainGenerator->AddBody( "\tNULL,\n" );
+
+			if ( Export.HasName() )
+				MainGenerator->GetBody() << "\t\"" << Export.GetName() << "\",\n";
+			else
+				MainGenerator->GetBody() << "\tMAKEINTRESOURCEA( " << Export.GetOrdinal() << " ),\n";
+
+			SortedSlots.emplace_back( Export.GetName(), Export.GetOrdinalIndex() );
+			NextSlot++;
+		}
+
+		MainGenerator->AddBody( "\tNULL\n};\n\n" );
+
+		/* Aligned so slot 0 starts a cache line and the stubs touch as few lines as possible */
+		if ( Options.LazyResolve )
+		{
+			for ( const auto& Slot : SortedSlots )
+				MainGenerator->GetBody() << "extern \"C\" void LazyEntry_" << Slot.second << "();\n";
+
+			MainGenerator->GetBody() << "\nDECLSPEC_CACHEALIGN void* g_FunctionTable[ " << NumberOfSlots << " ] =\n{\n";
+
+			NextSlot = 0;
+
+			for ( const auto& Slot : SortedSlots )
+			{
+				for ( ; NextSlot < Slot.second; NextSlot++ )
+					MainGenerator->AddBody( "\tNULL,\n" );
+
+				MainGenerator->GetBody() << "\t(void*)LazyEntry_" << Slot.second << ",\n";
+				NextSlot++;
+			}
+
+			MainGenerator->AddBody( "};\n\n" );
+		}
+		else
+		{
+			MainGenerator->GetBody() << "DECLSPEC_CACHEALIGN void* g_FunctionTable[ " << NumberOfSlots << " ];\n\n";
+		}
+
+		if ( Options.Instrument )
+		{
+			/* Counted by the stubs, dumped as "<calls> <export>" lines next to the proxy when it unloads */
+			MainGenerator->AddBody( "struct DECLSPEC_CACHEALIGN CallCounter\n{\n\tvolatile LONG64 Count;\n};\n\n" );
+			MainGenerator->GetBody() << "extern \"C\" CallCounter g_CallCounters[ " << NumberOfSlots << " ];\n";
+			MainGenerator->GetBody() << "CallCounter g_CallCounters[ " << NumberOfSlots << " ];\n\n";
+			MainGenerator->AddBody( "static void WriteNumber( HANDLE File, CHAR Prefix, ULONGLONG Value, CHAR Terminator )\n{\n" );
+			MainGenerator->AddBody( "\tCHAR  Text[ 32 ];\n\tCHAR* Cursor = Text + sizeof( Text );\n\tDWORD Written;\n\n" );
+			MainGenerator->AddBody( "\t*--Cursor = Terminator;\n\n" );
+			MainGenerator->AddBody( "\tdo\n\t{\n\t\t*--Cursor = (CHAR)( '0' + Value % 10 );\n\t\tValue /= 10;\n\t} while ( Value != 0 );\n\n" );
+			MainGenerator->AddBody( "\tif ( Prefix != 0 )\n\t\t*--Cursor = Prefix;\n\n" );
+			MainGenerator->AddBody( "\tWriteFile( File, Cursor, (DWORD)( Text + sizeof( Text ) - Cursor ), &Written, NULL );\n}\n\n" );
+			MainGenerator->AddBody( "static void DumpCallCounters( HINSTANCE Instance )\n{\n" );
+			MainGenerator->AddBody( "\tCHAR  Path[ MAX_PATH + 16 ];\n" );
+			MainGenerator->AddBody( "\tDWORD Length = GetModuleFileNameA( Instance, Path, MAX_PATH );\n\n" );
+			MainGenerator->AddBody( "\tif ( Length == 0 || Length >= MAX_PATH )\n\t\treturn;\n\n" );
+			MainGenerator->AddBody( "\tlstrcpyA( Path + Length, \".calls.txt\" );\n\n" );
+			MainGenerator->AddBody( "\tHANDLE File = CreateFileA( Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );\n\n" );
+			MainGenerator->AddBody( "\tif ( File == INVALID_HANDLE_VALUE )\n\t\treturn;\n\n" );
+			MainGenerator->AddBody( "\tfor ( SIZE_T i = 0; i < ARRAYSIZE( g_ExportNames ) - 1; i++ )\n\t{\n" );
+			MainGenerator->AddBody( "\t\tconst char* Name  = g_ExportNames[ i ];\n" );
+			MainGenerator->AddBody( "\t\tULONGLONG   Count = (ULONGLONG)g_CallCounters[ i ].Count;\n\n" );
+			MainGenerator->AddBody( "\t\tif ( Name == NULL || Count == 0 )\n\t\t\tcontinue;\n\n" );
+			MainGenerator->AddBody( "\t\tWriteNumber( File, 0, Count, ' ' );\n\n" );
+			MainGenerator->AddBody( "\t\tif ( IS_INTRESOURCE( Name ) )\n\t\t{\n" );
+			MainGenerator->AddBody( "\t\t\tWriteNumber( File, '#', (ULONG_PTR)Name, '\\n' );\n\t\t}\n" );
+			MainGenerator->AddBody( "\t\telse\n\t\t{\n\t\t\tDWORD Written;\n\n" );
+			MainGenerator->AddBody( "\t\t\tWriteFile( File, Name, lstrlenA( Name ), &Written, NULL );\n" );
+			MainGenerator->AddBody( "\t\t\tWriteFile( File, \"\\n\", 1, &Written, NULL );\n\t\t}\n\t}\n\n" );
+			MainGenerator->AddBody( "\tCloseHandle( File );\n}\n\n" );
+			MainGenerator->AddProcessDetach( "\tDumpCallCounters( (HINSTANCE)Parameter );\n" );
+		}
+
+		if ( Options.LazyResolve )
+		{
+			/* Table slots start out pointing at the per export entries in the stub files that land in ResolveExport on first call */
+			MainGenerator->AddBody( "static HMODULE g_OriginalModule = NULL;\n\n" );
+			MainGenerator->AddBody( "static HMODULE GetOriginalModule()\n{\n" );
+			MainGenerator->AddBody( "\tHMODULE Module = (HMODULE)InterlockedCompareExchangePointer( (PVOID*)&g_OriginalModule, NULL, NULL );\n\n" );
+			MainGenerator->AddBody( "\tif ( Module != NULL )\n\t\treturn Module;\n\n" );
+			MainGenerator->GetBody() << "\tModule = LoadLibraryA( \"" << DLLName << ".dll\" );\n\n";
+			MainGenerator->AddBody( "\tif ( Module == NULL )\n\t\treturn NULL;\n\n" );
+			MainGenerator->AddBody( "\t// Another thread may have won the race, drop our extra reference\n" );
+			MainGenerator->AddBody( "\tHMODULE Existing = (HMODULE)InterlockedCompareExchangePointer( (PVOID*)&g_OriginalModule, Module, NULL );\n\n" );
+			MainGenerator->AddBody( "\tif ( Existing != NULL )\n\t{\n\t\tFreeLibrary( Module );\n\t\treturn Existing;\n\t}\n\n" );
+			MainGenerator->AddBody( "\treturn Module;\n}\n\n" );
+			MainGenerator->AddBody( "// Called from LazyResolverThunk the first time a stub runs, later calls jump straight to the target\n" );
+			MainGenerator->AddBody( "extern \"C\" void* ResolveExport( SIZE_T Index )\n{\n" );
+			MainGenerator->AddBody( "\tHMODULE Module  = GetOriginalModule();\n" );
+			MainGenerator->AddBody( "\tvoid*   Address = Module != NULL ? (void*)GetProcAddress( Module, g_ExportNames[ Index ] ) : NULL;\n\n" );
+			MainGenerator->AddBody( "\tif ( Address == NULL )\n\t\tRaiseException( 0xC0000139 /* STATUS_ENTRYPOINT_NOT_FOUND */, EXCEPTION_NONCONTINUABLE, 0, NULL );\n\n" );
+			MainGenerator->AddBody( "\tInterlockedExchangePointer( &g_FunctionTable[ Index ], Address );\n\n" );
+			MainGenerator->AddBody( "\treturn Address;\n}\n" );
+		}
+		else
+		{
+			/*
+				The loader keeps its name pointer table sorted, so visiting our slots in the
+				same order lets the resolver merge against it in a single pass rather than
+				paying a binary search per GetProcAddress. Ordinal only slots sort first
+				and index the address table directly.
+			*/
+			std::sort( SortedSlots.begin(), SortedSlots.end() );
+
+			MainGenerator->AddBody( "static const WORD g_SortedSlots[] =\n{\n" );
+
+			for ( const auto& Slot : SortedSlots )
+				MainGenerator->GetBody() << "\t" << Slot.second << ",\n";
+
+			if ( SortedSlots.empty() )
+				MainGenerator->AddBody( "\t0\n" );
+
+			MainGenerator->AddBody( "};\n\n" );
+			MainGenerator->GetBody() << "static const SIZE_T g_NumberOfSlots = " << SortedSlots.size() << ";\n\n";
+
+			MainGenerator->AddBody( "void PopulateFunctionTable()\n{\n" );
+			MainGenerator->GetBody() << "\tHMODULE OriginalModule = LoadLibraryA( \"" << DLLName << ".dll\" );\n\n";
+			MainGenerator->AddBody( "\tif ( OriginalModule == NULL )\n\t\treturn;\n\n" );
+			MainGenerator->AddBody( "\tBYTE*                   ModuleBase   = (BYTE*)OriginalModule;\n" );
+			MainGenerator->AddBody( "\tPIMAGE_NT_HEADERS       NtHeaders    = (PIMAGE_NT_HEADERS)( ModuleBase + ( (PIMAGE_DOS_HEADER)ModuleBase )->e_lfanew );\n" );
+			MainGenerator->AddBody( "\tIMAGE_DATA_DIRECTORY    ExportDir    = NtHeaders->OptionalHeader.DataDirectory[ IMAGE_DIRECTORY_ENTRY_EXPORT ];\n" );
+			MainGenerator->AddBody( "\tPIMAGE_EXPORT_DIRECTORY Exports      = (PIMAGE_EXPORT_DIRECTORY)( ModuleBase + ExportDir.VirtualAddress );\n" );
+			MainGenerator->AddBody( "\tDWORD*                  Functions    = (DWORD*)( ModuleBase + Exports->AddressOfFunctions );\n" );
+			MainGenerator->AddBody( "\tDWORD*                  Names        = (DWORD*)( ModuleBase + Exports->AddressOfNames );\n" );
+			MainGenerator->AddBody( "\tWORD*                   NameOrdinals = (WORD*)( ModuleBase + Exports->AddressOfNameOrdinals );\n" );
+			MainGenerator->AddBody( "\tDWORD                   NameIndex    = 0;\n\n" );
+			MainGenerator->AddBody( "\tif ( ExportDir.Size == 0 )\n\t\tExports = NULL;\n\n" );
+			MainGenerator->AddBody( "\tfor ( SIZE_T i = 0; i < g_NumberOfSlots; i++ )\n\t{\n" );
+			MainGenerator->AddBody( "\t\tWORD        Slot          = g_SortedSlots[ i ];\n" );
+			MainGenerator->AddBody( "\t\tconst char* Name          = g_ExportNames[ Slot ];\n" );
+			MainGenerator->AddBody( "\t\tDWORD       FunctionIndex = MAXDWORD;\n" );
+			MainGenerator->AddBody( "\t\tvoid*       Address       = NULL;\n\n" );
+			MainGenerator->AddBody( "\t\tif ( Exports != NULL )\n\t\t{\n" );
+			MainGenerator->AddBody( "\t\t\tif ( IS_INTRESOURCE( Name ) )\n\t\t\t{\n" );
+			MainGenerator->AddBody( "\t\t\t\tFunctionIndex = (DWORD)(ULONG_PTR)Name - Exports->Base;\n\t\t\t}\n" );
+			MainGenerator->AddBody( "\t\t\telse\n\t\t\t{\n" );
+			MainGenerator->AddBody( "\t\t\t\tint Compare = 1;\n\n" );
+			MainGenerator->AddBody( "\t\t\t\twhile ( NameIndex < Exports->NumberOfNames && ( Compare = strcmp( (const char*)( ModuleBase + Names[ NameIndex ] ), Name ) ) < 0 )\n" );
+			MainGenerator->AddBody( "\t\t\t\t\tNameIndex++;\n\n" );
+			MainGenerator->AddBody( "\t\t\t\tif ( Compare == 0 )\n\t\t\t\t\tFunctionIndex = NameOrdinals[ NameIndex ];\n\t\t\t}\n\n" );
+			MainGenerator->AddBody( "\t\t\tif ( FunctionIndex < Exports->NumberOfFunctions )\n\t\t\t{\n" );
+			MainGenerator->AddBody( "\t\t\t\tDWORD RVA = Functions[ FunctionIndex ];\n\n" );
+			MainGenerator->AddBody( "\t\t\t\t// Forwarders point back into the export directory, leave those to the loader\n" );
+			MainGenerator->AddBody( "\t\t\t\tif ( RVA != 0 && ( RVA < ExportDir.VirtualAddress || RVA >= ExportDir.VirtualAddress + ExportDir.Size ) )\n" );
+			MainGenerator->AddBody( "\t\t\t\t\tAddress = ModuleBase + RVA;\n\t\t\t}\n\t\t}\n\n" );
+			MainGenerator->AddBody( "\t\tif ( Address == NULL )\n" );
+			MainGenerator->AddBody( "\t\t\tAddress = (void*)GetProcAddress( OriginalModule, Name );\n\n" );
+			MainGenerator->AddBody( "\t\tg_FunctionTable[ Slot ] = Address;\n\t}\n}\n" );
+
+			MainGenerator->AddProcessAttach( "\tPopulateFunctionTable();\n" );
+		}
+
+		return MainGenerator->Write();
+	} );
+
+	return true;
+}
+
+bool GenerateManifest(
+	_Inout_ EmitPipeline&                       Pipeline,
+	_In_    const std::filesystem::path&        OutDir,
+	_In_    const std::string&                  DLLName,
+	_In_    const ExportTable&                  Entries
+)
+{
+	auto Manifest = std::make_shared< ManifestGenerator >( OutDir / ( DLLName + "Exports.ndjson" ), DLLName, Entries );
+
+	if ( !Manifest->Open() )
+	{
+		printf( "Failed to open Manifest File\n" );
+		return false;
+	}
+
+	Pipeline.AddGenerator( "emit manifest", Manifest, Entries.GetMachine(), Entries.size(), true );
+
+	return true;
+}
+
+/* One for the proxy, and with --forward one for the renamed original which exports the same */
+bool GenerateImportLibraries(
+	_Inout_ EmitPipeline&                Pipeline,
+	_In_    const std::filesystem::path& OutDir,
+	_In_    const std::string&           DLLName,
+	_In_    const ExportTable&           Entries,
+	_In_    const std::string&           ForwardTo
+)
+{
+	std::vector< std::string > Libraries = { DLLName };
+
+	if ( ForwardTo.size() )
+		Libraries.push_back( ForwardTo );
+
+	for ( const auto& LibraryName : Libraries )
+	{
+		auto Library = std::make_shared< ImportLibraryGenerator >( OutDir / ( LibraryName + ".lib" ), LibraryName );
+
+		if ( !Library->Open() )
+		{
+			printf( "Failed to open Import Library File\n" );
+			return false;
+		}
+
+		/* Stubbed proxies drop data exports, forwarding keeps them */
+		Pipeline.AddGenerator( "emit import library", Library, Entries.GetMachine(), Entries.size(), ForwardTo.size() != 0, ForwardTo );
+	}
+
+	return true;
+}
+
+bool GenerateNative(
+	_Inout_  EmitPipeline&                Pipeline,
+	_In_     const std::filesystem::path& DLLPath,
+	_In_     const std::filesystem::path& OutDir,
+	_In_     const std::string&           DLLName,
+	_In_     const ExportTable&           Entries,
+	_In_     const std::string&           ForwardTo,
+	_In_opt_ const ExportTable*           Source
+)
+{
+	const auto      ProxyPath = OutDir / ( DLLName + ".dll" );
+	std::error_code Error;
+
+	/* The source is still mapped and would be lost anyway */
+	if ( std::filesystem::equivalent( ProxyPath, DLLPath, Error ) )
+	{
+		printf( "Native proxy would overwrite %s, pick another output directory\n", DLLPath.string().c_str() );
+		return false;
+	}
+
+	auto Native = std::make_shared< NativeProxyGenerator >( ProxyPath, DLLName );
+
+	if ( !Native->Open() )
+	{
+		printf( "Failed to open Native Proxy File\n" );
+		return false;
+	}
+
+	/* Forwarding also covers data exports, stubs cant */
+	Pipeline.AddGenerator( "emit native proxy", Native, Entries.GetMachine(), Entries.GetOrdinalCount(), ForwardTo.size() != 0, ForwardTo, Source );
+
+	return true;
+}
+
+struct ProxyResult
+{
+	std::filesystem::path DLLPath;
+	std::filesystem::path OutDir;
+	bool                  Success         = false;
+	bool                  Cached          = false;
+	UINT16                MachineType     = 0;
+	SIZE_T                NumberOfExports = 0;
+	double                Milliseconds    = 0;
+
+	/* The parsed exports, watch mode diffs the next parse against them */
+	std::shared_ptr< const ExportTable > Entries;
+};
+
+/* "-" reads the DLL from stdin so pipelines never have to put it on disk */
+bool IsStdinPath(
+	_In_ const std::filesystem::path& Path
+)
+{
+	return Path == "-";
+}
+
+bool ReportExportChanges(
+	_In_ const std::filesystem::path& OldDLLPath,
+	_In_ const ExportTable&           Entries
+)
+{
+	ExportTable OldEntries;
+	ExportDiff  Diff;
+
+	if ( !ExportEntry::GetExportEntries( OldDLLPath, OldEntries, false, NULL ) )
+	{
+		printf( "Failed to read exports of %s\n", OldDLLPath.string().c_str() );
+		return false;
+	}
+
+	Diff.Compare( OldEntries, Entries );
+	Diff.Print();
+
+	return true;
+}
+
+/* Parses the exports of Image unless they already came from the daemon's cache */
+bool LoadExports(
+	_In_    const ProxyOptions&          Options,
+	_In_    const PEImage&               Image,
+	_In_    const std::filesystem::path& DLLPath,
+	_In_    const ExportCache::Stamp&    Stamp,
+	_Inout_ ProxyResult&                 Result
+)
+{
+	if ( Result.Entries )
+		return true;
+
+	auto Entries = std::make_shared< ExportTable >();
+
+	if ( !ExportEntry::GetExportEntries( Image, *Entries, Options.Verbose, &Result.MachineType ) )
+		return false;
+
+	if ( Options.ParsedExports )
+		Options.ParsedExports->Insert( DLLPath, Stamp, Entries );
+
+	Result.Entries = std::move( Entries );
+
+	return true;
+}
+
+bool GenerateProxy(
+	_In_    const ProxyOptions&          Options,
+	_In_    const std::filesystem::path& DLLPath,
+	_In_    const std::filesystem::path& OutDir,
+	_Inout_ ProxyResult&                 Result
+)
+{
+	PEImage            Image;
+	ExportCache::Stamp Stamp = {};
+
+	auto DLLName       = Options.DLLName.size() ? std::filesystem::path( Options.DLLName ).replace_extension().string() : DLLPath.filename().replace_extension( "" ).string();
+	auto VSProjectName = Options.VSProjectName;
+
+	if ( VSProjectName.size() == 0 )
+		VSProjectName = DLLName + " Proxy";
+
+	Result.Entries.reset();
+
+	/* Looked up before the image is read, a DLL replaced in between is then just parsed again next time */
+	if ( Options.ParsedExports && !IsStdinPath( DLLPath ) && ( Result.Entries = Options.ParsedExports->Find( DLLPath, Stamp ) ) )
+		Result.MachineType = Result.Entries->GetMachine();
+
+	/* Cached exports leave the image to the regeneration cache, which hashes it */
+	if ( ( !Result.Entries || Options.UseCache ) && !( IsStdinPath( DLLPath ) ? Image.Open( stdin ) : Image.Open( DLLPath ) ) )
+		return false;
+
+	/* Reported even when the cache says there is nothing to regenerate */
+	const bool Parsed = Options.DiffDLL.size() != 0;
+
+	if ( Parsed && ( !LoadExports( Options, Image, DLLPath, Stamp, Result ) || !ReportExportChanges( Options.DiffDLL, *Result.Entries ) ) )
+		return false;
+
+	auto   Cache    = ProxyCache( OutDir / ( DLLName + ".proxycache" ) );
+	UINT64 CacheKey = 0;
+	bool   HasKey   = false;
+	bool   UpToDate = false;
+
+	if ( Options.UseCache && !Options.Resolver )
+	{
+		RunStats::Timer Timer( "cache check" );
+
+		HasKey   = ProxyCache::ComputeKey( Image, Options.GetCacheKeyText( DLLName ), &CacheKey );
+		UpToDate = HasKey && Cache.IsUpToDate( CacheKey, &Result.NumberOfExports );
+	}
+
+	if ( UpToDate )
+	{
+		if ( Options.Verbose )
+			printf( "%s unchanged, reusing existing output\n", DLLName.c_str() );
+
+		Result.MachineType = Image.GetMachine();
+		Result.Cached      = true;
+		return true;
+	}
+
+	if ( !Parsed && !LoadExports( Options, Image, DLLPath, Stamp, Result ) )
+		return false;
+
+	const ExportTable& Entries = *Result.Entries;
+
+	Result.NumberOfExports = Entries.size();
+
+	auto VSGen = VSGenerator( VSProjectName, OutDir, Result.MachineType );
+
+	std::filesystem::path OutputDir = OutDir;
+
+	if ( Options.GenerateVSProject )
+		OutputDir = VSGen.GetProjectPath();
+
+	/* Every output registers with the pipeline, then one walk over the exports feeds them all */
+	EmitPipeline Pipeline;
+	ExportTable  Forwarded;
+
+	bool Generated = false;
+
+	const auto ForwardTo = Options.ForwardDLL.size() ? std::filesystem::path( Options.ForwardDLL ).replace_extension().string() : std::string();
+	const auto Source    = ( ForwardTo.size() && Options.Resolver ) ? &Forwarded : NULL;
+
+	/* Collapse a copy, the manifest still describes the DLL as it is */
+	if ( Source != NULL )
+	{
+		RunStats::Timer Timer( "collapse forwarders" );
+
+		Forwarded = Entries;
+
+		const auto Collapsed = Options.Resolver->Collapse( Forwarded );
+
+		if ( Options.Verbose )
+			printf( "Collapsed %zu forwarder chains\n", Collapsed );
+	}
+
+	if ( Options.Native )
+	{
+		Generated = GenerateNative( Pipeline, DLLPath, OutputDir, DLLName, Entries, ForwardTo, Source );
+	}
+	else if ( ForwardTo.size() )
+	{
+		Generated = GenerateForwardedExports( Pipeline, VSGen, Options, OutputDir, DLLName, ForwardTo, Source );
+	}
+	else
+	{
+		Generated = GenerateASM( Pipeline, VSGen, Options, OutputDir, DLLName, Entries, Result.MachineType );
+	}
+
+	if ( Generated && Options.WriteManifest )
+		Generated = GenerateManifest( Pipeline, OutputDir, DLLName, Entries );
+
+	if ( Generated && Options.ImportLibrary )
+		Generated = GenerateImportLibraries( Pipeline, OutputDir, DLLName, Entries, ForwardTo );
+
+	if ( Generated && Options.GenerateVSProject )
+	{
+		Pipeline.AddOutput( VSGen.GetProjectFilePath() );
+
+		Pipeline.AddEmitter( "vs project", [ &VSGen ]( const std::vector< EmitPipeline::Record >& )
+		{
+			return VSGen.Generate();
+		} );
+	}
+
+	/* Data exports cant be stubbed, only the stub generator complains about them */
+	if ( Generated )
+		Generated = Pipeline.Run( Entries, Options.ForwardDLL.size() == 0, Options.ParallelEmit );
+
+	if ( Generated && HasKey && !Cache.Store( CacheKey, Result.NumberOfExports, Pipeline.GetOutputs() ) )
+		printf( "Failed to update regeneration cache for %s\n", DLLName.c_str() );
+
+	return Generated;
+}
+
+bool MatchesWildcard(
+	_In_ const char* Pattern,
+	_In_ const char* Text
+)
+{
+	/* Case insensitive * and ? matching, good enough for file name globs */
+	const char* StarPattern = NULL;
+	const char* StarText    = NULL;
+
+	while ( *Text )
+	{
+		if ( *Pattern == '*' )
+		{
+			StarPattern = ++Pattern;
+			StarText    = Text;
+		}
+		else if ( *Pattern == '?' || tolower( (unsigned char)*Pattern ) == tolower( (unsigned char)*Text ) )
+		{
+			Pattern++;
+			Text++;
+		}
+		else if ( StarPattern != NULL )
+		{
+			Pattern = StarPattern;
+			Text    = ++StarText;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while ( *Pattern == '*' )
+		Pattern++;
+
+	return *Pattern == 0;
+}
+
+bool ExpandBatchInput(
+	_In_    const std::string&                    Input,
+	_Inout_ std::vector< std::filesystem::path >& DLLPaths
+)
+{
+	/* @file is a list of inputs, one per line */
+	if ( Input.size() > 1 && Input[ 0 ] == '@' )
+	{
+		std::ifstream ListFile( Input.substr( 1 ) );
+
+		if ( !ListFile.is_open() )
+		{
+			printf( "Failed to open list file %s\n", Input.c_str() + 1 );
+			return false;
+		}
+
+		std::string Line;
+
+		while ( std::getline( ListFile, Line ) )
+		{
+			while ( Line.size() && ( Line.back() == '\r' || Line.back() == ' ' ) )
+				Line.pop_back();
+
+			if ( Line.size() == 0 || Line[ 0 ] == '#' )
+				continue;
+
+			if ( !ExpandBatchInput( Line, DLLPaths ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	std::filesystem::path InputPath = Input;
+	std::error_code       Error;
+
+	if ( std::filesystem::is_directory( InputPath, Error ) )
+	{
+		for ( const auto& Entry : std::filesystem::directory_iterator( InputPath, Error ) )
+		{
+			if ( Entry.is_regular_file( Error ) && MatchesWildcard( "*.dll", Entry.path().filename().string().c_str() ) )
+				DLLPaths.push_back( Entry.path() );
+		}
+
+		return true;
+	}
+
+	auto Pattern = InputPath.filename().string();
+
+	if ( Pattern.find_first_of( "*?" ) != std::string::npos )
+	{
+		auto Directory = InputPath.parent_path();
+
+		if ( Directory.empty() )
+			Directory = ".";
+
+		for ( const auto& Entry : std::filesystem::directory_iterator( Directory, Error ) )
+		{
+			if ( Entry.is_regular_file( Error ) && MatchesWildcard( Pattern.c_str(), Entry.path().filename().string().c_str() ) )
+				DLLPaths.push_back( Entry.path() );
+		}
+
+		return true;
+	}
+
+	if ( !std::filesystem::exists( InputPath, Error ) )
+	{
+		printf( "DLL file doesnt exist %s\n", Input.c_str() );
+		return false;
+	}
+
+	DLLPaths.push_back( InputPath );
+
+	return true;
+}
+
+bool CollectBatchInputs(
+	_In_    const std::vector< std::string >&     Inputs,
+	_Inout_ std::vector< std::filesystem::path >& DLLPaths
+)
+{
+	for ( const auto& Input : Inputs )
+	{
+		if ( !ExpandBatchInput( Input, DLLPaths ) )
+			return false;
+	}
+
+	/* Overlapping inputs like a directory and a wildcard in it should only produce each proxy once */
+	std::set< std::filesystem::path > Seen;
+
+	DLLPaths.erase( std::remove_if( DLLPaths.begin(), DLLPaths.end(), [ &Seen ]( const std::filesystem::path& Path )
+	{
+		std::error_code Error;
+		return !Seen.insert( std::filesystem::weakly_canonical( Path, Error ) ).second;
+	} ), DLLPaths.end() );
+
+	if ( DLLPaths.size() == 0 )
+	{
+		printf( "No DLLs found\n" );
+		return false;
+	}
+
+	return true;
+}
+
+/* Every DLL gets its own directory, same named DLLs from different folders get a suffix */
+std::filesystem::path GetBatchOutDir(
+	_In_    const std::filesystem::path&  OutDir,
+	_In_    const std::filesystem::path&  DLLPath,
+	_Inout_ std::map< std::string, int >& NameCounts
+)
+{
+	auto DirectoryName = DLLPath.filename().replace_extension( "" ).string();
+	auto Count         = NameCounts[ DirectoryName ]++;
+
+	if ( Count != 0 )
+		DirectoryName += "_" + std::to_string( Count + 1 );
+
+	return OutDir / DirectoryName;
+}
+
+int RunBatch(
+	_In_ const ProxyOptions&                 Options,
+	_In_ const std::vector< std::string >&   Inputs,
+	_In_ const std::filesystem::path&        OutDir,
+	_In_ SIZE_T                              NumberOfJobs
+)
+{
+	std::vector< std::filesystem::path > DLLPaths;
+
+	if ( !CollectBatchInputs( Inputs, DLLPaths ) )
+		return 2;
+
+	std::vector< ProxyResult >   Results( DLLPaths.size() );
+	std::map< std::string, int > NameCounts;
+
+	for ( SIZE_T Index = 0; Index < DLLPaths.size(); Index++ )
+	{
+		Results[ Index ].DLLPath = DLLPaths[ Index ];
+		Results[ Index ].OutDir  = GetBatchOutDir( OutDir, DLLPaths[ Index ], NameCounts );
+	}
+
+	if ( NumberOfJobs == 0 )
+		NumberOfJobs = std::thread::hardware_concurrency();
+
+	/* The pool already keeps every core busy across DLLs, emit each proxy's files inline */
+	auto BatchOptions = Options;
+
+	BatchOptions.ParallelEmit = false;
+
+	const auto BatchStart = std::chrono::steady_clock::now();
+
+	{
+		ThreadPool Pool( NumberOfJobs );
+
+		for ( auto& Result : Results )
+		{
+			Pool.Submit( [ &BatchOptions, &Result ]()
+			{
+				const auto Start = std::chrono::steady_clock::now();
+
+				std::error_code Error;
+				std::filesystem::create_directories( Result.OutDir, Error );
+
+				Result.Success      = GenerateProxy( BatchOptions, Result.DLLPath, Result.OutDir, Result );
+				Result.Milliseconds = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - Start ).count();
+
+				/* The summary only needs the counts, dont hold every table until the batch ends */
+				Result.Entries.reset();
+			} );
+		}
+
+		Pool.Wait();
+	}
+
+	const auto BatchMilliseconds = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - BatchStart ).count();
+
+	std::ofstream Summary( OutDir / "BatchSummary.txt" );
+
+	SIZE_T Succeeded = 0;
+	SIZE_T Cached    = 0;
+	SIZE_T Exports   = 0;
+
+	for ( const auto& Result : Results )
+	{
+		Summary << ( Result.Success ? ( Result.Cached ? "CACHED " : "OK     " ) : "FAILED " );
+		Summary << std::hex << Result.MachineType << std::dec << " ";
+		Summary << Result.NumberOfExports << " exports ";
+		Summary << Result.Milliseconds << " ms ";
+		Summary << Result.DLLPath.string() << " -> " << Result.OutDir.string() << "\n";
+
+		if ( Result.Success )
+		{
+			Succeeded++;
+			Cached  += Result.Cached;
+			Exports += Result.NumberOfExports;
+		}
+	}
+
+	Summary << Succeeded << "/" << Results.size() << " DLLs (" << Cached << " cached), " << Exports << " exports in " << BatchMilliseconds << " ms on " << NumberOfJobs << " threads\n";
+
+	printf( "Generated %zu/%zu proxies (%zu cached, %zu exports) in %.0f ms on %zu threads\n", Succeeded, Results.size(), Cached, Exports, BatchMilliseconds, NumberOfJobs );
+
+	return Succeeded == Results.size() ? 0 : 3;
+}
+
+bool RegenerateWatched(
+	_In_    const ProxyOptions& Options,
+	_Inout_ ProxyResult&        Result
+)
+{
+	const auto Start    = std::chrono::steady_clock::now();
+	const auto Previous = Result.Entries;
+
+	std::error_code Error;
+	std::filesystem::create_directories( Result.OutDir, Error );
+
+	/* The last table is the only copy of the old exports left, the DLL on disk is already the new one */
+	Result.Cached       = false;
+	Result.Success      = GenerateProxy( Options, Result.DLLPath, Result.OutDir, Result );
+	Result.Milliseconds = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - Start ).count();
+
+	if ( !Result.Success || Result.Cached )
+	{
+		Result.Entries = Previous;
+
+		if ( !Result.Success )
+			printf( "Failed to regenerate %s, waiting for the next change\n", Result.DLLPath.string().c_str() );
+
+		return Result.Success;
+	}
+
+	if ( Previous )
 	{
-		printf( "Linker generator failed to begin\n" );
-		return;
+		ExportDiff Diff;
+
+		Diff.Compare( *Previous, *Result.Entries );
+
+		if ( Diff.GetChanges().size() )
+			Diff.Print();
 	}
 
-	for ( const auto& Export : Entries )
+	printf( "Regenerated %s (%zu exports) in %.0f ms\n", Result.DLLPath.filename().string().c_str(), Result.NumberOfExports, Result.Milliseconds );
+
+	return true;
+}
+
+int RunWatch(
+	_In_ const ProxyOptions&               Options,
+	_In_ const std::vector< std::string >& Inputs,
+	_In_ const std::filesystem::path&      OutDir,
+	_In_ bool                              Batch
+)
+{
+	/* Debounce window, long enough for a linker to finish writing and renaming */
+	const UINT32 QuietMilliseconds = 100;
+
+	std::map< std::filesystem::path, ProxyResult > Watched;
+	std::map< std::string, int >                   NameCounts;
+	FileWatcher                                    Watcher;
+
+	/* Directory inputs are watched themselves so DLLs dropped into them later get picked up */
+	for ( const auto& Input : Inputs )
 	{
-		LinkerGenerator->AddForwardedExportEntry( Export, NewDLLName );
+		std::error_code Error;
+
+		if ( std::filesystem::is_directory( Input, Error ) && !Watcher.AddDirectory( Input ) )
+			return 2;
 	}
 
-	MainGenerator.Write();
+	auto WatchedOptions = Options;
 
-	LinkerGenerator->End();
+	/* Only the DLLs that changed are regenerated, the cache cant save anything here */
+	WatchedOptions.UseCache = false;
 
-	if ( GenerateVSProject )
+	for ( bool Initial = true; ; Initial = false )
 	{
-		VSProject.Generate();
+		std::vector< std::filesystem::path > DLLPaths;
+		std::set< std::filesystem::path >    Changed;
+
+		if ( !Initial )
+		{
+			std::vector< std::filesystem::path > Events;
+
+			Watcher.Wait( Events, QuietMilliseconds );
+
+			Changed.insert( Events.begin(), Events.end() );
+		}
+
+		/* Inputs are expanded again after every wait, wildcards and directories can match DLLs that just appeared */
+		if ( Batch )
+		{
+			for ( const auto& Input : Inputs )
+				ExpandBatchInput( Input, DLLPaths );
+		}
+		else
+		{
+			DLLPaths.push_back( Inputs[ 0 ] );
+		}
+
+		for ( const auto& DLLPath : DLLPaths )
+		{
+			std::error_code Error;
+
+			const auto Canonical = std::filesystem::weakly_canonical( DLLPath, Error );
+			const auto Existing  = Watched.find( Canonical );
+
+			if ( Existing != Watched.end() && Changed.count( Canonical ) == 0 )
+				continue;
+
+			if ( !std::filesystem::exists( Canonical, Error ) )
+				continue;
+
+			auto& Result = Watched[ Canonical ];
+
+			if ( Existing == Watched.end() )
+			{
+				Result.DLLPath = DLLPath;
+				Result.OutDir  = Batch ? GetBatchOutDir( OutDir, DLLPath, NameCounts ) : OutDir;
+
+				Watcher.AddDirectory( Canonical.parent_path() );
+			}
+
+			RegenerateWatched( WatchedOptions, Result );
+		}
+
+		if ( Initial )
+		{
+			if ( Watched.size() == 0 )
+			{
+				printf( "No DLLs found\n" );
+				return 2;
+			}
+
+			printf( "Watching %zu DLLs for changes, Ctrl+C to stop\n", Watched.size() );
+		}
+
+		fflush( stdout );
 	}
+
+	return 0;
 }
 
-void GenerateASM(
-	_Inout_ VSGenerator&                 VSProject,
-	_In_ bool                            GenerateVSProject,
-	_In_ const std::filesystem::path&    OutDir,
-	_In_ const std::string&              DLLName,
-	_In_ const std::vector<ExportEntry>& Entries,
-	_In_ bool                            UseDefFile,
-	_In_ UINT16                          MachineType
+int RunIndexBuild(
+	_In_ const std::filesystem::path&      IndexPath,
+	_In_ const std::vector< std::string >& Inputs,
+	_In_ SIZE_T                            NumberOfJobs
 )
 {
-	std::ofstream DefPragmaFileOut;
-	std::ofstream ASMFileOut;
-	std::ofstream DLLMainFileOut;
+	std::vector< std::filesystem::path > DLLPaths;
 
-	auto LinkerGenerator = std::shared_ptr<ExportGenerator>();
-	auto StubGenerator   = ASMFileGenerator( OutDir / ( DLLName + "ASMStubs.asm" ) );
-	auto MainGenerator   = DLLMainGenerator( OutDir / "DLLMain.cpp" );
+	if ( !CollectBatchInputs( Inputs, DLLPaths ) )
+		return 2;
 
-	VSProject.AddFile<VSMASMFile>( DLLName + "ASMStubs.asm" );
-	VSProject.AddFile<VSSourceFile>( "DLLMain.cpp" );
+	/* Stored paths are the lookup key for incremental rebuilds so keep them stable between runs */
+	for ( auto& DLLPath : DLLPaths )
+	{
+		std::error_code Error;
+		auto            Absolute = std::filesystem::weakly_canonical( DLLPath, Error );
+
+		if ( !Error )
+			DLLPath = Absolute;
+	}
+
+	if ( NumberOfJobs == 0 )
+		NumberOfJobs = std::thread::hardware_concurrency();
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	ExportIndex::BuildStats Stats;
+
+	if ( !ExportIndex::Build( IndexPath, DLLPaths, NumberOfJobs, &Stats ) )
+		return 3;
+
+	const auto Milliseconds = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - Start ).count();
 
-	if ( !StubGenerator.Open() )
+	printf( "Indexed %zu DLLs (%zu parsed, %zu reused, %zu without exports), %zu exports, %zu names, %zu bytes in %.0f ms\n",
+		DLLPaths.size(), Stats.Parsed, Stats.Reused, Stats.Failed, Stats.Exports, Stats.Names, Stats.Bytes, Milliseconds );
+
+	return 0;
+}
+
+int RunIndexQuery(
+	_In_ const std::filesystem::path&      IndexPath,
+	_In_ const std::vector< std::string >& Names,
+	_In_ bool                              Verbose
+)
+{
+	ExportIndex Index;
+
+	if ( !Index.Open( IndexPath ) )
+		return 2;
+
+	int Missing = 0;
+
+	for ( const auto& Name : Names )
 	{
-		printf( "Failed to open ASMStubs File\n" );
-		return;
+		const auto Start = std::chrono::steady_clock::now();
+		const auto Entry = Index.FindName( Name );
+
+		if ( Entry == NULL )
+		{
+			printf( "%s: not exported by any indexed DLL\n", Name.c_str() );
+			Missing++;
+			continue;
+		}
+
+		const auto Postings = Index.GetPostings( *Entry );
+
+		for ( UINT32 PostingIndex = 0; PostingIndex < Postings.second; PostingIndex++ )
+		{
+			const auto& Hit    = Postings.first[ PostingIndex ];
+			const auto& Image  = Index.GetImage( Hit.ImageIndex );
+			const auto& Export = Index.GetExport( Hit.ExportIndex );
+			const auto  Path   = Index.GetString( Image.PathOffset );
+
+			printf( "%s @%u ", Name.c_str(), Export.Ordinal );
+
+			if ( Export.ForwarderOffset != 0 )
+			{
+				const auto Forwarder = Index.GetString( Export.ForwarderOffset );
+
+				printf( "-> %.*s ", (int)Forwarder.size(), Forwarder.data() );
+			}
+			else
+				printf( "%08X %s ", Export.RVA, ( Export.Flags & ExportIndex::ExportFlagData ) ? "DATA" : "CODE" );
+
+			printf( "%.*s\n", (int)Path.size(), Path.data() );
+		}
+
+		if ( Verbose )
+			printf( "%u hits in %.1f us\n", Postings.second, std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - Start ).count() );
 	}
 
-	if ( !MainGenerator.Open() )
+	return Missing == 0 ? 0 : 4;
+}
+
+/* Everything the command line sets, daemon requests parse into a fresh one with the same options */
+struct CommandLine
+{
+	std::vector< std::string > DLLPaths;
+	std::string                OutDir;
+	ProxyOptions               Options;
+	bool                       ShowHelp     = false;
+	bool                       Batch        = false;
+	bool                       Watch        = false;
+	SIZE_T                     NumberOfJobs = 0;
+	std::string                IndexBuildPath;
+	std::string                IndexQueryPath;
+	std::string                DaemonSocket;
+	bool                       ShowTimings  = false;
+	std::string                StatsPath;
+};
+
+void AddCommandLineOptions(
+	_Inout_ lyra::cli&   CommandLineParser,
+	_Inout_ CommandLine& Args
+)
+{
+	auto& Options = Args.Options;
+
+	CommandLineParser.add_argument( lyra::help( Args.ShowHelp ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.Verbose )                        [ "-v" ]  [ "--verbose" ]     ( "Show infomation about exports" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.GenerateVSProject )              [ "-p" ]  [ "--visualstudio" ]( "Generate Visual Studio project" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.PreferDef )                      [ "-d" ]  [ "--def" ]         ( "Prefer def file over #pragma" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.ForwardDLL,    "NEWDLLNAME" )    [ "-f" ]  [ "--forward" ]     ( "Use export forwarding to forward exports to old DLL with new name" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.VSProjectName, "PROJNAME" )      [ "-n" ]  [ "--vsname" ]      ( "Name for visual studio project" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.OutDir,           "OUTDIR" )        [ "-o" ]  [ "--out" ]         ( "Out directory for files" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.DLLName,       "DLLNAME" )       [ "--dllname" ]               ( "Name of the original DLL, required when DLLPATH is - to read it from stdin" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.Batch )                             [ "-b" ]  [ "--batch" ]       ( "Generate a proxy per DLL from directories, wildcards or @listfiles into OUTDIR/<DLLNAME>" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.LazyResolve )                    [ "-l" ]  [ "--lazy" ]        ( "Resolve each export on its first call instead of in DllMain" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.Instrument )                     [ "-i" ]  [ "--instrument" ]  ( "Count calls per export and dump them next to the proxy on unload" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.WriteManifest )                  [ "-m" ]  [ "--manifest" ]    ( "Also write <DLLNAME>Exports.ndjson describing the image and every export" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.Native )                         [ "-x" ]  [ "--native" ]      ( "Write the finished proxy DLL to OUTDIR/<DLLNAME>.dll instead of sources" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.ObjectStubs )                    [ "--obj" ]                   ( "Write the stubs as a ready to link COFF object instead of MASM source" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.ImportLibrary )                  [ "--implib" ]                ( "Also write <DLLNAME>.lib, and <NEWDLLNAME>.lib with --forward, to link against without building the proxy" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.AsmShards,     "N" )             [ "--asm-shards" ]            ( "Split the ASM stubs over N files that assemble and rebuild independently" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.DiffDLL,       "OLDDLL" )        [ "--diff" ]                  ( "Report exports added, removed or changed since OLDDLL, outputs that come out the same are left untouched" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.Watch )                             [ "-w" ]  [ "--watch" ]       ( "Keep running and regenerate the proxy of every input DLL that changes" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.DaemonSocket,     "SOCKET" )        [ "--daemon" ]                ( "Keep running and serve generate, inspect, stats and shutdown requests on the Unix domain socket SOCKET" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.UseCache )                       [ "-c" ]  [ "--cache" ]       ( "Skip DLLs whose exports and options are unchanged since the last run" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.NumberOfJobs,     "JOBS" )          [ "-j" ]  [ "--jobs" ]        ( "Number of worker threads for batch and daemon mode, defaults to all cores" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.ForwarderSearchDir, "DIR" )      [ "--collapse-forwarders" ]   ( "With --forward, follow forwarder chains through the DLLs in DIR to their final target" ) );
+	CommandLineParser.add_argument( lyra::opt ( Options.ApiSetSchema,  "FILE" )          [ "--apiset" ]                ( "API set schema of \"api-set-name = host\" lines used when collapsing forwarders" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.IndexBuildPath,   "INDEX" )         [ "--index-build" ]           ( "Build or refresh an export index over the DLLs given like --batch inputs" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.IndexQueryPath,   "INDEX" )         [ "--index-query" ]           ( "Look up export names given in place of DLLPATH in an export index" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.ShowTimings )                       [ "--timings" ]               ( "Print time per phase, bytes written, allocations and peak RSS when done" ) );
+	CommandLineParser.add_argument( lyra::opt ( Args.StatsPath,        "FILE" )          [ "--stats" ]                 ( "Write the --timings figures as JSON to FILE" ) );
+	CommandLineParser.add_argument( lyra::arg ( Args.DLLPaths,         "DLLPATH" )                                     ( "Path of the DLL to get exports from, - for stdin" ).cardinality( 0, 0 ) );
+}
+
+/* Checks and completes the proxy options, the same for the command line and every daemon request */
+bool FinishOptions(
+	_Inout_ CommandLine& Args
+)
+{
+	auto& Options = Args.Options;
+
+	if ( Options.AsmShards == 0 )
+		Options.AsmShards = 1;
+
+	if ( Options.Native && ( Options.GenerateVSProject || Options.LazyResolve || Options.Instrument ) )
 	{
-		printf( "Failed to open DLL Main File\n" );
-		return;
+		printf( "--native writes the DLL itself, ignoring -p, -l and -i\n" );
+
+		Options.GenerateVSProject = false;
+		Options.LazyResolve       = false;
+		Options.Instrument        = false;
 	}
 
-	if ( UseDefFile )
+	if ( Options.ForwarderSearchDir.size() || Options.ApiSetSchema.size() )
 	{
-		LinkerGenerator = std::make_shared< DefFileGenerator >( OutDir / ( DLLName + "Stubs.def" ) );
+		if ( Options.ForwardDLL.size() == 0 )
+			printf( "Forwarder collapsing only applies with --forward\n" );
 
-		if ( !LinkerGenerator->Open() )
+		/* The daemon hands in the resolver it keeps between requests */
+		if ( Options.Resolver == NULL )
 		{
-			printf( "Failed to open Def File\n" );
-			return;
+			Options.Resolver = std::make_shared< ForwarderResolver >( Options.ForwarderSearchDir );
+
+			if ( Options.ApiSetSchema.size() && !Options.Resolver->LoadApiSetSchema( Options.ApiSetSchema ) )
+				return false;
 		}
+	}
 
-		VSProject.SetDefinitionFile( DLLName + "Stubs.def" );
+	if ( Args.OutDir.size() != 0 )
+	{
+		if ( !std::filesystem::exists( Args.OutDir ) || !std::filesystem::is_directory( Args.OutDir ) )
+		{
+			printf( "Enter valid output directory\n" );
+			return false;
+		}
 	}
-	else
+
+	return true;
+}
+
+/* Splits a request line on spaces, double quotes keep paths with spaces in one word */
+std::vector< std::string > SplitRequest(
+	_In_ const std::string& Request
+)
+{
+	std::vector< std::string > Words;
+	std::string                Word;
+	bool                       Quoted  = false;
+	bool                       HasWord = false;
+
+	for ( const char Character : Request )
 	{
-		LinkerGenerator = std::make_shared< PragmaFileGenerator >( OutDir / ( DLLName + "StubExports.h" ) );
+		if ( Character == '"' )
+		{
+			Quoted  = !Quoted;
+			HasWord = true;
+		}
+		else if ( ( Character == ' ' || Character == '\t' ) && !Quoted )
+		{
+			if ( HasWord )
+				Words.push_back( std::move( Word ) );
 
-		if ( !LinkerGenerator->Open() )
+			Word.clear();
+			HasWord = false;
+		}
+		else
 		{
-			printf( "Failed to open Pragma Exports File\n" );
-			return;
+			Word   += Character;
+			HasWord = true;
 		}
+	}
 
-		VSProject.AddFile<VSHeaderFile>( DLLName + "StubExports.h" );
-		MainGenerator.AddInclude( DLLName + "StubExports.h" );
+	if ( HasWord )
+		Words.push_back( std::move( Word ) );
+
+	return Words;
+}
+
+/*
+	What the daemon keeps between requests besides the parsed exports.
+	Forwarder resolvers live as long as the daemon so the modules they
+	parsed and the chains they resolved are reused by later requests, and
+	every output directory has a lock so two generates into it take turns
+	instead of interleaving their writes and their .proxycache record.
+*/
+struct DaemonState
+{
+	std::shared_ptr< ExportCache >                                                          Cache;
+	std::map< std::pair< std::string, std::string >, std::shared_ptr< ForwarderResolver > > Resolvers;
+	std::map< std::filesystem::path, std::shared_ptr< std::mutex > >                        OutDirLocks;
+	std::mutex                                                                              Lock;
+};
+
+/* Resolver for the search directory and API set schema of Options, created and loaded on first use */
+std::shared_ptr< ForwarderResolver > GetDaemonResolver(
+	_Inout_ DaemonState&        State,
+	_In_    const ProxyOptions& Options
+)
+{
+	std::lock_guard< std::mutex > Guard( State.Lock );
+
+	auto& Resolver = State.Resolvers[ { Options.ForwarderSearchDir, Options.ApiSetSchema } ];
+
+	if ( Resolver == NULL )
+	{
+		auto Created = std::make_shared< ForwarderResolver >( Options.ForwarderSearchDir );
+
+		/* Not kept if the schema doesnt load, the next request tries again */
+		if ( Options.ApiSetSchema.size() && !Created->LoadApiSetSchema( Options.ApiSetSchema ) )
+			return NULL;
+
+		Resolver = Created;
+	}
+
+	return Resolver;
+}
+
+std::shared_ptr< std::mutex > GetDaemonOutDirLock(
+	_Inout_ DaemonState&       State,
+	_In_    const std::string& OutDir
+)
+{
+	std::error_code Error;
+
+	auto Key = std::filesystem::weakly_canonical( std::filesystem::absolute( OutDir.size() ? std::filesystem::path( OutDir ) : std::filesystem::path( "." ), Error ), Error );
+
+	std::lock_guard< std::mutex > Guard( State.Lock );
+
+	auto& Lock = State.OutDirLocks[ Key ];
+
+	if ( Lock == NULL )
+		Lock = std::make_shared< std::mutex >();
+
+	return Lock;
+}
+
+bool HandleGenerateRequest(
+	_In_    const std::vector< std::string >& Words,
+	_Inout_ DaemonState&                      State,
+	_Inout_ std::string&                      Response
+)
+{
+	CommandLine                Args;
+	std::vector< const char* > Argv;
+	auto                       CommandLineParser = lyra::cli();
+
+	AddCommandLineOptions( CommandLineParser, Args );
+
+	/* The request word stands in for the program name */
+	for ( const auto& Word : Words )
+		Argv.push_back( Word.c_str() );
+
+	auto ParsedArgs = CommandLineParser.parse( { (int)Argv.size(), Argv.data() } );
+
+	if ( !ParsedArgs )
+	{
+		Response = "ERROR " + ParsedArgs.errorMessage();
+		return false;
 	}
 
-	if ( !StubGenerator.Begin( MachineType, Entries.size() ) )
+	if ( Args.Batch || Args.Watch || Args.DaemonSocket.size() || Args.IndexBuildPath.size() || Args.IndexQueryPath.size() || Args.ShowTimings || Args.StatsPath.size() || Args.ShowHelp )
 	{
-		printf( "Stub generator failed to begin\n" );
-		return;
+		Response = "ERROR generate takes the options of a single proxy, not modes like --batch, --watch or --index-build";
+		return false;
 	}
 
-	if ( !LinkerGenerator->Begin( MachineType, NULL ) )
+	if ( Args.DLLPaths.size() != 1 || IsStdinPath( Args.DLLPaths[ 0 ] ) )
 	{
-		printf( "Linker generator failed to begin\n" );
-		return;
+		Response = "ERROR generate takes exactly one DLLPATH on disk";
+		return false;
 	}
 
-	MainGenerator.AddBody( "extern \"C\" void* g_FunctionTable[];\n\n" );
-	MainGenerator.AddBody( "void PopulateFunctionTable()\n{\n" );
-	MainGenerator.AddBody( "\tHMODULE OriginalModule = LoadLibraryA( \"" + DLLName + ".dll\" );\n" );
+	if ( !std::filesystem::exists( Args.DLLPaths[ 0 ] ) )
+	{
+		Response = "ERROR DLL file doesnt exist";
+		return false;
+	}
 
-	for ( const auto& Export : Entries )
+	if ( Args.Options.ForwarderSearchDir.size() || Args.Options.ApiSetSchema.size() )
 	{
-		if ( Export.IsData() )
-		{
-			if ( Export.HasName() )
-				printf( "Warning export %s is data\n", Export.GetName().c_str() );
-			else
-				printf( "Warning export ordinal %i is data\n", Export.GetOrdinal() );
+		Args.Options.Resolver = GetDaemonResolver( State, Args.Options );
 
-			continue;
+		if ( Args.Options.Resolver == NULL )
+		{
+			Response = "ERROR failed to load the API set schema, see the daemon output";
+			return false;
 		}
+	}
+
+	if ( !FinishOptions( Args ) )
+	{
+		Response = "ERROR invalid options, see the daemon output";
+		return false;
+	}
+
+	/* Requests already run in parallel on the daemon's pool */
+	Args.Options.ParallelEmit  = false;
+	Args.Options.ParsedExports = State.Cache;
+
+	ProxyResult Result;
 
-		std::string SymbolName = "Ordinal_" + std::to_string( Export.GetOrdinal() );
-		std::string ExportName = "#" + std::to_string( Export.GetOrdinal() );
+	const auto Start = std::chrono::steady_clock::now();
 
-		if ( Export.HasName() )
+	{
+		const auto OutDirLock = GetDaemonOutDirLock( State, Args.OutDir );
+
+		std::lock_guard< std::mutex > Guard( *OutDirLock );
+
+		if ( !GenerateProxy( Args.Options, Args.DLLPaths[ 0 ], Args.OutDir, Result ) )
 		{
-			SymbolName = Export.GetName();
-			ExportName = Export.GetName();
+			Response = "ERROR failed to generate proxy, see the daemon output";
+			return false;
 		}
+	}
 
-		StubGenerator.AddExportEntry( Export, SymbolName );
+	char Line[ 128 ];
 
-		LinkerGenerator->AddExportEntry( Export, SymbolName );
+	snprintf( Line, sizeof( Line ), "OK %zu exports in %.3f ms%s", Result.NumberOfExports, std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - Start ).count(), Result.Cached ? " cached" : "" );
 
-		MainGenerator.AddBody( "\tg_FunctionTable[ " + std::to_string( Export.GetOrdinalIndex() ) + " ] = GetProcAddress( OriginalModule, \"" + ExportName + "\" );\n" );
+	Response = Line;
+
+	return true;
+}
+
+bool HandleInspectRequest(
+	_In_    const std::vector< std::string >&     Words,
+	_In_    const std::shared_ptr< ExportCache >& Cache,
+	_Inout_ std::string&                          Response
+)
+{
+	if ( Words.size() != 2 )
+	{
+		Response = "ERROR inspect takes exactly one DLLPATH";
+		return false;
 	}
 
-	MainGenerator.AddBody( "}\n" );
-	MainGenerator.AddProcessAttach( "\tPopulateFunctionTable();\n" );
+	const std::filesystem::path DLLPath = Words[ 1 ];
 
-	StubGenerator.End();
+	ProxyOptions       Options;
+	ProxyResult        Result;
+	PEImage            Image;
+	ExportCache::Stamp Stamp = {};
 
-	LinkerGenerator->End();
+	Options.ParsedExports = Cache;
+	Result.Entries        = Cache->Find( DLLPath, Stamp );
+
+	if ( !Result.Entries && ( !Image.Open( DLLPath ) || !LoadExports( Options, Image, DLLPath, Stamp, Result ) ) )
+	{
+		Response = "ERROR failed to read exports of " + DLLPath.string();
+		return false;
+	}
 
-	MainGenerator.Write();
+	/* One line per export, the status line is the only one that doesnt start with an ordinal */
+	OutputBuffer Lines;
 
-	if ( GenerateVSProject )
+	for ( const auto& Export : *Result.Entries )
 	{
-		VSProject.Generate();
+		Lines << Export.GetOrdinal() << " " << ( Export.HasName() ? Export.GetName() : std::string_view( "[NONAME]" ) );
+
+		if ( Export.IsForwarded() )
+			Lines << " -> " << Export.GetForwardedName();
+		else if ( Export.IsData() )
+			Lines << " DATA";
+
+		Lines << "\n";
 	}
+
+	Response = Lines.GetText();
+	Response += "OK " + std::to_string( Result.Entries->size() ) + " exports";
+
+	return true;
+}
+
+int RunDaemon(
+	_In_ const std::filesystem::path& SocketPath,
+	_In_ SIZE_T                       NumberOfJobs
+)
+{
+	/* Big enough for a few hundred system DLLs, evicts least recently used tables past it */
+	const SIZE_T CacheBytes = 256 * 1024 * 1024;
+
+	if ( NumberOfJobs == 0 )
+		NumberOfJobs = std::thread::hardware_concurrency();
+
+	DaemonState  State;
+	DaemonServer Server( NumberOfJobs );
+
+	State.Cache = std::make_shared< ExportCache >( CacheBytes );
+
+	auto& Cache = State.Cache;
+
+	if ( !Server.Listen( SocketPath ) )
+		return 1;
+
+	printf( "Listening on %s with %zu workers\n", SocketPath.string().c_str(), NumberOfJobs );
+	fflush( stdout );
+
+	Server.Run( [ &Server, &State, &Cache ]( const std::string& Request, std::string& Response )
+	{
+		const auto Words = SplitRequest( Request );
+
+		if ( Words.empty() )
+		{
+			Response = "ERROR empty request";
+			return false;
+		}
+
+		if ( Words[ 0 ] == "generate" )
+			return HandleGenerateRequest( Words, State, Response );
+
+		if ( Words[ 0 ] == "inspect" )
+			return HandleInspectRequest( Words, Cache, Response );
+
+		if ( Words[ 0 ] == "stats" )
+		{
+			Server.AppendCounters( Response );
+
+			Response += "cache_hits "    + std::to_string( Cache->GetHits() )   + "\n";
+			Response += "cache_misses "  + std::to_string( Cache->GetMisses() ) + "\n";
+			Response += "cache_entries " + std::to_string( Cache->GetCount() )  + "\n";
+			Response += "cache_bytes "   + std::to_string( Cache->GetBytes() )  + "\n";
+			Response += "OK";
+			return true;
+		}
+
+		if ( Words[ 0 ] == "shutdown" )
+		{
+			Server.Stop();
+
+			Response = "OK";
+			return true;
+		}
+
+		Response = "ERROR unknown request " + Words[ 0 ] + ", expected generate, inspect, stats or shutdown";
+		return false;
+	} );
+
+	printf( "Daemon stopped\n" );
+
+	return 0;
 }
 
 int main(int argc, const char* argv[])
 {
-	std::string DLLPathIn;
-	std::string OutDirIn;
-	std::string VSProjectName;
-	std::string ForwardDLL;
+	CommandLine Args;
 
-	bool Verbose           = false;
-	bool ShouldShowHelp    = false;
-	bool GenerateVSProject = false;
-	bool PreferDef         = false;
+	auto& Options = Args.Options;
 
 	auto CommandLineParser = lyra::cli();
 
-	CommandLineParser.add_argument( lyra::help( ShouldShowHelp ) );
-	CommandLineParser.add_argument( lyra::opt ( Verbose )                        [ "-v" ]  [ "--verbose" ]     ( "Show infomation about exports" ) );
-	CommandLineParser.add_argument( lyra::opt ( GenerateVSProject )              [ "-p" ]  [ "--visualstudio" ]( "Generate Visual Studio project" ) );
-	CommandLineParser.add_argument( lyra::opt ( PreferDef )                      [ "-d" ]  [ "--def" ]         ( "Prefer def file over #pragma" ) );
-	CommandLineParser.add_argument( lyra::opt ( ForwardDLL,    "NEWDLLNAME" )    [ "-f" ]  [ "--forward" ]     ( "Use export forwarding to forward exports to old DLL with new name" ) );
-	CommandLineParser.add_argument( lyra::opt ( VSProjectName, "PROJNAME" )      [ "-n" ]  [ "--vsname" ]      ( "Name for visual studio project" ) );
-	CommandLineParser.add_argument( lyra::opt ( OutDirIn,      "OUTDIR" )        [ "-o" ]  [ "--out" ]         ( "Out directory for files" ) );
-	CommandLineParser.add_argument( lyra::arg ( DLLPathIn,     "DLLPATH" )                                     ( "Path of the DLL to get exports from" ).required() );
+	AddCommandLineOptions( CommandLineParser, Args );
 
 	// Parse the program arguments:
 	auto ParsedArgs = CommandLineParser.parse( { argc, argv } );
@@ -229,60 +1531,88 @@ int main(int argc, const char* argv[])
 		return 1;
 	}
 
-	if ( ShouldShowHelp )
+	if ( Args.ShowHelp )
 	{
 		std::cout << CommandLineParser << std::endl;
 		return 0;
 	}
 
-	std::vector<ExportEntry> Entries;
+	if ( Args.ShowTimings || Args.StatsPath.size() )
+		RunStats::Enable();
+
+	if ( Args.IndexQueryPath.size() )
+		return RunIndexQuery( Args.IndexQueryPath, Args.DLLPaths, Options.Verbose );
 
-	std::filesystem::path DLLPath = DLLPathIn;
+	if ( Args.IndexBuildPath.size() )
+		return RunIndexBuild( Args.IndexBuildPath, Args.DLLPaths, Args.NumberOfJobs );
 
-	UINT16 MachineType = 0;
+	/* Each request brings its own options and DLL */
+	if ( Args.DaemonSocket.size() )
+		return RunDaemon( Args.DaemonSocket, Args.NumberOfJobs );
 
-	if ( OutDirIn.size() != 0 )
+	if ( !FinishOptions( Args ) )
+		return 1;
+
+	int ExitCode = 0;
+
+	if ( Args.Batch && ( Options.DLLName.size() || Options.DiffDLL.size() ) )
+	{
+		printf( "--dllname and --diff describe a single DLL, they cant be used with --batch\n" );
+		return 1;
+	}
+
+	if ( Args.Watch )
 	{
-		if ( !std::filesystem::exists( OutDirIn ) || !std::filesystem::is_directory( OutDirIn ) )
+		if ( std::any_of( Args.DLLPaths.begin(), Args.DLLPaths.end(), []( const std::string& Input ) { return IsStdinPath( Input ); } ) )
 		{
-			printf( "Enter valid output directory\n" );
+			printf( "--watch needs DLLs on disk, it cant read from stdin\n" );
+			return 1;
+		}
+
+		if ( !Args.Batch && Args.DLLPaths.size() != 1 )
+		{
+			printf( "Pass a single DLLPATH or use --batch\n" );
 			return 1;
 		}
-	}
 
-	if ( !std::filesystem::exists( DLLPath ) )
+		ExitCode = RunWatch( Options, Args.DLLPaths, Args.OutDir.size() ? Args.OutDir : ".", Args.Batch );
+	}
+	else if ( Args.Batch )
 	{
-		printf( "DLL file doesnt exist\n" );
-		return 2;
+		ExitCode = RunBatch( Options, Args.DLLPaths, Args.OutDir.size() ? Args.OutDir : ".", Args.NumberOfJobs );
 	}
-
-	auto DLLName = DLLPath.filename().replace_extension( "" ).string();
-
-	if ( VSProjectName.size() == 0 )
-		VSProjectName = DLLName + " Proxy";
-
-	if ( ExportEntry::GetExportEntries( DLLPath, Entries, Verbose, &MachineType ) )
+	else
 	{
-		auto VSGen = VSGenerator( VSProjectName, OutDirIn, MachineType );
-
-		std::filesystem::path OutputDir = OutDirIn;
+		if ( Args.DLLPaths.size() != 1 )
+		{
+			printf( "Pass a single DLLPATH or use --batch\n" );
+			return 1;
+		}
 
-		if ( GenerateVSProject )
-			OutputDir = VSGen.GetProjectPath();
+		std::filesystem::path DLLPath = Args.DLLPaths[ 0 ];
 
-		if ( ForwardDLL.size() )
+		if ( IsStdinPath( DLLPath ) && Options.DLLName.size() == 0 )
 		{
-			GenerateForwardedExports( VSGen, GenerateVSProject, OutputDir, DLLName, std::filesystem::path( ForwardDLL ).replace_extension().string(), Entries, PreferDef );
+			printf( "Reading from stdin needs --dllname for the original DLL\n" );
+			return 1;
 		}
-		else
+
+		if ( !IsStdinPath( DLLPath ) && !std::filesystem::exists( DLLPath ) )
 		{
-			GenerateASM( VSGen, GenerateVSProject, OutputDir, DLLName, Entries, PreferDef, MachineType );
+			printf( "DLL file doesnt exist\n" );
+			return 2;
 		}
 
-		//GenerateDefForwardedExports( DLLName, Entries );
-		//GeneratePragmasForwardedExports( DLLName, Entries );
-		//GenerateASM( DLLName, Entries, true, MachineType );
+		ProxyResult Result;
+
+		GenerateProxy( Options, DLLPath, Args.OutDir, Result );
 	}
 
-	return 0;
+	if ( Args.ShowTimings )
+		RunStats::PrintSummary();
+
+	if ( Args.StatsPath.size() && !RunStats::WriteJSON( Args.StatsPath ) && ExitCode == 0 )
+		ExitCode = 1;
+
+	return ExitCode;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Export Generator.h"
+
+/*
+	Newline delimited JSON description of the source DLL for tooling. The
+	first record describes the image, every following record is one export.
+	Records are appended straight into the output buffer as they come so a
+	manifest costs one pass over the table and a single write.
+*/
+class ManifestGenerator : public ExportGenerator
+{
+public:
+	ManifestGenerator(
+		_In_ std::filesystem::path Path,
+		_In_ const std::string&    DLLName,
+		_In_ const ExportTable&    Entries
+	) :	ExportGenerator( Path ), DLLName( DLLName ), Entries( Entries )
+	{
+
+	}
+
+	static const char* GetMachineName(
+		_In_ UINT16 MachineType
+	)
+	{
+		switch ( MachineType )
+		{
+			case IMAGE_FILE_MACHINE_AMD64:
+				return "AMD64";
+			case IMAGE_FILE_MACHINE_I386:
+				return "I386";
+			case IMAGE_FILE_MACHINE_ARM64:
+				return "ARM64";
+			default:
+				return "UNKNOWN";
+		}
+	}
+
+	virtual bool Begin(
+		_In_opt_ UINT16 MachineType     = 0,
+		_In_opt_ SIZE_T NumberOfEntries = 0
+	)
+	{
+		if ( MachineType == 0 )
+			MachineType = Entries.GetMachine();
+
+		File.Reserve( 128 + Entries.size() * 96 );
+
+		File << "{\"type\":\"image\",\"name\":";
+		this->AppendString( DLLName );
+		File << ",\"machine\":\"" << GetMachineName( MachineType ) << "\"";
+		File << ",\"machine_id\":" << MachineType;
+		File << ",\"timestamp\":" << Entries.GetTimeDateStamp();
+		File << ",\"image_base\":\"0x";
+		File.AppendHex( Entries.GetImageBase() );
+		File << "\",\"ordinal_base\":" << Entries.GetOrdinalBase();
+		File << ",\"exports\":" << (UINT64)Entries.size() << "}\n";
+
+		return true;
+	}
+
+	virtual bool End()
+	{
+		return true;
+	}
+
+	virtual bool AddExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& SymbolName
+	)
+	{
+		File << "{\"type\":\"export\",\"ordinal\":" << Export.GetOrdinal() << ",\"name\":";
+
+		if ( Export.HasName() )
+			this->AppendString( Export.GetName() );
+		else
+			File << "null";
+
+		if ( Export.IsForwarded() )
+		{
+			File << ",\"rva\":null,\"kind\":\"forwarder\",\"forwarder\":";
+			this->AppendString( Export.GetForwardedName() );
+		}
+		else
+		{
+			File << ",\"rva\":" << Export.GetRVA() << ",\"kind\":\"" << ( Export.IsData() ? "data" : "code" ) << "\",\"forwarder\":null";
+		}
+
+		File << "}\n";
+
+		return true;
+	}
+
+	/* The manifest always describes the original DLL, forwarding a proxy does not change the record */
+	virtual bool AddForwardedExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& DLLNameToForwardTo
+	)
+	{
+		return this->AddExportEntry( Export, DLLNameToForwardTo );
+	}
+
+private:
+	/* Export names are raw bytes, anything outside printable ASCII is escaped so every record stays valid JSON */
+	void AppendString(
+		_In_ std::string_view Text
+	)
+	{
+		File << '"';
+
+		for ( const char Character : Text )
+		{
+			const auto Byte = (UINT8)Character;
+
+			if ( Byte == '"' || Byte == '\\' )
+			{
+				File << '\\' << Character;
+			}
+			else if ( Byte < 0x20 || Byte >= 0x7F )
+			{
+				File << "\\u00";
+				File.AppendHex( Byte, 2 );
+			}
+			else
+			{
+				File << Character;
+			}
+		}
+
+		File << '"';
+	}
+
+	std::string        DLLName;
+	const ExportTable& Entries;
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "MappedFile.h"
+
+#if defined( _WIN32 )
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool MappedFile::Open(
+	_In_ const std::filesystem::path& Path
+)
+{
+	this->Close();
+
+#if defined( _WIN32 )
+	this->FileHandle = CreateFileW( Path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if ( this->FileHandle == INVALID_HANDLE_VALUE )
+	{
+		printf( "Failed to open %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	LARGE_INTEGER FileSize;
+
+	if ( !GetFileSizeEx( this->FileHandle, &FileSize ) || FileSize.QuadPart == 0 )
+	{
+		printf( "Failed to get size of %s\n", Path.string().c_str() );
+		this->Close();
+		return false;
+	}
+
+	this->MappingHandle = CreateFileMappingW( this->FileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+
+	if ( this->MappingHandle == NULL )
+	{
+		printf( "Failed to create mapping of %s\n", Path.string().c_str() );
+		this->Close();
+		return false;
+	}
+
+	this->Data = (const UINT8*)MapViewOfFile( this->MappingHandle, FILE_MAP_READ, 0, 0, 0 );
+	this->Size = (SIZE_T)FileSize.QuadPart;
+#else
+	this->FileDescriptor = open( Path.c_str(), O_RDONLY | O_CLOEXEC );
+
+	if ( this->FileDescriptor < 0 )
+	{
+		printf( "Failed to open %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	struct stat FileStat;
+
+	if ( fstat( this->FileDescriptor, &FileStat ) != 0 || FileStat.st_size == 0 )
+	{
+		printf( "Failed to get size of %s\n", Path.string().c_str() );
+		this->Close();
+		return false;
+	}
+
+	auto Mapping = mmap( NULL, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, this->FileDescriptor, 0 );
+
+	if ( Mapping != MAP_FAILED )
+	{
+		this->Data = (const UINT8*)Mapping;
+		this->Size = (SIZE_T)FileStat.st_size;
+	}
+#endif
+
+	if ( this->Data == NULL )
+	{
+		printf( "Failed to map %s\n", Path.string().c_str() );
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MappedFile::Read(
+	_In_ FILE* Stream
+)
+{
+	this->Close();
+
+#if defined( _WIN32 )
+	/* Text mode would eat every \r\n in the image */
+	_setmode( _fileno( Stream ), _O_BINARY );
+#endif
+
+	SIZE_T Used = 0;
+
+	this->Buffer.resize( 1 << 20 );
+
+	for ( ;; )
+	{
+		Used += fread( this->Buffer.data() + Used, 1, this->Buffer.size() - Used, Stream );
+
+		if ( Used < this->Buffer.size() )
+			break;
+
+		this->Buffer.resize( this->Buffer.size() * 2 );
+	}
+
+	if ( ferror( Stream ) || Used == 0 )
+	{
+		printf( "Failed to read image from stream\n" );
+		this->Close();
+		return false;
+	}
+
+	this->Buffer.resize( Used );
+
+	this->Data = this->Buffer.data();
+	this->Size = Used;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	/* Read fills Buffer, only a real mapping needs unmapping */
+	if ( this->Buffer.size() )
+	{
+		this->Data = NULL;
+		this->Buffer.clear();
+		this->Buffer.shrink_to_fit();
+	}
+
+#if defined( _WIN32 )
+	if ( this->Data != NULL )
+		UnmapViewOfFile( this->Data );
+
+	if ( this->MappingHandle != NULL )
+		CloseHandle( this->MappingHandle );
+
+	if ( this->FileHandle != INVALID_HANDLE_VALUE )
+		CloseHandle( this->FileHandle );
+
+	this->MappingHandle = NULL;
+	this->FileHandle    = INVALID_HANDLE_VALUE;
+#else
+	if ( this->Data != NULL )
+		munmap( (void*)this->Data, this->Size );
+
+	if ( this->FileDescriptor >= 0 )
+		close( this->FileDescriptor );
+
+	this->FileDescriptor = -1;
+#endif
+
+	this->Data = NULL;
+	this->Size = 0;
+}
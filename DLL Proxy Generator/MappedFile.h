@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Platform.h"
+#include <filesystem>
+#include <vector>
+
+/*
+	Read only view of a whole file. Uses MapViewOfFile on Windows and mmap
+	everywhere else, pointers handed out stay valid until Close.
+
+	Pipes and stdin cant be mapped, Read pulls those into a buffer the view
+	owns instead so callers see the same Data and Size either way.
+*/
+class MappedFile
+{
+public:
+	MappedFile() : Data( NULL ), Size( 0 )
+#if defined( _WIN32 )
+		, FileHandle( INVALID_HANDLE_VALUE ), MappingHandle( NULL )
+#else
+		, FileDescriptor( -1 )
+#endif
+	{
+
+	}
+
+	~MappedFile()
+	{
+		this->Close();
+	}
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	bool Open(
+		_In_ const std::filesystem::path& Path
+	);
+
+	/* Reads Stream to the end, it is left open for the caller */
+	bool Read(
+		_In_ FILE* Stream
+	);
+
+	void Close();
+
+	bool IsOpen() const
+	{
+		return this->Data != NULL;
+	}
+
+	const UINT8* GetData() const
+	{
+		return this->Data;
+	}
+
+	SIZE_T GetSize() const
+	{
+		return this->Size;
+	}
+
+private:
+	const UINT8*        Data;
+	SIZE_T              Size;
+	std::vector< BYTE > Buffer;
+#if defined( _WIN32 )
+	HANDLE              FileHandle;
+	HANDLE              MappingHandle;
+#else
+	int                 FileDescriptor;
+#endif
+};
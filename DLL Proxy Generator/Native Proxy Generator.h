@@ -0,0 +1,510 @@
+#pragma once
+
+#include "Export Generator.h"
+#include "PEWriter.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+/*
+	Writes the finished proxy DLL instead of sources for one.
+
+	The export directory mirrors the original: same ordinal base, names and
+	NONAME ordinals, forwarders stay forwarders. Every other export gets an
+	8 byte jmp through g_FunctionTable and DllMain fills the table with
+	GetProcAddress on the original DLL, like the generated DLLMain.cpp. The
+	image is parsed back with the tool's own reader before it is written.
+*/
+class NativeProxyGenerator : public ExportGenerator
+{
+public:
+	NativeProxyGenerator(
+		_In_ std::filesystem::path Path,
+		_In_ const std::string&    DLLName
+	) :	ExportGenerator( Path, true ), DLLName( DLLName ), MachineType( 0 )
+	{
+
+	}
+
+	virtual bool Begin(
+		_In_opt_ UINT16 MachineType,
+		_In_opt_ SIZE_T NumberOfEntries
+	)
+	{
+		if ( MachineType != IMAGE_FILE_MACHINE_AMD64 && MachineType != IMAGE_FILE_MACHINE_I386 )
+		{
+			printf( "Native proxies are only written for AMD64 and I386, not machine %04X\n", MachineType );
+			return false;
+		}
+
+		this->MachineType = MachineType;
+		this->Exports.reserve( NumberOfEntries );
+
+		return true;
+	}
+
+	virtual bool End()
+	{
+		std::string Image;
+
+		if ( !this->BuildImage( Image ) || !this->Verify( Image ) )
+			return false;
+
+		File << std::string_view( Image );
+		return true;
+	}
+
+	virtual bool AddExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& SymbolName
+	)
+	{
+		if ( Export.IsData() )
+			return false;
+
+		this->Exports.push_back( { Export.GetOrdinal(), Export.GetOrdinalIndex(), std::string( Export.GetName() ), std::string( Export.GetForwardedName() ) } );
+
+		return true;
+	}
+
+	virtual bool AddForwardedExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& DLLNameToForwardTo
+	)
+	{
+		std::string Forwarder;
+
+		if ( Export.IsForwarded() )
+			Forwarder = Export.GetForwardedName();
+		else if ( Export.HasName() )
+			Forwarder = DLLNameToForwardTo + "." + std::string( Export.GetName() );
+		else
+			Forwarder = DLLNameToForwardTo + ".#" + std::to_string( Export.GetOrdinal() );
+
+		this->Exports.push_back( { Export.GetOrdinal(), Export.GetOrdinalIndex(), std::string( Export.GetName() ), Forwarder } );
+
+		return true;
+	}
+
+private:
+	struct Entry
+	{
+		UINT32      Ordinal;
+		UINT32      OrdinalIndex;
+		std::string Name;
+		std::string Forwarder;
+	};
+
+	/* Where DllMain finds what it needs, filled in while the data sections are laid out */
+	struct ResolverLayout
+	{
+		PEWriter::Location OriginalName;
+		PEWriter::Location LoadLibrary;
+		PEWriter::Location GetProcAddress;
+		PEWriter::Location NameTable;
+		PEWriter::Location FunctionTable;
+		UINT32             NumberOfSlots;
+	};
+
+	bool BuildImage(
+		_Inout_ std::string& Image
+	)
+	{
+		PEWriter Writer( this->MachineType );
+
+		const UINT32 PointerSize       = Writer.IsPE32Plus() ? sizeof( UINT64 ) : sizeof( UINT32 );
+		const UINT32 NumberOfFunctions = this->Exports.empty() ? 0 : this->Exports.back().OrdinalIndex + 1;
+		const UINT32 OrdinalBase       = this->Exports.empty() ? 1 : this->Exports.front().Ordinal - this->Exports.front().OrdinalIndex;
+		const bool   NeedsCode         = std::any_of( this->Exports.begin(), this->Exports.end(), []( const Entry& Export ) { return Export.Forwarder.empty(); } );
+
+		const auto Text  = NeedsCode ? Writer.AddSection( ".text", IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ ) : 0;
+		const auto RData = Writer.AddSection( ".rdata", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ );
+		const auto Data  = NeedsCode ? Writer.AddSection( ".data", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE ) : 0;
+
+		auto& ReadOnly = Writer.GetData( RData );
+
+		/* The loader binary searches the name pointer table so names go in byte order */
+		std::vector< const Entry* > Named;
+
+		for ( const auto& Export : this->Exports )
+		{
+			if ( Export.Name.size() )
+				Named.push_back( &Export );
+		}
+
+		std::sort( Named.begin(), Named.end(), []( const Entry* Left, const Entry* Right ) { return strcmp( Left->Name.c_str(), Right->Name.c_str() ) < 0; } );
+
+		const UINT32 AddressOfFunctions    = sizeof( IMAGE_EXPORT_DIRECTORY );
+		const UINT32 AddressOfNames        = AddressOfFunctions + NumberOfFunctions * sizeof( UINT32 );
+		const UINT32 AddressOfNameOrdinals = AddressOfNames + (UINT32)Named.size() * sizeof( UINT32 );
+
+		IMAGE_EXPORT_DIRECTORY Directory = {};
+
+		Directory.Base              = OrdinalBase;
+		Directory.NumberOfFunctions = NumberOfFunctions;
+		Directory.NumberOfNames     = (DWORD)Named.size();
+
+		PEWriter::Append( ReadOnly, &Directory, sizeof( Directory ) );
+		ReadOnly.resize( AddressOfNameOrdinals + Named.size() * sizeof( UINT16 ), 0 );
+
+		Writer.AddFixup( { RData, offsetof( IMAGE_EXPORT_DIRECTORY, AddressOfFunctions ) },    PEWriter::FixupRVA32, { RData, AddressOfFunctions } );
+		Writer.AddFixup( { RData, offsetof( IMAGE_EXPORT_DIRECTORY, AddressOfNames ) },        PEWriter::FixupRVA32, { RData, AddressOfNames } );
+		Writer.AddFixup( { RData, offsetof( IMAGE_EXPORT_DIRECTORY, AddressOfNameOrdinals ) }, PEWriter::FixupRVA32, { RData, AddressOfNameOrdinals } );
+		Writer.AddFixup( { RData, offsetof( IMAGE_EXPORT_DIRECTORY, Name ) },                  PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+		PEWriter::AppendString( ReadOnly, this->DLLName + ".dll" );
+
+		/* Name strings are shared with the resolver's table below */
+		std::vector< UINT32 > NameOffsets( this->Exports.size(), 0 );
+
+		for ( UINT32 NameIndex = 0; NameIndex < Named.size(); NameIndex++ )
+		{
+			const auto Export = Named[ NameIndex ];
+
+			NameOffsets[ Export - this->Exports.data() ] = (UINT32)ReadOnly.size();
+
+			Writer.AddFixup( { RData, AddressOfNames + NameIndex * (UINT32)sizeof( UINT32 ) }, PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+			memcpy( ReadOnly.data() + AddressOfNameOrdinals + NameIndex * sizeof( UINT16 ), &Export->OrdinalIndex, sizeof( UINT16 ) );
+			PEWriter::AppendString( ReadOnly, Export->Name );
+		}
+
+		/* Forwarder strings have to sit inside the export directory, that is how the loader tells them apart */
+		for ( const auto& Export : this->Exports )
+		{
+			if ( Export.Forwarder.empty() )
+				continue;
+
+			Writer.AddFixup( { RData, AddressOfFunctions + Export.OrdinalIndex * (UINT32)sizeof( UINT32 ) }, PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+			PEWriter::AppendString( ReadOnly, Export.Forwarder );
+		}
+
+		Writer.SetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXPORT, { RData, 0 }, (UINT32)ReadOnly.size() );
+
+		if ( NeedsCode )
+		{
+			ResolverLayout Layout;
+
+			Layout.NumberOfSlots = NumberOfFunctions;
+
+			/* One DWORD per slot for DllMain: 0 for none, the high bit plus an ordinal, or the RVA of a name */
+			PEWriter::Align( ReadOnly, sizeof( UINT32 ) );
+			Layout.NameTable = Writer.GetEnd( RData );
+
+			ReadOnly.resize( ReadOnly.size() + NumberOfFunctions * sizeof( UINT32 ), 0 );
+
+			for ( SIZE_T Index = 0; Index < this->Exports.size(); Index++ )
+			{
+				const auto& Export = this->Exports[ Index ];
+				const auto  Slot   = PEWriter::Location{ RData, Layout.NameTable.Offset + Export.OrdinalIndex * (UINT32)sizeof( UINT32 ) };
+
+				if ( Export.Forwarder.size() )
+					continue;
+
+				if ( Export.Name.size() )
+				{
+					Writer.AddFixup( Slot, PEWriter::FixupRVA32, { RData, NameOffsets[ Index ] } );
+				}
+				else
+				{
+					const UINT32 ByOrdinal = 0x80000000 | Export.Ordinal;
+
+					memcpy( ReadOnly.data() + Slot.Offset, &ByOrdinal, sizeof( ByOrdinal ) );
+				}
+			}
+
+			this->AddImports( Writer, RData, Data, PointerSize, Layout );
+
+			Layout.OriginalName = Writer.GetEnd( RData );
+			PEWriter::AppendString( ReadOnly, this->DLLName + ".dll" );
+
+			/* Table slots are filled at runtime, keep them out of the file and start them on a cache line */
+			auto& ReadWrite = Writer.GetData( Data );
+
+			PEWriter::Align( ReadWrite, 64 );
+			Layout.FunctionTable = Writer.GetEnd( Data );
+			Writer.SetUninitializedSize( Data, NumberOfFunctions * PointerSize );
+
+			auto& Code = Writer.GetData( Text );
+
+			Writer.SetEntryPoint( Writer.GetEnd( Text ) );
+
+			if ( Writer.IsPE32Plus() )
+				this->EmitDllMain64( Writer, Text, RData, Layout );
+			else
+				this->EmitDllMain32( Writer, Text, Layout );
+
+			PEWriter::Align( Code, 16, 0xCC );
+
+			/* jmp [g_FunctionTable + Slot], padded with int3 to StubSize */
+			for ( const auto& Export : this->Exports )
+			{
+				if ( Export.Forwarder.size() )
+					continue;
+
+				const auto Target = PEWriter::Location{ Data, Layout.FunctionTable.Offset + Export.OrdinalIndex * PointerSize };
+
+				Writer.AddFixup( { RData, AddressOfFunctions + Export.OrdinalIndex * (UINT32)sizeof( UINT32 ) }, PEWriter::FixupRVA32, Writer.GetEnd( Text ) );
+
+				Code.push_back( 0xFF );
+				Code.push_back( 0x25 );
+				Writer.AddFixup( Writer.GetEnd( Text ), Writer.IsPE32Plus() ? PEWriter::FixupRel32 : PEWriter::FixupVA32, Target );
+				PEWriter::AppendU32( Code, 0 );
+				Code.push_back( 0xCC );
+				Code.push_back( 0xCC );
+			}
+		}
+
+		return Writer.Build( Image );
+	}
+
+	/* KERNEL32!LoadLibraryA and GetProcAddress, the IAT goes at the start of .data */
+	void AddImports(
+		_Inout_ PEWriter&       Writer,
+		_In_    SIZE_T          RData,
+		_In_    SIZE_T          Data,
+		_In_    UINT32          PointerSize,
+		_Inout_ ResolverLayout& Layout
+	)
+	{
+		auto& ReadOnly  = Writer.GetData( RData );
+		auto& ReadWrite = Writer.GetData( Data );
+
+		const char* Functions[] = { "LoadLibraryA", "GetProcAddress" };
+
+		PEWriter::Align( ReadOnly, sizeof( UINT32 ) );
+
+		const auto Descriptor = Writer.GetEnd( RData );
+
+		ReadOnly.resize( ReadOnly.size() + 2 * sizeof( IMAGE_IMPORT_DESCRIPTOR ), 0 );
+
+		PEWriter::Align( ReadOnly, PointerSize );
+
+		const auto LookupTable = Writer.GetEnd( RData );
+		const auto AddressTable = Writer.GetEnd( Data );
+
+		ReadOnly.resize( ReadOnly.size() + 3 * PointerSize, 0 );
+		ReadWrite.resize( ReadWrite.size() + 3 * PointerSize, 0 );
+
+		Layout.LoadLibrary    = { Data, AddressTable.Offset };
+		Layout.GetProcAddress = { Data, AddressTable.Offset + PointerSize };
+
+		for ( UINT32 Index = 0; Index < 2; Index++ )
+		{
+			PEWriter::Align( ReadOnly, sizeof( UINT16 ) );
+
+			Writer.AddFixup( { RData, LookupTable.Offset + Index * PointerSize },   PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+			Writer.AddFixup( { Data,  AddressTable.Offset + Index * PointerSize }, PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+
+			PEWriter::AppendU16( ReadOnly, 0 );
+			PEWriter::AppendString( ReadOnly, Functions[ Index ] );
+		}
+
+		Writer.AddFixup( { RData, Descriptor.Offset + (UINT32)offsetof( IMAGE_IMPORT_DESCRIPTOR, OriginalFirstThunk ) }, PEWriter::FixupRVA32, LookupTable );
+		Writer.AddFixup( { RData, Descriptor.Offset + (UINT32)offsetof( IMAGE_IMPORT_DESCRIPTOR, FirstThunk ) },         PEWriter::FixupRVA32, AddressTable );
+		Writer.AddFixup( { RData, Descriptor.Offset + (UINT32)offsetof( IMAGE_IMPORT_DESCRIPTOR, Name ) },               PEWriter::FixupRVA32, Writer.GetEnd( RData ) );
+		PEWriter::AppendString( ReadOnly, "KERNEL32.dll" );
+
+		Writer.SetDataDirectory( IMAGE_DIRECTORY_ENTRY_IMPORT, Descriptor, 2 * sizeof( IMAGE_IMPORT_DESCRIPTOR ) );
+		Writer.SetDataDirectory( IMAGE_DIRECTORY_ENTRY_IAT, AddressTable, 3 * PointerSize );
+	}
+
+	/*
+		BOOL WINAPI DllMain( HINSTANCE Instance, DWORD Reason, LPVOID )
+		{
+			if ( Reason == DLL_PROCESS_ATTACH && ( Module = LoadLibraryA( OriginalName ) ) )
+				for ( Slot = 0; Slot < NumberOfSlots; Slot++ )
+					if ( NameTable[ Slot ] )
+						g_FunctionTable[ Slot ] = GetProcAddress( Module, NameTable[ Slot ] < 0 ? LOWORD( NameTable[ Slot ] ) : Instance + NameTable[ Slot ] );
+			return TRUE;
+		}
+
+		Labels are patched as rel8 once their target is emitted, the body is
+		far shorter than 128 bytes.
+	*/
+	void EmitDllMain64(
+		_Inout_ PEWriter&             Writer,
+		_In_    SIZE_T                Text,
+		_In_    SIZE_T                RData,
+		_In_    const ResolverLayout& Layout
+	)
+	{
+		auto&      Code  = Writer.GetData( Text );
+		const auto Start = (UINT32)Code.size();
+
+		auto Emit = [ &Code ]( std::initializer_list< BYTE > Bytes ) { Code.insert( Code.end(), Bytes ); };
+		auto Rel32 = [ & ]( PEWriter::Location Target ) { Writer.AddFixup( Writer.GetEnd( Text ), PEWriter::FixupRel32, Target ); PEWriter::AppendU32( Code, 0 ); };
+		auto Jump = [ &Code ]( BYTE Opcode ) { Code.push_back( Opcode ); Code.push_back( 0 ); return Code.size() - 1; };
+		auto Bind = [ &Code ]( SIZE_T Patch ) { Code[ Patch ] = (BYTE)( Code.size() - Patch - 1 ); };
+
+		Emit( { 0x53, 0x56, 0x57 } );                // push rbx; push rsi; push rdi
+		Emit( { 0x48, 0x83, 0xEC, 0x20 } );          // sub rsp, 20h
+		const auto PrologSize = (UINT32)Code.size() - Start;
+
+		Emit( { 0x83, 0xFA, 0x01 } );                // cmp edx, DLL_PROCESS_ATTACH
+		const auto NotAttach = Jump( 0x75 );         // jne Done
+		Emit( { 0x48, 0x89, 0xCB } );                // mov rbx, rcx
+		Emit( { 0x48, 0x8D, 0x0D } );                // lea rcx, [OriginalName]
+		Rel32( Layout.OriginalName );
+		Emit( { 0xFF, 0x15 } );                      // call [LoadLibraryA]
+		Rel32( Layout.LoadLibrary );
+		Emit( { 0x48, 0x85, 0xC0 } );                // test rax, rax
+		const auto NotLoaded = Jump( 0x74 );         // jz Done
+		Emit( { 0x48, 0x89, 0xC6 } );                // mov rsi, rax
+		Emit( { 0x31, 0xFF } );                      // xor edi, edi
+
+		const auto Loop = Code.size();
+		Emit( { 0x81, 0xFF } );                      // cmp edi, NumberOfSlots
+		PEWriter::AppendU32( Code, Layout.NumberOfSlots );
+		const auto Finished = Jump( 0x73 );          // jae Done
+		Emit( { 0x48, 0x8D, 0x05 } );                // lea rax, [NameTable]
+		Rel32( Layout.NameTable );
+		Emit( { 0x8B, 0x14, 0xB8 } );                // mov edx, [rax + rdi * 4]
+		Emit( { 0x85, 0xD2 } );                      // test edx, edx
+		const auto Empty = Jump( 0x74 );             // jz Next
+		const auto ByOrdinal = Jump( 0x78 );         // js Ordinal
+		Emit( { 0x48, 0x01, 0xDA } );                // add rdx, rbx
+		const auto ByName = Jump( 0xEB );            // jmp Resolve
+		Bind( ByOrdinal );
+		Emit( { 0x0F, 0xB7, 0xD2 } );                // movzx edx, dx
+		Bind( ByName );
+		Emit( { 0x48, 0x89, 0xF1 } );                // mov rcx, rsi
+		Emit( { 0xFF, 0x15 } );                      // call [GetProcAddress]
+		Rel32( Layout.GetProcAddress );
+		Emit( { 0x48, 0x8D, 0x0D } );                // lea rcx, [g_FunctionTable]
+		Rel32( Layout.FunctionTable );
+		Emit( { 0x48, 0x89, 0x04, 0xF9 } );          // mov [rcx + rdi * 8], rax
+		Bind( Empty );
+		Emit( { 0xFF, 0xC7 } );                      // inc edi
+		Code.push_back( 0xEB );                      // jmp Loop
+		Code.push_back( (BYTE)( Loop - Code.size() - 1 ) );
+
+		Bind( NotAttach );
+		Bind( NotLoaded );
+		Bind( Finished );
+		Emit( { 0xB8, 0x01, 0x00, 0x00, 0x00 } );    // mov eax, TRUE
+		Emit( { 0x48, 0x83, 0xC4, 0x20 } );          // add rsp, 20h
+		Emit( { 0x5F, 0x5E, 0x5B } );                // pop rdi; pop rsi; pop rbx
+		Emit( { 0xC3 } );                            // ret
+
+		const auto End = (UINT32)Code.size();
+
+		/* DllMain calls out so it needs unwind data, the stubs are plain jumps and dont */
+		auto& ReadOnly = Writer.GetData( RData );
+
+		PEWriter::Align( ReadOnly, sizeof( UINT32 ) );
+
+		const auto UnwindInfo = Writer.GetEnd( RData );
+
+		ReadOnly.insert( ReadOnly.end(), {
+			0x01, (BYTE)PrologSize, 0x04, 0x00,      // version 1, prolog size, 4 codes, no frame register
+			(BYTE)PrologSize, 0x32,                  // UWOP_ALLOC_SMALL 20h
+			0x03, 0x70,                              // UWOP_PUSH_NONVOL rdi
+			0x02, 0x60,                              // UWOP_PUSH_NONVOL rsi
+			0x01, 0x30,                              // UWOP_PUSH_NONVOL rbx
+		} );
+
+		const auto RuntimeFunction = Writer.GetEnd( RData );
+
+		ReadOnly.resize( ReadOnly.size() + 3 * sizeof( UINT32 ), 0 );
+
+		Writer.AddFixup( { RData, RuntimeFunction.Offset },     PEWriter::FixupRVA32, { Text, Start } );
+		Writer.AddFixup( { RData, RuntimeFunction.Offset + 4 }, PEWriter::FixupRVA32, { Text, End } );
+		Writer.AddFixup( { RData, RuntimeFunction.Offset + 8 }, PEWriter::FixupRVA32, UnwindInfo );
+
+		Writer.SetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXCEPTION, RuntimeFunction, 3 * sizeof( UINT32 ) );
+	}
+
+	void EmitDllMain32(
+		_Inout_ PEWriter&             Writer,
+		_In_    SIZE_T                Text,
+		_In_    const ResolverLayout& Layout
+	)
+	{
+		auto& Code = Writer.GetData( Text );
+
+		auto Emit = [ &Code ]( std::initializer_list< BYTE > Bytes ) { Code.insert( Code.end(), Bytes ); };
+		auto VA32 = [ & ]( PEWriter::Location Target ) { Writer.AddFixup( Writer.GetEnd( Text ), PEWriter::FixupVA32, Target ); PEWriter::AppendU32( Code, 0 ); };
+		auto Jump = [ &Code ]( BYTE Opcode ) { Code.push_back( Opcode ); Code.push_back( 0 ); return Code.size() - 1; };
+		auto Bind = [ &Code ]( SIZE_T Patch ) { Code[ Patch ] = (BYTE)( Code.size() - Patch - 1 ); };
+
+		Emit( { 0x53, 0x56, 0x57 } );                // push ebx; push esi; push edi
+		Emit( { 0x83, 0x7C, 0x24, 0x14, 0x01 } );    // cmp dword ptr [esp + 14h], DLL_PROCESS_ATTACH
+		const auto NotAttach = Jump( 0x75 );         // jne Done
+		Emit( { 0x8B, 0x5C, 0x24, 0x10 } );          // mov ebx, [esp + 10h]
+		Emit( { 0x68 } );                            // push OriginalName
+		VA32( Layout.OriginalName );
+		Emit( { 0xFF, 0x15 } );                      // call [LoadLibraryA]
+		VA32( Layout.LoadLibrary );
+		Emit( { 0x85, 0xC0 } );                      // test eax, eax
+		const auto NotLoaded = Jump( 0x74 );         // jz Done
+		Emit( { 0x89, 0xC6 } );                      // mov esi, eax
+		Emit( { 0x31, 0xFF } );                      // xor edi, edi
+
+		const auto Loop = Code.size();
+		Emit( { 0x81, 0xFF } );                      // cmp edi, NumberOfSlots
+		PEWriter::AppendU32( Code, Layout.NumberOfSlots );
+		const auto Finished = Jump( 0x73 );          // jae Done
+		Emit( { 0x8B, 0x14, 0xBD } );                // mov edx, [NameTable + edi * 4]
+		VA32( Layout.NameTable );
+		Emit( { 0x85, 0xD2 } );                      // test edx, edx
+		const auto Empty = Jump( 0x74 );             // jz Next
+		const auto ByOrdinal = Jump( 0x78 );         // js Ordinal
+		Emit( { 0x01, 0xDA } );                      // add edx, ebx
+		const auto ByName = Jump( 0xEB );            // jmp Resolve
+		Bind( ByOrdinal );
+		Emit( { 0x0F, 0xB7, 0xD2 } );                // movzx edx, dx
+		Bind( ByName );
+		Emit( { 0x52, 0x56 } );                      // push edx; push esi
+		Emit( { 0xFF, 0x15 } );                      // call [GetProcAddress]
+		VA32( Layout.GetProcAddress );
+		Emit( { 0x89, 0x04, 0xBD } );                // mov [g_FunctionTable + edi * 4], eax
+		VA32( Layout.FunctionTable );
+		Bind( Empty );
+		Emit( { 0x47 } );                            // inc edi
+		Code.push_back( 0xEB );                      // jmp Loop
+		Code.push_back( (BYTE)( Loop - Code.size() - 1 ) );
+
+		Bind( NotAttach );
+		Bind( NotLoaded );
+		Bind( Finished );
+		Emit( { 0xB8, 0x01, 0x00, 0x00, 0x00 } );    // mov eax, TRUE
+		Emit( { 0x5F, 0x5E, 0x5B } );                // pop edi; pop esi; pop ebx
+		Emit( { 0xC2, 0x0C, 0x00 } );                // ret 0Ch
+	}
+
+	/* Parses the image back and checks it exports exactly what was added */
+	bool Verify(
+		_In_ const std::string& Image
+	)
+	{
+		PEImage     Parsed;
+		ExportTable Table;
+
+		if ( !Parsed.Open( Image.data(), Image.size() ) || !ExportEntry::GetExportEntries( Parsed, Table, false, NULL ) )
+		{
+			printf( "Native proxy %s failed to parse back\n", this->Path.filename().string().c_str() );
+			return false;
+		}
+
+		bool Matches = Table.size() == this->Exports.size();
+
+		for ( SIZE_T Index = 0; Matches && Index < Table.size(); Index++ )
+		{
+			const auto  Export   = Table[ Index ];
+			const auto& Expected = this->Exports[ Index ];
+
+			Matches = Export.GetOrdinal() == Expected.Ordinal &&
+			          Export.GetName() == Expected.Name &&
+			          Export.GetForwardedName() == Expected.Forwarder &&
+			          !Export.IsData();
+		}
+
+		if ( !Matches )
+			printf( "Native proxy %s does not export what it should\n", this->Path.filename().string().c_str() );
+
+		return Matches;
+	}
+
+	std::string          DLLName;
+	UINT16               MachineType;
+	std::vector< Entry > Exports;
+};
\ No newline at end of file
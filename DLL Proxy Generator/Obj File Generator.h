@@ -0,0 +1,302 @@
+#pragma once
+#include "Export Generator.h"
+#include "Asm File Generator.h"
+#include "COFFWriter.h"
+#include "PEWriter.h"
+#include <vector>
+
+/*
+	Writes the same stubs and lazy entries as ASMFileGenerator, already
+	assembled into a COFF object so the proxy
+	links without ml/ml64. Symbols match what MASM makes of the .asm, I386
+	C symbols carry the underscore and the stubs themselves do not.
+*/
+class ObjFileGenerator : public ExportGenerator
+{
+public:
+	ObjFileGenerator(
+		_In_ std::filesystem::path Path,
+		_In_ bool                  LazyResolve    = false,
+		_In_ bool                  Instrument     = false,
+		_In_ SIZE_T                ShardIndex     = 0,
+		_In_ SIZE_T                NumberOfShards = 1
+	) :	ExportGenerator( Path, true ), Writer( IMAGE_FILE_MACHINE_UNKNOWN ), MachinePointerSize( 0 ), LazyResolve( LazyResolve ), Instrument( Instrument ), ShardIndex( ShardIndex ), NumberOfShards( NumberOfShards ? NumberOfShards : 1 )
+	{
+
+	}
+
+	virtual bool Begin(
+		_In_opt_ UINT16 MachineType,
+		_In_opt_ SIZE_T NumberOfEntries
+	)
+	{
+		if ( NumberOfEntries == 0 )
+			return false;
+
+		switch ( MachineType )
+		{
+			case IMAGE_FILE_MACHINE_AMD64:
+				MachinePointerSize = sizeof( UINT64 );
+				break;
+			case IMAGE_FILE_MACHINE_I386:
+				MachinePointerSize = sizeof( UINT32 );
+				break;
+			default:
+				printf( "Unknown machine type %04X\n", MachineType );
+				return false;
+		}
+
+		const std::string Decoration = ( MachineType == IMAGE_FILE_MACHINE_I386 ) ? "_" : "";
+
+		this->Writer = COFFWriter( MachineType );
+		this->Text   = this->Writer.AddSection( ".text", IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ | ( ASMFileGenerator::GetStubAlignment( MachineType, this->Instrument ) > 16 ? IMAGE_SCN_ALIGN_32BYTES : IMAGE_SCN_ALIGN_16BYTES ) );
+
+		this->Writer.GetData( this->Text ).reserve( NumberOfEntries * 16 );
+
+		/* Nothing in here registers a handler, tell the linker so /SAFESEH images can use it */
+		if ( MachineType == IMAGE_FILE_MACHINE_I386 )
+			this->Writer.AddAbsolute( "@feat.00", 1 );
+
+		/* The table is defined cache line aligned in DLLMain.cpp */
+		this->FunctionTable = this->Writer.AddExternal( Decoration + "g_FunctionTable", false );
+
+		if ( this->Instrument )
+			this->CounterTable = this->Writer.AddExternal( Decoration + "g_CallCounters", false );
+
+		if ( this->LazyResolve && this->ShardIndex != 0 )
+			this->LazyResolverThunk = this->Writer.AddExternal( "LazyResolverThunk", true );
+
+		return true;
+	}
+
+	virtual bool End()
+	{
+		/* Cold code after the stubs, same order as the ASM generator */
+		if ( this->LazyResolve && this->ShardIndex == 0 )
+			this->AddLazyResolverThunk();
+
+		for ( const auto OrdinalIndex : this->LazyEntries )
+			this->AddLazyEntry( OrdinalIndex );
+
+		std::string Object;
+
+		if ( !this->Writer.Build( Object ) )
+			return false;
+
+		File << std::string_view( Object );
+		return true;
+	}
+
+	virtual bool AddExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& SymbolName
+	)
+	{
+		/*
+			Same stub as the ASM generator
+
+			SymbolName:
+				jmp [g_FunctionTable + FunctionIndex * MachinePointerSize]
+
+			rip relative on AMD64, absolute on I386, padded with int 3 to
+			ASMFileGenerator::GetStubAlignment
+		*/
+
+		if ( Export.IsData() )
+		{
+			if ( Export.HasName() )
+			{
+				printf( "Warning export %s is data\n", Export.GetName().data() );
+			}
+			else
+			{
+				printf( "Warning export ordinal %i is data\n", Export.GetOrdinal() );
+			}
+
+			return false;
+		}
+
+		if ( ASMFileGenerator::GetShardIndex( SymbolName, this->NumberOfShards ) != this->ShardIndex )
+			return true;
+
+		auto& Code = this->Writer.GetData( this->Text );
+
+		PEWriter::Align( Code, ASMFileGenerator::GetStubAlignment( this->Writer.GetMachine(), this->Instrument ), 0xCC );
+
+		this->Writer.AddSymbol( SymbolName, this->Text, (UINT32)Code.size(), true );
+
+		if ( this->Instrument )
+			this->AddCounterIncrement( Export.GetOrdinalIndex() );
+
+		Code.push_back( 0xFF );
+		Code.push_back( 0x25 );
+		this->AddAddress( Export.GetOrdinalIndex() * (UINT32)this->MachinePointerSize, this->FunctionTable );
+
+		if ( this->LazyResolve )
+			this->LazyEntries.push_back( Export.GetOrdinalIndex() );
+
+		return true;
+	}
+
+	virtual bool AddForwardedExportEntry(
+		_In_ const ExportEntry& Export,
+		_In_ const std::string& DLLNameToForwardTo
+	)
+	{
+		return false;
+	}
+
+protected:
+	bool IsAMD64() const
+	{
+		return this->Writer.GetMachine() == IMAGE_FILE_MACHINE_AMD64;
+	}
+
+	/* A 32 bit memory operand at the end of the code, rip relative on AMD64 and absolute on I386 */
+	void AddAddress(
+		_In_ UINT32 Addend,
+		_In_ UINT32 Symbol
+	)
+	{
+		auto& Code = this->Writer.GetData( this->Text );
+
+		this->Writer.AddRelocation( this->Text, (UINT32)Code.size(), Symbol, this->IsAMD64() ? IMAGE_REL_AMD64_REL32 : IMAGE_REL_I386_DIR32 );
+		PEWriter::AppendU32( Code, Addend );
+	}
+
+	/* call/jmp rel32 */
+	void AddBranch(
+		_In_ BYTE   Opcode,
+		_In_ UINT32 Symbol
+	)
+	{
+		auto& Code = this->Writer.GetData( this->Text );
+
+		Code.push_back( Opcode );
+		this->Writer.AddRelocation( this->Text, (UINT32)Code.size(), Symbol, this->IsAMD64() ? IMAGE_REL_AMD64_REL32 : IMAGE_REL_I386_REL32 );
+		PEWriter::AppendU32( Code, 0 );
+	}
+
+	/* lock inc qword ptr [g_CallCounters + Index * 64], the I386 form carries into the high half */
+	void AddCounterIncrement(
+		_In_ UINT32 OrdinalIndex
+	)
+	{
+		auto& Code = this->Writer.GetData( this->Text );
+
+		if ( this->IsAMD64() )
+		{
+			Code.insert( Code.end(), { 0xF0, 0x48, 0xFF, 0x05 } );
+			this->AddAddress( OrdinalIndex * 64, this->CounterTable );
+		}
+		else
+		{
+			Code.insert( Code.end(), { 0xF0, 0x83, 0x05 } );
+			this->AddAddress( OrdinalIndex * 64, this->CounterTable );
+			Code.push_back( 0x01 );
+			Code.insert( Code.end(), { 0xF0, 0x83, 0x15 } );
+			this->AddAddress( OrdinalIndex * 64 + 4, this->CounterTable );
+			Code.push_back( 0x00 );
+		}
+	}
+
+	/* C symbols carry an underscore on I386 */
+	std::string GetDecoration() const
+	{
+		return this->IsAMD64() ? "" : "_";
+	}
+
+	/* The thunk ASMFileGenerator::WriteLazyResolverThunk writes, see there for what it does */
+	void AddLazyResolverThunk()
+	{
+		auto&      Code          = this->Writer.GetData( this->Text );
+		const auto ResolveExport = this->Writer.AddExternal( this->GetDecoration() + "ResolveExport", true );
+		const auto Start         = (UINT32)Code.size();
+
+		this->LazyResolverThunk = this->Writer.AddSymbol( "LazyResolverThunk", this->Text, Start, true );
+
+		if ( !this->IsAMD64() )
+		{
+			Code.insert( Code.end(), { 0x51, 0x52 } );                   // push ecx; push edx
+			Code.insert( Code.end(), { 0xFF, 0x74, 0x24, 0x08 } );       // push dword ptr [esp + 8]
+			this->AddBranch( 0xE8, ResolveExport );                      // call _ResolveExport
+			Code.insert( Code.end(), { 0x83, 0xC4, 0x04 } );             // add esp, 4
+			Code.insert( Code.end(), { 0x5A, 0x59 } );                   // pop edx; pop ecx
+			Code.insert( Code.end(), { 0x83, 0xC4, 0x04 } );             // add esp, 4
+			Code.insert( Code.end(), { 0xFF, 0xE0 } );                   // jmp eax
+			return;
+		}
+
+		Code.insert( Code.end(), { 0x51, 0x52, 0x41, 0x50, 0x41, 0x51 } ); // push rcx; push rdx; push r8; push r9
+		Code.insert( Code.end(), { 0x48, 0x83, 0xEC, 0x68 } );             // sub rsp, 68h
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x7F, 0x44, 0x24, 0x20 } ); // movdqa [rsp + 20h], xmm0
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x7F, 0x4C, 0x24, 0x30 } ); // movdqa [rsp + 30h], xmm1
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x7F, 0x54, 0x24, 0x40 } ); // movdqa [rsp + 40h], xmm2
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x7F, 0x5C, 0x24, 0x50 } ); // movdqa [rsp + 50h], xmm3
+
+		const auto PrologSize = (BYTE)( Code.size() - Start );
+
+		Code.insert( Code.end(), { 0x48, 0x89, 0xC1 } );                   // mov rcx, rax
+		this->AddBranch( 0xE8, ResolveExport );                            // call ResolveExport
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x6F, 0x44, 0x24, 0x20 } ); // movdqa xmm0, [rsp + 20h]
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x6F, 0x4C, 0x24, 0x30 } ); // movdqa xmm1, [rsp + 30h]
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x6F, 0x54, 0x24, 0x40 } ); // movdqa xmm2, [rsp + 40h]
+		Code.insert( Code.end(), { 0x66, 0x0F, 0x6F, 0x5C, 0x24, 0x50 } ); // movdqa xmm3, [rsp + 50h]
+		Code.insert( Code.end(), { 0x48, 0x83, 0xC4, 0x68 } );             // add rsp, 68h
+		Code.insert( Code.end(), { 0x41, 0x59, 0x41, 0x58, 0x5A, 0x59 } ); // pop r9; pop r8; pop rdx; pop rcx
+		Code.insert( Code.end(), { 0xFF, 0xE0 } );                         // jmp rax
+
+		const auto End = (UINT32)Code.size();
+
+		/* The PROC FRAME directives, codes are listed last instruction first */
+		const auto XData = this->Writer.AddSection( ".xdata", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_ALIGN_4BYTES );
+		const auto PData = this->Writer.AddSection( ".pdata", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_ALIGN_4BYTES );
+
+		this->Writer.GetData( XData ) = {
+			0x01, PrologSize, 13, 0x00,                  // version 1, 13 code slots, no frame register
+			PrologSize, 0x38, 0x05, 0x00,                // .savexmm128 xmm3, 50h
+			28, 0x28, 0x04, 0x00,                        // .savexmm128 xmm2, 40h
+			22, 0x18, 0x03, 0x00,                        // .savexmm128 xmm1, 30h
+			16, 0x08, 0x02, 0x00,                        // .savexmm128 xmm0, 20h
+			10, 0xC2,                                    // .allocstack 68h
+			6, 0x90, 4, 0x80, 2, 0x20, 1, 0x10,          // .pushreg r9, r8, rdx, rcx
+			0x00, 0x00,                                  // pad to an even slot count
+		};
+
+		auto& Function = this->Writer.GetData( PData );
+
+		PEWriter::AppendU32( Function, 0 );
+		PEWriter::AppendU32( Function, End - Start );
+		PEWriter::AppendU32( Function, 0 );
+
+		this->Writer.AddRelocation( PData, 0, this->LazyResolverThunk, IMAGE_REL_AMD64_ADDR32NB );
+		this->Writer.AddRelocation( PData, 4, this->LazyResolverThunk, IMAGE_REL_AMD64_ADDR32NB );
+		this->Writer.AddRelocation( PData, 8, this->Writer.GetSectionSymbol( XData ), IMAGE_REL_AMD64_ADDR32NB );
+	}
+
+	void AddLazyEntry(
+		_In_ UINT32 OrdinalIndex
+	)
+	{
+		auto& Code = this->Writer.GetData( this->Text );
+
+		this->Writer.AddSymbol( this->GetDecoration() + "LazyEntry_" + std::to_string( OrdinalIndex ), this->Text, (UINT32)Code.size(), true );
+
+		/* mov eax, Index on AMD64, push Index on I386 */
+		Code.push_back( this->IsAMD64() ? 0xB8 : 0x68 );
+		PEWriter::AppendU32( Code, OrdinalIndex );
+		this->AddBranch( 0xE9, this->LazyResolverThunk );
+	}
+
+	COFFWriter            Writer;
+	SIZE_T                Text;
+	UINT32                FunctionTable;
+	UINT32                CounterTable;
+	UINT32                LazyResolverThunk;
+	SIZE_T                MachinePointerSize;
+	bool                  LazyResolve;
+	bool                  Instrument;
+	SIZE_T                ShardIndex;
+	SIZE_T                NumberOfShards;
+	std::vector< UINT32 > LazyEntries;
+};
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "Platform.h"
+#include "RunStats.h"
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+/*
+	Append only text buffer shared by every generator. Text and numbers are
+	formatted straight into one preallocated block which is written to disk
+	with a single write when the buffer is closed, nothing is flushed per line.
+
+	A file that already holds exactly the buffered text is left alone, so
+	regenerating over an existing proxy only touches the outputs that changed
+	and MSBuild only rebuilds those. Anything else is written to a temporary
+	file next to it and renamed over it, readers and concurrent writers only
+	ever see a whole file.
+
+	Only an explicit Close commits the text, a buffer destroyed while still
+	open was abandoned by a generator that bailed out and is discarded so
+	the previous output survives.
+*/
+class OutputBuffer
+{
+public:
+	static const SIZE_T DefaultCapacity = 64 * 1024;
+
+	OutputBuffer(
+		_In_ SIZE_T Capacity = DefaultCapacity
+	) : Binary( false ), Opened( false ), Created( false )
+	{
+		this->Buffer.reserve( Capacity );
+	}
+
+	~OutputBuffer()
+	{
+		this->Discard();
+	}
+
+	OutputBuffer( const OutputBuffer& ) = delete;
+	OutputBuffer& operator=( const OutputBuffer& ) = delete;
+
+	/* Opens the destination up front so callers still find out early if it cant be created */
+	bool Open(
+		_In_ const std::filesystem::path& Path,
+		_In_ bool                         Binary = false
+	)
+	{
+		std::error_code Error;
+
+		const auto Existed = std::filesystem::exists( Path, Error );
+
+		/* Appending creates a missing file and leaves an existing one as it is, Close decides whether to replace it */
+		std::ofstream Stream( Path, std::ios::out | std::ios::app );
+
+		if ( !Stream.is_open() )
+		{
+			printf( "Failed to open file %s\n", Path.string().c_str() );
+			return false;
+		}
+
+		this->Path   = Path;
+		this->Binary = Binary;
+		this->Opened  = true;
+		this->Created = !Existed;
+
+		return true;
+	}
+
+	bool IsOpen() const
+	{
+		return this->Opened;
+	}
+
+	/* Replaces the file with everything buffered so far in one go, unless it already matches */
+	bool Close()
+	{
+		if ( !this->Opened )
+			return true;
+
+		this->Opened = false;
+
+		if ( this->IsUnchanged() )
+		{
+			RunStats::AddFileUnchanged();
+			return true;
+		}
+
+		/* Unique per process and call, another process writing the same output picks a different time */
+		static std::atomic< UINT64 > NextTemporary( 0 );
+
+		auto TemporaryPath = this->Path;
+
+		TemporaryPath += ".tmp" + std::to_string( RunStats::Now() ) + "_" + std::to_string( NextTemporary.fetch_add( 1 ) );
+
+		std::ofstream Stream( TemporaryPath, this->Binary ? std::ios::out | std::ios::trunc | std::ios::binary : std::ios::out | std::ios::trunc );
+
+		Stream.write( this->Buffer.data(), this->Buffer.size() );
+		Stream.close();
+
+		std::error_code Error;
+
+		if ( !Stream.fail() )
+			std::filesystem::rename( TemporaryPath, this->Path, Error );
+
+		if ( Stream.fail() || Error )
+		{
+			std::filesystem::remove( TemporaryPath, Error );
+			return false;
+		}
+
+		RunStats::AddFileWritten( this->Buffer.size() );
+
+		return true;
+	}
+
+	/* Drops everything buffered, a file only created by Open is removed again */
+	void Discard()
+	{
+		if ( !this->Opened )
+			return;
+
+		this->Opened = false;
+
+		std::error_code Error;
+
+		if ( this->Created )
+			std::filesystem::remove( this->Path, Error );
+	}
+
+	void Reserve(
+		_In_ SIZE_T Capacity
+	)
+	{
+		this->Buffer.reserve( Capacity );
+	}
+
+	void Clear()
+	{
+		this->Buffer.clear();
+	}
+
+	const std::string& GetText() const
+	{
+		return this->Buffer;
+	}
+
+	SIZE_T GetSize() const
+	{
+		return this->Buffer.size();
+	}
+
+	OutputBuffer& operator<<( std::string_view Text )
+	{
+		this->Buffer.append( Text.data(), Text.size() );
+		return *this;
+	}
+
+	OutputBuffer& operator<<( const char* Text )
+	{
+		return *this << std::string_view( Text );
+	}
+
+	OutputBuffer& operator<<( const std::string& Text )
+	{
+		return *this << std::string_view( Text );
+	}
+
+	OutputBuffer& operator<<( const OutputBuffer& Other )
+	{
+		return *this << std::string_view( Other.Buffer );
+	}
+
+	OutputBuffer& operator<<( char Character )
+	{
+		this->Buffer.push_back( Character );
+		return *this;
+	}
+
+	OutputBuffer& operator<<( int Value )                { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( unsigned int Value )       { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( long Value )               { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( unsigned long Value )      { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( long long Value )          { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( unsigned long long Value ) { return this->AppendNumber( Value ); }
+	OutputBuffer& operator<<( unsigned short Value )     { return this->AppendNumber( Value ); }
+
+	/* Appends Value as upper case hex padded to Digits */
+	OutputBuffer& AppendHex(
+		_In_ UINT64 Value,
+		_In_ int    Digits = 0
+	)
+	{
+		char Text[ 16 ];
+		auto Result = std::to_chars( Text, Text + sizeof( Text ), Value, 16 );
+		auto Length = (int)( Result.ptr - Text );
+
+		for ( ; Length < Digits; Digits-- )
+			this->Buffer.push_back( '0' );
+
+		for ( auto Character = Text; Character != Result.ptr; Character++ )
+			this->Buffer.push_back( ( *Character >= 'a' ) ? *Character - 'a' + 'A' : *Character );
+
+		return *this;
+	}
+
+private:
+	/* Read back in the mode it was written in, text mode on Windows turns \r\n back into \n and never reads more than Size */
+	bool IsUnchanged() const
+	{
+		std::error_code Error;
+
+		const auto Size = std::filesystem::file_size( this->Path, Error );
+
+		if ( Error || Size < this->Buffer.size() )
+			return false;
+
+		std::ifstream Existing( this->Path, this->Binary ? std::ios::in | std::ios::binary : std::ios::in );
+		std::string   Text( (SIZE_T)Size, '\0' );
+
+		Existing.read( Text.data(), (std::streamsize)Size );
+		Text.resize( (SIZE_T)Existing.gcount() );
+
+		return Text == this->Buffer;
+	}
+
+	template < typename T >
+	OutputBuffer& AppendNumber(
+		_In_ T Value
+	)
+	{
+		char Text[ 24 ];
+		auto Result = std::to_chars( Text, Text + sizeof( Text ), Value );
+
+		this->Buffer.append( Text, Result.ptr - Text );
+		return *this;
+	}
+
+	std::string           Buffer;
+	std::filesystem::path Path;
+	bool                  Binary;
+	bool                  Opened;
+	bool                  Created;
+};
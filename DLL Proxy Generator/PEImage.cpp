@@ -0,0 +1,342 @@
+#include "PEImage.h"
+#include "RunStats.h"
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+bool PEImage::Open(
+	_In_ const std::filesystem::path& Path
+)
+{
+	RunStats::Timer Timer( "map image" );
+
+	this->Close();
+
+	if ( !this->File.Open( Path ) )
+		return false;
+
+	this->Data = this->File.GetData();
+	this->Size = this->File.GetSize();
+
+	if ( !this->ParseHeaders() )
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool PEImage::Open(
+	_In_ FILE* Stream
+)
+{
+	RunStats::Timer Timer( "read image" );
+
+	this->Close();
+
+	if ( !this->File.Read( Stream ) )
+		return false;
+
+	this->Data = this->File.GetData();
+	this->Size = this->File.GetSize();
+
+	if ( !this->ParseHeaders() )
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool PEImage::Open(
+	_In_ const void* Data,
+	_In_ SIZE_T      Size
+)
+{
+	this->Close();
+
+	this->Data = (const UINT8*)Data;
+	this->Size = Size;
+
+	if ( !this->ParseHeaders() )
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+void PEImage::Close()
+{
+	this->File.Close();
+	this->Sections.clear();
+
+	this->Data                = NULL;
+	this->Size                = 0;
+	this->Machine             = 0;
+	this->Characteristics     = 0;
+	this->TimeDateStamp       = 0;
+	this->ImageBase           = 0;
+	this->SizeOfHeaders       = 0;
+	this->NumberOfDirectories = 0;
+	this->DataDirectories     = NULL;
+	this->SectionsOverlap     = false;
+}
+
+bool PEImage::ParseHeaders()
+{
+	const auto Base = this->Data;
+	const auto Size = this->Size;
+
+	if ( Size < sizeof( IMAGE_DOS_HEADER ) )
+	{
+		printf( "File too small to be a PE image\n" );
+		return false;
+	}
+
+	const auto DosHeader = (const IMAGE_DOS_HEADER*)Base;
+
+	if ( DosHeader->e_magic != IMAGE_DOS_SIGNATURE || DosHeader->e_lfanew < 0 )
+	{
+		printf( "Invalid DOS header\n" );
+		return false;
+	}
+
+	const SIZE_T NtOffset = (SIZE_T)DosHeader->e_lfanew;
+
+	if ( NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER ) + sizeof( UINT16 ) > Size )
+	{
+		printf( "Invalid NT header offset\n" );
+		return false;
+	}
+
+	if ( *(const UINT32*)( Base + NtOffset ) != IMAGE_NT_SIGNATURE )
+	{
+		printf( "Invalid NT signature\n" );
+		return false;
+	}
+
+	const auto FileHeader     = (const IMAGE_FILE_HEADER*)( Base + NtOffset + sizeof( UINT32 ) );
+	const auto OptionalOffset = NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER );
+	const auto SectionOffset  = OptionalOffset + FileHeader->SizeOfOptionalHeader;
+
+	/* Every optional header field read below is checked to sit inside SizeOfOptionalHeader, so this covers them all */
+	if ( FileHeader->SizeOfOptionalHeader < sizeof( UINT16 ) || SectionOffset > Size )
+	{
+		printf( "Optional header out of bounds\n" );
+		return false;
+	}
+
+	const auto Magic = *(const UINT16*)( Base + OptionalOffset );
+
+	this->Machine         = FileHeader->Machine;
+	this->Characteristics = FileHeader->Characteristics;
+	this->TimeDateStamp   = FileHeader->TimeDateStamp;
+
+	/* Both optional header layouts end with the same NumberOfRvaAndSizes + DataDirectory tail */
+	SIZE_T DirectoryOffset = 0;
+
+	if ( Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC )
+	{
+		if ( FileHeader->SizeOfOptionalHeader < offsetof( IMAGE_OPTIONAL_HEADER64, DataDirectory ) )
+		{
+			printf( "Optional header too small\n" );
+			return false;
+		}
+
+		const auto OptionalHeader = (const IMAGE_OPTIONAL_HEADER64*)( Base + OptionalOffset );
+
+		this->ImageBase           = OptionalHeader->ImageBase;
+		this->SizeOfHeaders       = OptionalHeader->SizeOfHeaders;
+		this->NumberOfDirectories = OptionalHeader->NumberOfRvaAndSizes;
+		DirectoryOffset           = OptionalOffset + offsetof( IMAGE_OPTIONAL_HEADER64, DataDirectory );
+	}
+	else if ( Magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC )
+	{
+		if ( FileHeader->SizeOfOptionalHeader < offsetof( IMAGE_OPTIONAL_HEADER32, DataDirectory ) )
+		{
+			printf( "Optional header too small\n" );
+			return false;
+		}
+
+		const auto OptionalHeader = (const IMAGE_OPTIONAL_HEADER32*)( Base + OptionalOffset );
+
+		this->ImageBase           = OptionalHeader->ImageBase;
+		this->SizeOfHeaders       = OptionalHeader->SizeOfHeaders;
+		this->NumberOfDirectories = OptionalHeader->NumberOfRvaAndSizes;
+		DirectoryOffset           = OptionalOffset + offsetof( IMAGE_OPTIONAL_HEADER32, DataDirectory );
+	}
+	else
+	{
+		printf( "Unknown optional header magic %04X\n", Magic );
+		return false;
+	}
+
+	if ( this->NumberOfDirectories > IMAGE_NUMBEROF_DIRECTORY_ENTRIES )
+		this->NumberOfDirectories = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+
+	/* Only directories that fit in the optional header are used, it lies within the file so they do too */
+	if ( DirectoryOffset + this->NumberOfDirectories * sizeof( IMAGE_DATA_DIRECTORY ) > SectionOffset )
+		this->NumberOfDirectories = (UINT32)( ( SectionOffset - DirectoryOffset ) / sizeof( IMAGE_DATA_DIRECTORY ) );
+
+	this->DataDirectories = (const IMAGE_DATA_DIRECTORY*)( Base + DirectoryOffset );
+
+	if ( SectionOffset + FileHeader->NumberOfSections * sizeof( IMAGE_SECTION_HEADER ) > Size )
+	{
+		printf( "Section table out of bounds\n" );
+		return false;
+	}
+
+	const auto SectionHeaders = (const IMAGE_SECTION_HEADER*)( Base + SectionOffset );
+
+	this->Sections.reserve( FileHeader->NumberOfSections );
+
+	for ( UINT32 SectionIndex = 0; SectionIndex < FileHeader->NumberOfSections; SectionIndex++ )
+	{
+		const auto& Header = SectionHeaders[ SectionIndex ];
+
+		Section Entry;
+
+		Entry.VirtualAddress   = Header.VirtualAddress;
+		Entry.VirtualSize      = Header.Misc.VirtualSize ? Header.Misc.VirtualSize : Header.SizeOfRawData;
+		Entry.PointerToRawData = Header.PointerToRawData;
+		Entry.SizeOfRawData    = Header.SizeOfRawData;
+		Entry.Characteristics  = Header.Characteristics;
+
+		this->Sections.push_back( Entry );
+	}
+
+	/*
+		Keep the table sorted by address so lookups are a binary search. Overlapping
+		sections only show up in malformed images, those fall back to the linear scan
+		so the first header in file order still wins.
+	*/
+	auto SortedSections = this->Sections;
+
+	std::stable_sort( SortedSections.begin(), SortedSections.end(), []( const Section& Left, const Section& Right )
+	{
+		return Left.VirtualAddress < Right.VirtualAddress;
+	} );
+
+	for ( SIZE_T SectionIndex = 1; SectionIndex < SortedSections.size(); SectionIndex++ )
+	{
+		const auto& Previous = SortedSections[ SectionIndex - 1 ];
+
+		if ( (UINT64)Previous.VirtualAddress + Previous.VirtualSize > SortedSections[ SectionIndex ].VirtualAddress )
+		{
+			this->SectionsOverlap = true;
+			break;
+		}
+	}
+
+	if ( !this->SectionsOverlap )
+		this->Sections.swap( SortedSections );
+
+	return true;
+}
+
+const IMAGE_DATA_DIRECTORY* PEImage::GetDataDirectory(
+	_In_ UINT32 Index
+) const
+{
+	if ( Index >= this->NumberOfDirectories )
+		return NULL;
+
+	const auto Directory = &this->DataDirectories[ Index ];
+
+	if ( Directory->VirtualAddress == 0 || Directory->Size == 0 )
+		return NULL;
+
+	return Directory;
+}
+
+const PEImage::Section* PEImage::FindSection(
+	_In_ UINT32 RVA
+) const
+{
+	if ( this->SectionsOverlap )
+	{
+		for ( const auto& Entry : this->Sections )
+		{
+			if ( RVA >= Entry.VirtualAddress &&
+				 RVA - Entry.VirtualAddress < Entry.VirtualSize )
+			{
+				return &Entry;
+			}
+		}
+
+		return NULL;
+	}
+
+	/* Last section starting at or below the RVA is the only candidate */
+	auto Next = std::upper_bound( this->Sections.begin(), this->Sections.end(), RVA, []( UINT32 Value, const Section& Entry )
+	{
+		return Value < Entry.VirtualAddress;
+	} );
+
+	if ( Next == this->Sections.begin() )
+		return NULL;
+
+	const auto& Entry = *( Next - 1 );
+
+	if ( RVA - Entry.VirtualAddress >= Entry.VirtualSize )
+		return NULL;
+
+	return &Entry;
+}
+
+const void* PEImage::RvaToPointer(
+	_In_ UINT32 RVA,
+	_In_ SIZE_T Size
+) const
+{
+	SIZE_T Offset    = 0;
+	SIZE_T Available = 0;
+
+	if ( RVA < this->SizeOfHeaders )
+	{
+		Offset    = RVA;
+		Available = this->SizeOfHeaders - RVA;
+	}
+	else
+	{
+		const auto Entry = this->FindSection( RVA );
+
+		if ( Entry == NULL )
+			return NULL;
+
+		const auto Delta = RVA - Entry->VirtualAddress;
+
+		/* Tail of the section past the raw data is zero fill, not in the file */
+		if ( Delta >= Entry->SizeOfRawData )
+			return NULL;
+
+		Offset    = (SIZE_T)Entry->PointerToRawData + Delta;
+		Available = Entry->SizeOfRawData - Delta;
+	}
+
+	if ( Size > Available || Offset > this->Size || Size > this->Size - Offset )
+		return NULL;
+
+	return this->Data + Offset;
+}
+
+const char* PEImage::RvaToString(
+	_In_ UINT32 RVA
+) const
+{
+	const auto String = (const char*)this->RvaToPointer( RVA, 1 );
+
+	if ( String == NULL )
+		return NULL;
+
+	const auto End = (const char*)( this->Data + this->Size );
+
+	if ( memchr( String, 0, End - String ) == NULL )
+		return NULL;
+
+	return String;
+}
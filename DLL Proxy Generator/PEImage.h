@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Platform.h"
+#include "MappedFile.h"
+#include <vector>
+#include <filesystem>
+
+/*
+	Minimal PE32/PE32+ reader over a read only mapping of the file.
+
+	Section headers are copied into a table sorted by address once when the
+	image is opened, translating or classifying an RVA is a binary search and
+	never goes back to the headers. Every pointer returned points straight
+	into the mapping.
+*/
+class PEImage
+{
+public:
+	struct Section
+	{
+		UINT32 VirtualAddress;
+		UINT32 VirtualSize;
+		UINT32 PointerToRawData;
+		UINT32 SizeOfRawData;
+		UINT32 Characteristics;
+	};
+
+	PEImage() : Data( NULL ), Size( 0 ), Machine( 0 ), Characteristics( 0 ), TimeDateStamp( 0 ), ImageBase( 0 ), SizeOfHeaders( 0 ), NumberOfDirectories( 0 ), DataDirectories( NULL ), SectionsOverlap( false )
+	{
+
+	}
+
+	bool Open(
+		_In_ const std::filesystem::path& Path
+	);
+
+	/* Reads the whole image from a pipe or stdin, the PEImage owns the copy */
+	bool Open(
+		_In_ FILE* Stream
+	);
+
+	/* Parses an image that is already in memory, Data must outlive the PEImage */
+	bool Open(
+		_In_ const void* Data,
+		_In_ SIZE_T      Size
+	);
+
+	void Close();
+
+	UINT16 GetMachine() const
+	{
+		return this->Machine;
+	}
+
+	UINT32 GetTimeDateStamp() const
+	{
+		return this->TimeDateStamp;
+	}
+
+	UINT64 GetImageBase() const
+	{
+		return this->ImageBase;
+	}
+
+	bool IsDLL() const
+	{
+		return ( this->Characteristics & IMAGE_FILE_DLL ) != 0;
+	}
+
+	/* Bytes of the file or buffer the image was parsed from */
+	SIZE_T GetSize() const
+	{
+		return this->Size;
+	}
+
+	/* Sorted by VirtualAddress unless the sections overlap, then in header order */
+	const std::vector< Section >& GetSections() const
+	{
+		return this->Sections;
+	}
+
+	/* Returns NULL if the directory is absent or empty */
+	const IMAGE_DATA_DIRECTORY* GetDataDirectory(
+		_In_ UINT32 Index
+	) const;
+
+	const Section* FindSection(
+		_In_ UINT32 RVA
+	) const;
+
+	/* Returns NULL unless the full Size bytes starting at RVA are backed by the file */
+	const void* RvaToPointer(
+		_In_ UINT32 RVA,
+		_In_ SIZE_T Size
+	) const;
+
+	template < typename T >
+	const T* RvaToPointer(
+		_In_ UINT32 RVA,
+		_In_ SIZE_T Count = 1
+	) const
+	{
+		/* A count read from the image can overflow the byte size on 32 bit builds */
+		if ( Count > SIZE_MAX / sizeof( T ) )
+			return NULL;
+
+		return (const T*)this->RvaToPointer( RVA, Count * sizeof( T ) );
+	}
+
+	/* Returns NULL unless the string is null terminated inside the file */
+	const char* RvaToString(
+		_In_ UINT32 RVA
+	) const;
+
+private:
+	bool ParseHeaders();
+
+	MappedFile                  File;
+	const UINT8*                Data;
+	SIZE_T                      Size;
+	UINT16                      Machine;
+	UINT16                      Characteristics;
+	UINT32                      TimeDateStamp;
+	UINT64                      ImageBase;
+	UINT32                      SizeOfHeaders;
+	UINT32                      NumberOfDirectories;
+	const IMAGE_DATA_DIRECTORY* DataDirectories;
+	std::vector< Section >      Sections;
+	bool                        SectionsOverlap;
+};
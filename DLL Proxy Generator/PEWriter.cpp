@@ -0,0 +1,270 @@
+#include "PEWriter.h"
+#include <algorithm>
+#include <cstring>
+
+static UINT32 AlignUp(
+	_In_ UINT32 Value,
+	_In_ UINT32 Alignment
+)
+{
+	return ( Value + Alignment - 1 ) & ~( Alignment - 1 );
+}
+
+PEWriter::PEWriter(
+	_In_ UINT16 Machine
+) : Machine( Machine ), TimeDateStamp( 0 ), EntryPoint( { 0, 0 } ), HasEntryPoint( false )
+{
+	/* Same defaults MSVC picks for DLLs, the loader rebases us anyway */
+	this->ImageBase = this->IsPE32Plus() ? 0x180000000ULL : 0x10000000ULL;
+}
+
+SIZE_T PEWriter::AddSection(
+	_In_ const char* Name,
+	_In_ UINT32      Characteristics
+)
+{
+	Section NewSection = {};
+
+	/* Short names are padded with zeros and not terminated when they fill all eight bytes */
+	memcpy( NewSection.Name, Name, std::min< SIZE_T >( strlen( Name ), IMAGE_SIZEOF_SHORT_NAME ) );
+	NewSection.Characteristics = Characteristics;
+
+	this->Sections.push_back( std::move( NewSection ) );
+
+	return this->Sections.size() - 1;
+}
+
+void PEWriter::AddBaseRelocations()
+{
+	std::vector< std::pair< UINT32, UINT16 > > Targets;
+
+	for ( const auto& Entry : this->Fixups )
+	{
+		if ( Entry.Type == FixupVA32 )
+			Targets.emplace_back( this->GetRVA( Entry.At ), (UINT16)IMAGE_REL_BASED_HIGHLOW );
+		else if ( Entry.Type == FixupVA64 )
+			Targets.emplace_back( this->GetRVA( Entry.At ), (UINT16)IMAGE_REL_BASED_DIR64 );
+	}
+
+	std::sort( Targets.begin(), Targets.end() );
+
+	const auto RelocSection = this->AddSection( ".reloc", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_DISCARDABLE | IMAGE_SCN_MEM_READ );
+	auto&      Data         = this->GetData( RelocSection );
+
+	/* One block per 4K page, each entry is the type in the top 4 bits and the page offset below */
+	for ( SIZE_T First = 0; First < Targets.size(); )
+	{
+		const auto Page  = Targets[ First ].first & ~0xFFFu;
+		const auto Start = Data.size();
+
+		AppendU32( Data, Page );
+		AppendU32( Data, 0 );
+
+		for ( ; First < Targets.size() && ( Targets[ First ].first & ~0xFFFu ) == Page; First++ )
+			AppendU16( Data, (UINT16)( ( Targets[ First ].second << 12 ) | ( Targets[ First ].first & 0xFFF ) ) );
+
+		if ( ( Data.size() - Start ) % 4 )
+			AppendU16( Data, IMAGE_REL_BASED_ABSOLUTE );
+
+		const UINT32 BlockSize = (UINT32)( Data.size() - Start );
+
+		memcpy( Data.data() + Start + sizeof( UINT32 ), &BlockSize, sizeof( BlockSize ) );
+	}
+
+	/* Keep a directory even with nothing to fix so the image stays relocatable */
+	if ( Data.empty() )
+	{
+		AppendU32( Data, this->Sections[ 0 ].VirtualAddress );
+		AppendU32( Data, 12 );
+		AppendU16( Data, IMAGE_REL_BASED_ABSOLUTE );
+		AppendU16( Data, IMAGE_REL_BASED_ABSOLUTE );
+	}
+
+	this->SetDataDirectory( IMAGE_DIRECTORY_ENTRY_BASERELOC, { RelocSection, 0 }, (UINT32)Data.size() );
+}
+
+bool PEWriter::Build(
+	_Inout_ std::string& Image
+)
+{
+	if ( this->Sections.empty() )
+		return false;
+
+	const SIZE_T OptionalSize = this->IsPE32Plus() ? sizeof( IMAGE_OPTIONAL_HEADER64 ) : sizeof( IMAGE_OPTIONAL_HEADER32 );
+	const SIZE_T NtOffset     = sizeof( IMAGE_DOS_HEADER );
+
+	/* Room for the .reloc section added below */
+	const auto NumberOfSections = this->Sections.size() + 1;
+	const auto SizeOfHeaders    = AlignUp( (UINT32)( NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER ) + OptionalSize + NumberOfSections * sizeof( IMAGE_SECTION_HEADER ) ), FileAlignment );
+
+	UINT32 VirtualAddress = AlignUp( SizeOfHeaders, SectionAlignment );
+
+	for ( auto& Entry : this->Sections )
+	{
+		Entry.VirtualAddress = VirtualAddress;
+		VirtualAddress      += AlignUp( std::max< UINT32 >( (UINT32)Entry.Data.size() + Entry.UninitializedSize, 1 ), SectionAlignment );
+	}
+
+	this->AddBaseRelocations();
+
+	this->Sections.back().VirtualAddress = VirtualAddress;
+
+	const auto SizeOfImage = VirtualAddress + AlignUp( (UINT32)this->Sections.back().Data.size(), SectionAlignment );
+
+	UINT32 PointerToRawData = SizeOfHeaders;
+
+	for ( auto& Entry : this->Sections )
+	{
+		Entry.PointerToRawData = Entry.Data.empty() ? 0 : PointerToRawData;
+		PointerToRawData      += AlignUp( (UINT32)Entry.Data.size(), FileAlignment );
+	}
+
+	for ( const auto& Entry : this->Fixups )
+	{
+		auto&      Data   = this->Sections[ Entry.At.Section ].Data;
+		const auto Target = this->GetRVA( Entry.Target );
+		const auto Width  = ( Entry.Type == FixupVA64 ) ? sizeof( UINT64 ) : sizeof( UINT32 );
+
+		if ( Entry.At.Offset + Width > Data.size() )
+		{
+			printf( "Fixup outside of section data\n" );
+			return false;
+		}
+
+		UINT64 Value = 0;
+
+		switch ( Entry.Type )
+		{
+			case FixupRVA32: Value = Target;                                              break;
+			case FixupRel32: Value = (UINT32)( Target - ( this->GetRVA( Entry.At ) + 4 ) ); break;
+			case FixupVA32:  Value = (UINT32)( this->ImageBase + Target );                break;
+			case FixupVA64:  Value = this->ImageBase + Target;                            break;
+		}
+
+		memcpy( Data.data() + Entry.At.Offset, &Value, Width );
+	}
+
+	UINT32 SizeOfCode            = 0;
+	UINT32 SizeOfInitializedData = 0;
+	UINT32 BaseOfCode            = 0;
+	UINT32 BaseOfData            = 0;
+
+	for ( const auto& Entry : this->Sections )
+	{
+		const auto RawSize = AlignUp( (UINT32)Entry.Data.size(), FileAlignment );
+
+		if ( Entry.Characteristics & IMAGE_SCN_CNT_CODE )
+		{
+			SizeOfCode += RawSize;
+			BaseOfCode  = BaseOfCode ? BaseOfCode : Entry.VirtualAddress;
+		}
+		else
+		{
+			SizeOfInitializedData += RawSize;
+			BaseOfData             = BaseOfData ? BaseOfData : Entry.VirtualAddress;
+		}
+	}
+
+	const auto Start = Image.size();
+
+	Image.resize( Start + SizeOfHeaders, '\0' );
+
+	auto Headers = (BYTE*)&Image[ Start ];
+
+	IMAGE_DOS_HEADER DosHeader = {};
+
+	DosHeader.e_magic  = IMAGE_DOS_SIGNATURE;
+	DosHeader.e_lfanew = (LONG)NtOffset;
+
+	memcpy( Headers, &DosHeader, sizeof( DosHeader ) );
+
+	const UINT32 Signature = IMAGE_NT_SIGNATURE;
+
+	memcpy( Headers + NtOffset, &Signature, sizeof( Signature ) );
+
+	IMAGE_FILE_HEADER FileHeader = {};
+
+	FileHeader.Machine              = this->Machine;
+	FileHeader.NumberOfSections     = (WORD)NumberOfSections;
+	FileHeader.TimeDateStamp        = this->TimeDateStamp;
+	FileHeader.SizeOfOptionalHeader = (WORD)OptionalSize;
+	FileHeader.Characteristics      = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL | ( this->IsPE32Plus() ? IMAGE_FILE_LARGE_ADDRESS_AWARE : IMAGE_FILE_32BIT_MACHINE );
+
+	memcpy( Headers + NtOffset + sizeof( UINT32 ), &FileHeader, sizeof( FileHeader ) );
+
+	/* Both optional header layouts share every field we set apart from the magic and BaseOfData */
+	auto FillOptionalHeader = [ & ]( auto& Optional )
+	{
+		Optional.MajorLinkerVersion          = 14;
+		Optional.SizeOfCode                  = SizeOfCode;
+		Optional.SizeOfInitializedData       = SizeOfInitializedData;
+		Optional.AddressOfEntryPoint         = this->HasEntryPoint ? this->GetRVA( this->EntryPoint ) : 0;
+		Optional.BaseOfCode                  = BaseOfCode;
+		Optional.ImageBase                   = ( decltype( Optional.ImageBase ) )this->ImageBase;
+		Optional.SectionAlignment            = SectionAlignment;
+		Optional.FileAlignment               = FileAlignment;
+		Optional.MajorOperatingSystemVersion = 6;
+		Optional.MajorSubsystemVersion       = 6;
+		Optional.SizeOfImage                 = SizeOfImage;
+		Optional.SizeOfHeaders               = SizeOfHeaders;
+		Optional.Subsystem                   = IMAGE_SUBSYSTEM_WINDOWS_GUI;
+		Optional.DllCharacteristics          = IMAGE_DLLCHARACTERISTICS_DYNAMIC_BASE | IMAGE_DLLCHARACTERISTICS_NX_COMPAT;
+		Optional.SizeOfStackReserve          = 0x100000;
+		Optional.SizeOfStackCommit           = 0x1000;
+		Optional.SizeOfHeapReserve           = 0x100000;
+		Optional.SizeOfHeapCommit            = 0x1000;
+		Optional.NumberOfRvaAndSizes         = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+
+		for ( const auto& Entry : this->Directories )
+		{
+			Optional.DataDirectory[ Entry.Index ].VirtualAddress = this->GetRVA( Entry.At );
+			Optional.DataDirectory[ Entry.Index ].Size           = Entry.Size;
+		}
+	};
+
+	if ( this->IsPE32Plus() )
+	{
+		IMAGE_OPTIONAL_HEADER64 Optional = {};
+
+		Optional.Magic = IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+		FillOptionalHeader( Optional );
+		Optional.DllCharacteristics |= IMAGE_DLLCHARACTERISTICS_HIGH_ENTROPY_VA;
+
+		memcpy( Headers + NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER ), &Optional, sizeof( Optional ) );
+	}
+	else
+	{
+		IMAGE_OPTIONAL_HEADER32 Optional = {};
+
+		Optional.Magic = IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+		FillOptionalHeader( Optional );
+		Optional.BaseOfData = BaseOfData;
+
+		memcpy( Headers + NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER ), &Optional, sizeof( Optional ) );
+	}
+
+	auto SectionHeaders = Headers + NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER ) + OptionalSize;
+
+	for ( SIZE_T Index = 0; Index < this->Sections.size(); Index++ )
+	{
+		const auto&          Entry  = this->Sections[ Index ];
+		IMAGE_SECTION_HEADER Header = {};
+
+		memcpy( Header.Name, Entry.Name, sizeof( Header.Name ) );
+		Header.Misc.VirtualSize = (DWORD)Entry.Data.size() + Entry.UninitializedSize;
+		Header.VirtualAddress   = Entry.VirtualAddress;
+		Header.SizeOfRawData    = AlignUp( (UINT32)Entry.Data.size(), FileAlignment );
+		Header.PointerToRawData = Entry.PointerToRawData;
+		Header.Characteristics  = Entry.Characteristics;
+
+		memcpy( SectionHeaders + Index * sizeof( Header ), &Header, sizeof( Header ) );
+	}
+
+	for ( const auto& Entry : this->Sections )
+	{
+		Image.append( (const char*)Entry.Data.data(), Entry.Data.size() );
+		Image.resize( Image.size() + AlignUp( (UINT32)Entry.Data.size(), FileAlignment ) - Entry.Data.size(), '\0' );
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	Builds a PE32/PE32+ DLL image in memory.
+
+	Callers fill sections with bytes and record every reference between them
+	as a fixup against a section and offset. Nothing has an address until
+	Build lays the sections out, then fixups are patched in place and the
+	absolute ones get base relocations in a generated .reloc section.
+*/
+class PEWriter
+{
+public:
+	static const UINT32 FileAlignment    = 0x200;
+	static const UINT32 SectionAlignment = 0x1000;
+
+	enum FixupType
+	{
+		FixupRVA32, // Target RVA
+		FixupRel32, // Target RVA minus the RVA just past the 4 byte field, for rip relative and call/jmp rel32
+		FixupVA32,  // Target address at the preferred base, relocated
+		FixupVA64,
+	};
+
+	struct Location
+	{
+		SIZE_T Section;
+		UINT32 Offset;
+	};
+
+	PEWriter(
+		_In_ UINT16 Machine
+	);
+
+	bool IsPE32Plus() const
+	{
+		return this->Machine == IMAGE_FILE_MACHINE_AMD64;
+	}
+
+	SIZE_T AddSection(
+		_In_ const char* Name,
+		_In_ UINT32      Characteristics
+	);
+
+	std::vector< BYTE >& GetData(
+		_In_ SIZE_T Section
+	)
+	{
+		return this->Sections[ Section ].Data;
+	}
+
+	Location GetEnd(
+		_In_ SIZE_T Section
+	) const
+	{
+		return { Section, (UINT32)this->Sections[ Section ].Data.size() };
+	}
+
+	/* Zero filled space after the section's data that takes no room in the file */
+	void SetUninitializedSize(
+		_In_ SIZE_T Section,
+		_In_ UINT32 Size
+	)
+	{
+		this->Sections[ Section ].UninitializedSize = Size;
+	}
+
+	void AddFixup(
+		_In_ Location  At,
+		_In_ FixupType Type,
+		_In_ Location  Target
+	)
+	{
+		this->Fixups.push_back( { At, Type, Target } );
+	}
+
+	void SetEntryPoint(
+		_In_ Location At
+	)
+	{
+		this->EntryPoint    = At;
+		this->HasEntryPoint = true;
+	}
+
+	void SetDataDirectory(
+		_In_ UINT32   Index,
+		_In_ Location At,
+		_In_ UINT32   Size
+	)
+	{
+		this->Directories.push_back( { Index, At, Size } );
+	}
+
+	void SetTimeDateStamp(
+		_In_ UINT32 TimeDateStamp
+	)
+	{
+		this->TimeDateStamp = TimeDateStamp;
+	}
+
+	/* Appends the finished image to Image, false if the layout does not fit a PE */
+	bool Build(
+		_Inout_ std::string& Image
+	);
+
+	static void Align(
+		_Inout_ std::vector< BYTE >& Data,
+		_In_    SIZE_T               Alignment,
+		_In_    BYTE                 Fill = 0
+	)
+	{
+		while ( Data.size() % Alignment )
+			Data.push_back( Fill );
+	}
+
+	static void Append(
+		_Inout_ std::vector< BYTE >& Data,
+		_In_    const void*          Bytes,
+		_In_    SIZE_T               Size
+	)
+	{
+		Data.insert( Data.end(), (const BYTE*)Bytes, (const BYTE*)Bytes + Size );
+	}
+
+	/* Little endian integers and null terminated strings */
+	static void AppendU16( _Inout_ std::vector< BYTE >& Data, _In_ UINT16 Value ) { Append( Data, &Value, sizeof( Value ) ); }
+	static void AppendU32( _Inout_ std::vector< BYTE >& Data, _In_ UINT32 Value ) { Append( Data, &Value, sizeof( Value ) ); }
+	static void AppendU64( _Inout_ std::vector< BYTE >& Data, _In_ UINT64 Value ) { Append( Data, &Value, sizeof( Value ) ); }
+
+	static void AppendString(
+		_Inout_ std::vector< BYTE >& Data,
+		_In_    std::string_view     Text
+	)
+	{
+		Append( Data, Text.data(), Text.size() );
+		Data.push_back( 0 );
+	}
+
+private:
+	struct Section
+	{
+		char                Name[ IMAGE_SIZEOF_SHORT_NAME ];
+		UINT32              Characteristics;
+		std::vector< BYTE > Data;
+		UINT32              UninitializedSize;
+		UINT32              VirtualAddress;
+		UINT32              PointerToRawData;
+	};
+
+	struct Fixup
+	{
+		Location  At;
+		FixupType Type;
+		Location  Target;
+	};
+
+	struct Directory
+	{
+		UINT32   Index;
+		Location At;
+		UINT32   Size;
+	};
+
+	UINT32 GetRVA(
+		_In_ Location At
+	) const
+	{
+		return this->Sections[ At.Section ].VirtualAddress + At.Offset;
+	}
+
+	void AddBaseRelocations();
+
+	UINT16                   Machine;
+	UINT32                   TimeDateStamp;
+	UINT64                   ImageBase;
+	Location                 EntryPoint;
+	bool                     HasEntryPoint;
+	std::vector< Section >   Sections;
+	std::vector< Fixup >     Fixups;
+	std::vector< Directory > Directories;
+};
\ No newline at end of file
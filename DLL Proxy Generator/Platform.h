@@ -0,0 +1,310 @@
+#pragma once
+
+/*
+	Windows builds take everything from the SDK headers. Everywhere else we
+	declare the handful of Win32 types, SAL annotations and PE structures the
+	generator uses so the parser and emitters build unchanged.
+*/
+
+#include <cstdio>
+#include <cstdint>
+
+#if defined( _WIN32 )
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+
+#else
+
+typedef uint8_t   UINT8;
+typedef uint16_t  UINT16;
+typedef uint32_t  UINT32;
+typedef uint64_t  UINT64;
+typedef int32_t   INT32;
+typedef int64_t   INT64;
+typedef uint8_t   BYTE;
+typedef uint16_t  WORD;
+typedef uint32_t  DWORD;
+typedef int32_t   LONG;
+typedef uint32_t  ULONG;
+typedef uint64_t  ULONGLONG;
+typedef size_t    SIZE_T;
+typedef uintptr_t UINT_PTR;
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+
+#define IMAGE_DOS_SIGNATURE                 0x5A4D     // MZ
+#define IMAGE_NT_SIGNATURE                  0x00004550 // PE00
+
+#define IMAGE_NT_OPTIONAL_HDR32_MAGIC       0x10B
+#define IMAGE_NT_OPTIONAL_HDR64_MAGIC       0x20B
+
+#define IMAGE_FILE_MACHINE_UNKNOWN          0x0000
+#define IMAGE_FILE_MACHINE_I386             0x014C
+#define IMAGE_FILE_MACHINE_AMD64            0x8664
+#define IMAGE_FILE_MACHINE_ARM64            0xAA64
+
+#define IMAGE_FILE_EXECUTABLE_IMAGE         0x0002
+#define IMAGE_FILE_LARGE_ADDRESS_AWARE      0x0020
+#define IMAGE_FILE_32BIT_MACHINE            0x0100
+#define IMAGE_FILE_DLL                      0x2000
+
+#define IMAGE_NUMBEROF_DIRECTORY_ENTRIES    16
+#define IMAGE_SIZEOF_SHORT_NAME             8
+
+#define IMAGE_DIRECTORY_ENTRY_EXPORT        0
+#define IMAGE_DIRECTORY_ENTRY_IMPORT        1
+#define IMAGE_DIRECTORY_ENTRY_EXCEPTION     3
+#define IMAGE_DIRECTORY_ENTRY_BASERELOC     5
+#define IMAGE_DIRECTORY_ENTRY_IAT           12
+
+#define IMAGE_SUBSYSTEM_WINDOWS_GUI         2
+
+#define IMAGE_DLLCHARACTERISTICS_HIGH_ENTROPY_VA 0x0020
+#define IMAGE_DLLCHARACTERISTICS_DYNAMIC_BASE    0x0040
+#define IMAGE_DLLCHARACTERISTICS_NX_COMPAT       0x0100
+
+#define IMAGE_REL_BASED_ABSOLUTE            0
+#define IMAGE_REL_BASED_HIGHLOW             3
+#define IMAGE_REL_BASED_DIR64               10
+
+#define IMAGE_SCN_CNT_CODE                  0x00000020
+#define IMAGE_SCN_CNT_INITIALIZED_DATA      0x00000040
+#define IMAGE_SCN_CNT_UNINITIALIZED_DATA    0x00000080
+#define IMAGE_SCN_LNK_INFO                  0x00000200
+#define IMAGE_SCN_LNK_REMOVE                0x00000800
+#define IMAGE_SCN_ALIGN_1BYTES              0x00100000
+#define IMAGE_SCN_ALIGN_2BYTES              0x00200000
+#define IMAGE_SCN_ALIGN_4BYTES              0x00300000
+#define IMAGE_SCN_ALIGN_8BYTES              0x00400000
+#define IMAGE_SCN_ALIGN_16BYTES             0x00500000
+#define IMAGE_SCN_ALIGN_32BYTES             0x00600000
+#define IMAGE_SCN_ALIGN_64BYTES             0x00700000
+#define IMAGE_SCN_LNK_NRELOC_OVFL           0x01000000
+#define IMAGE_SCN_MEM_DISCARDABLE           0x02000000
+#define IMAGE_SCN_MEM_EXECUTE               0x20000000
+#define IMAGE_SCN_MEM_READ                  0x40000000
+#define IMAGE_SCN_MEM_WRITE                 0x80000000
+
+#define IMAGE_SIZEOF_SYMBOL                 18
+#define IMAGE_SIZEOF_RELOCATION             10
+
+#define IMAGE_SYM_UNDEFINED                 0
+#define IMAGE_SYM_ABSOLUTE                  -1
+#define IMAGE_SYM_DTYPE_FUNCTION            2
+#define IMAGE_SYM_CLASS_EXTERNAL            2
+#define IMAGE_SYM_CLASS_STATIC              3
+#define IMAGE_SYM_CLASS_SECTION             104
+
+#define IMAGE_REL_AMD64_ADDR64              0x0001
+#define IMAGE_REL_AMD64_ADDR32NB            0x0003
+#define IMAGE_REL_AMD64_REL32               0x0004
+#define IMAGE_REL_I386_DIR32                0x0006
+#define IMAGE_REL_I386_DIR32NB              0x0007
+#define IMAGE_REL_I386_REL32                0x0014
+#define IMAGE_REL_ARM64_ADDR32NB            0x0002
+
+#pragma pack( push, 4 )
+
+typedef struct _IMAGE_DATA_DIRECTORY
+{
+	DWORD VirtualAddress;
+	DWORD Size;
+} IMAGE_DATA_DIRECTORY, *PIMAGE_DATA_DIRECTORY;
+
+typedef struct _IMAGE_OPTIONAL_HEADER
+{
+	WORD                 Magic;
+	BYTE                 MajorLinkerVersion;
+	BYTE                 MinorLinkerVersion;
+	DWORD                SizeOfCode;
+	DWORD                SizeOfInitializedData;
+	DWORD                SizeOfUninitializedData;
+	DWORD                AddressOfEntryPoint;
+	DWORD                BaseOfCode;
+	DWORD                BaseOfData;
+	DWORD                ImageBase;
+	DWORD                SectionAlignment;
+	DWORD                FileAlignment;
+	WORD                 MajorOperatingSystemVersion;
+	WORD                 MinorOperatingSystemVersion;
+	WORD                 MajorImageVersion;
+	WORD                 MinorImageVersion;
+	WORD                 MajorSubsystemVersion;
+	WORD                 MinorSubsystemVersion;
+	DWORD                Win32VersionValue;
+	DWORD                SizeOfImage;
+	DWORD                SizeOfHeaders;
+	DWORD                CheckSum;
+	WORD                 Subsystem;
+	WORD                 DllCharacteristics;
+	DWORD                SizeOfStackReserve;
+	DWORD                SizeOfStackCommit;
+	DWORD                SizeOfHeapReserve;
+	DWORD                SizeOfHeapCommit;
+	DWORD                LoaderFlags;
+	DWORD                NumberOfRvaAndSizes;
+	IMAGE_DATA_DIRECTORY DataDirectory[ IMAGE_NUMBEROF_DIRECTORY_ENTRIES ];
+} IMAGE_OPTIONAL_HEADER32, *PIMAGE_OPTIONAL_HEADER32;
+
+#pragma pack( pop )
+
+#pragma pack( push, 8 )
+
+typedef struct _IMAGE_OPTIONAL_HEADER64
+{
+	WORD                 Magic;
+	BYTE                 MajorLinkerVersion;
+	BYTE                 MinorLinkerVersion;
+	DWORD                SizeOfCode;
+	DWORD                SizeOfInitializedData;
+	DWORD                SizeOfUninitializedData;
+	DWORD                AddressOfEntryPoint;
+	DWORD                BaseOfCode;
+	ULONGLONG            ImageBase;
+	DWORD                SectionAlignment;
+	DWORD                FileAlignment;
+	WORD                 MajorOperatingSystemVersion;
+	WORD                 MinorOperatingSystemVersion;
+	WORD                 MajorImageVersion;
+	WORD                 MinorImageVersion;
+	WORD                 MajorSubsystemVersion;
+	WORD                 MinorSubsystemVersion;
+	DWORD                Win32VersionValue;
+	DWORD                SizeOfImage;
+	DWORD                SizeOfHeaders;
+	DWORD                CheckSum;
+	WORD                 Subsystem;
+	WORD                 DllCharacteristics;
+	ULONGLONG            SizeOfStackReserve;
+	ULONGLONG            SizeOfStackCommit;
+	ULONGLONG            SizeOfHeapReserve;
+	ULONGLONG            SizeOfHeapCommit;
+	DWORD                LoaderFlags;
+	DWORD                NumberOfRvaAndSizes;
+	IMAGE_DATA_DIRECTORY DataDirectory[ IMAGE_NUMBEROF_DIRECTORY_ENTRIES ];
+} IMAGE_OPTIONAL_HEADER64, *PIMAGE_OPTIONAL_HEADER64;
+
+#pragma pack( pop )
+
+#pragma pack( push, 2 )
+
+typedef struct _IMAGE_DOS_HEADER
+{
+	WORD e_magic;
+	WORD e_cblp;
+	WORD e_cp;
+	WORD e_crlc;
+	WORD e_cparhdr;
+	WORD e_minalloc;
+	WORD e_maxalloc;
+	WORD e_ss;
+	WORD e_sp;
+	WORD e_csum;
+	WORD e_ip;
+	WORD e_cs;
+	WORD e_lfarlc;
+	WORD e_ovno;
+	WORD e_res[ 4 ];
+	WORD e_oemid;
+	WORD e_oeminfo;
+	WORD e_res2[ 10 ];
+	LONG e_lfanew;
+} IMAGE_DOS_HEADER, *PIMAGE_DOS_HEADER;
+
+#pragma pack( pop )
+
+#pragma pack( push, 4 )
+
+typedef struct _IMAGE_FILE_HEADER
+{
+	WORD  Machine;
+	WORD  NumberOfSections;
+	DWORD TimeDateStamp;
+	DWORD PointerToSymbolTable;
+	DWORD NumberOfSymbols;
+	WORD  SizeOfOptionalHeader;
+	WORD  Characteristics;
+} IMAGE_FILE_HEADER, *PIMAGE_FILE_HEADER;
+
+typedef struct _IMAGE_NT_HEADERS
+{
+	DWORD                   Signature;
+	IMAGE_FILE_HEADER       FileHeader;
+	IMAGE_OPTIONAL_HEADER32 OptionalHeader;
+} IMAGE_NT_HEADERS32, *PIMAGE_NT_HEADERS32;
+
+typedef struct _IMAGE_SECTION_HEADER
+{
+	BYTE  Name[ IMAGE_SIZEOF_SHORT_NAME ];
+	union
+	{
+		DWORD PhysicalAddress;
+		DWORD VirtualSize;
+	} Misc;
+	DWORD VirtualAddress;
+	DWORD SizeOfRawData;
+	DWORD PointerToRawData;
+	DWORD PointerToRelocations;
+	DWORD PointerToLinenumbers;
+	WORD  NumberOfRelocations;
+	WORD  NumberOfLinenumbers;
+	DWORD Characteristics;
+} IMAGE_SECTION_HEADER, *PIMAGE_SECTION_HEADER;
+
+typedef struct _IMAGE_EXPORT_DIRECTORY
+{
+	DWORD Characteristics;
+	DWORD TimeDateStamp;
+	WORD  MajorVersion;
+	WORD  MinorVersion;
+	DWORD Name;
+	DWORD Base;
+	DWORD NumberOfFunctions;
+	DWORD NumberOfNames;
+	DWORD AddressOfFunctions;
+	DWORD AddressOfNames;
+	DWORD AddressOfNameOrdinals;
+} IMAGE_EXPORT_DIRECTORY, *PIMAGE_EXPORT_DIRECTORY;
+
+typedef struct _IMAGE_IMPORT_DESCRIPTOR
+{
+	union
+	{
+		DWORD Characteristics;
+		DWORD OriginalFirstThunk;
+	};
+	DWORD TimeDateStamp;
+	DWORD ForwarderChain;
+	DWORD Name;
+	DWORD FirstThunk;
+} IMAGE_IMPORT_DESCRIPTOR, *PIMAGE_IMPORT_DESCRIPTOR;
+
+typedef struct _IMAGE_BASE_RELOCATION
+{
+	DWORD VirtualAddress;
+	DWORD SizeOfBlock;
+} IMAGE_BASE_RELOCATION, *PIMAGE_BASE_RELOCATION;
+
+#pragma pack( pop )
+
+#pragma pack( push, 8 )
+
+typedef struct _IMAGE_NT_HEADERS64
+{
+	DWORD                   Signature;
+	IMAGE_FILE_HEADER       FileHeader;
+	IMAGE_OPTIONAL_HEADER64 OptionalHeader;
+} IMAGE_NT_HEADERS64, *PIMAGE_NT_HEADERS64;
+
+#pragma pack( pop )
+
+#endif
@@ -32,11 +32,11 @@ public:
 	{
 		if ( Export.HasName() )
 		{
-			File << "#pragma comment(linker,\"/export:" << Export.GetName() << "\")" << std::endl;
+			File << "#pragma comment(linker,\"/export:" << Export.GetName() << "\")\n";
 		}
 		else
 		{
-			File << "#pragma comment(linker,\"/export:" << SymbolName << ",@" << Export.GetOrdinal() << ",NONAME" << "\")" << std::endl;
+			File << "#pragma comment(linker,\"/export:" << SymbolName << ",@" << Export.GetOrdinal() << ",NONAME" << "\")\n";
 		}
 
 		return true;
@@ -84,7 +84,7 @@ public:
 			File << ",DATA";
 		}
 
-		File << "\")" << std::endl;
+		File << "\")\n";
 
 		return true;
 	}
@@ -0,0 +1,213 @@
+#include "ProxyCache.h"
+#include "MappedFile.h"
+#include "OutputBuffer.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static UINT64 MixBits(
+	_In_ UINT64 Value
+)
+{
+	Value ^= Value >> 33;
+	Value *= 0xFF51AFD7ED558CCDULL;
+	Value ^= Value >> 33;
+	Value *= 0xC4CEB9FE1A85EC53ULL;
+	Value ^= Value >> 33;
+
+	return Value;
+}
+
+UINT64 ProxyCache::HashBytes(
+	_In_ const void* Data,
+	_In_ SIZE_T      Size,
+	_In_ UINT64      Seed
+)
+{
+	/* Eight bytes per step, not cryptographic but plenty to spot a changed export table */
+	const UINT64 Prime = 0x9E3779B97F4A7C15ULL;
+
+	auto Bytes = (const UINT8*)Data;
+	auto Hash  = Seed ^ ( Size * Prime );
+
+	for ( ; Size >= sizeof( UINT64 ); Size -= sizeof( UINT64 ), Bytes += sizeof( UINT64 ) )
+	{
+		UINT64 Word;
+		memcpy( &Word, Bytes, sizeof( Word ) );
+
+		Hash = ( Hash ^ MixBits( Word ) ) * Prime;
+		Hash = ( Hash << 31 ) | ( Hash >> 33 );
+	}
+
+	UINT64 Tail = 0;
+	memcpy( &Tail, Bytes, Size );
+
+	return MixBits( Hash ^ MixBits( Tail ^ Prime ) );
+}
+
+/* Size and content hash of a generated output, an edit that keeps the size still shows up */
+static bool HashOutput(
+	_In_  const std::filesystem::path& Path,
+	_Out_ UINT64*                      Size,
+	_Out_ UINT64*                      Hash
+)
+{
+	std::error_code Error;
+
+	*Size = std::filesystem::file_size( Path, Error );
+
+	if ( Error )
+		return false;
+
+	/* Empty files cant be mapped */
+	if ( *Size == 0 )
+	{
+		*Hash = ProxyCache::HashBytes( "", 0, 0 );
+		return true;
+	}
+
+	MappedFile File;
+
+	if ( !File.Open( Path ) || File.GetSize() != *Size )
+		return false;
+
+	*Hash = ProxyCache::HashBytes( File.GetData(), File.GetSize(), 0 );
+
+	return true;
+}
+
+bool ProxyCache::ComputeKey(
+	_In_  const PEImage&   Image,
+	_In_  std::string_view Options,
+	_Out_ UINT64*          Key
+)
+{
+	const auto ExportDirectoryEntry = Image.GetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXPORT );
+
+	if ( ExportDirectoryEntry == NULL )
+		return false;
+
+	const auto ExportDirectoryData  = Image.RvaToPointer( ExportDirectoryEntry->VirtualAddress, ExportDirectoryEntry->Size );
+	const auto ImageExportDirectory = Image.RvaToPointer<IMAGE_EXPORT_DIRECTORY>( ExportDirectoryEntry->VirtualAddress );
+
+	if ( ExportDirectoryData == NULL || ImageExportDirectory == NULL )
+		return false;
+
+	auto Hash    = HashBytes( &Version, sizeof( Version ), 0 );
+	auto Machine = Image.GetMachine();
+
+	Hash = HashBytes( &Machine, sizeof( Machine ), Hash );
+	Hash = HashBytes( Options.data(), Options.size(), Hash );
+	Hash = HashBytes( ExportDirectoryData, ExportDirectoryEntry->Size, Hash );
+
+	/* The tables and names usually live inside the directory but nothing forces a linker to put them there */
+	const auto FunctionArray    = Image.RvaToPointer<UINT32>( ImageExportDirectory->AddressOfFunctions,    ImageExportDirectory->NumberOfFunctions );
+	const auto NameOrdinalArray = Image.RvaToPointer<UINT16>( ImageExportDirectory->AddressOfNameOrdinals, ImageExportDirectory->NumberOfNames );
+	const auto NameArray        = Image.RvaToPointer<UINT32>( ImageExportDirectory->AddressOfNames,        ImageExportDirectory->NumberOfNames );
+
+	if ( FunctionArray != NULL )
+		Hash = HashBytes( FunctionArray, ImageExportDirectory->NumberOfFunctions * sizeof( UINT32 ), Hash );
+
+	if ( NameOrdinalArray != NULL )
+		Hash = HashBytes( NameOrdinalArray, ImageExportDirectory->NumberOfNames * sizeof( UINT16 ), Hash );
+
+	if ( NameArray != NULL )
+	{
+		for ( UINT32 NameIndex = 0; NameIndex < ImageExportDirectory->NumberOfNames; NameIndex++ )
+		{
+			auto Name = Image.RvaToString( NameArray[ NameIndex ] );
+
+			if ( Name != NULL )
+				Hash = HashBytes( Name, strlen( Name ), Hash );
+		}
+	}
+
+	for ( const auto& Section : Image.GetSections() )
+		Hash = HashBytes( &Section, sizeof( Section ), Hash );
+
+	*Key = Hash;
+
+	return true;
+}
+
+bool ProxyCache::IsUpToDate(
+	_In_  UINT64  Key,
+	_Out_ SIZE_T* NumberOfExports
+) const
+{
+	std::ifstream Stream( this->Path );
+
+	if ( !Stream.is_open() )
+		return false;
+
+	std::string Magic;
+	UINT32      FileVersion     = 0;
+	UINT64      FileKey         = 0;
+	UINT64      FileExportCount = 0;
+
+	Stream >> Magic >> FileVersion >> std::hex >> FileKey >> std::dec >> FileExportCount;
+
+	if ( !Stream || Magic != "DLLProxyCache" || FileVersion != Version || FileKey != Key )
+		return false;
+
+	UINT64      Size = 0;
+	UINT64      Hash = 0;
+	std::string Output;
+
+	while ( Stream >> Size >> std::hex >> Hash >> std::dec && std::getline( Stream >> std::ws, Output ) )
+	{
+		UINT64 OutputSize = 0;
+		UINT64 OutputHash = 0;
+
+		auto OutputPath = this->Path.parent_path() / std::filesystem::u8path( Output );
+
+		if ( !HashOutput( OutputPath, &OutputSize, &OutputHash ) || OutputSize != Size || OutputHash != Hash )
+			return false;
+	}
+
+	if ( !Stream.eof() )
+		return false;
+
+	*NumberOfExports = (SIZE_T)FileExportCount;
+
+	return true;
+}
+
+bool ProxyCache::Store(
+	_In_ UINT64                                      Key,
+	_In_ SIZE_T                                      NumberOfExports,
+	_In_ const std::vector< std::filesystem::path >& Outputs
+) const
+{
+	std::ostringstream Text;
+
+	Text << "DLLProxyCache " << Version << " " << std::hex << Key << std::dec << " " << NumberOfExports << "\n";
+
+	for ( const auto& Output : Outputs )
+	{
+		UINT64 Size = 0;
+		UINT64 Hash = 0;
+
+		if ( !HashOutput( Output, &Size, &Hash ) )
+			return false;
+
+		std::error_code Error;
+
+		auto Relative = std::filesystem::relative( Output, this->Path.parent_path(), Error );
+
+		if ( Error || Relative.empty() )
+			return false;
+
+		Text << Size << " " << std::hex << Hash << std::dec << " " << Relative.u8string() << "\n";
+	}
+
+	/* Replaced in one go, a generate racing this one sees either record whole and never a torn one */
+	OutputBuffer Cache( 0 );
+
+	if ( !Cache.Open( this->Path ) )
+		return false;
+
+	Cache << Text.str();
+
+	return Cache.Close();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Platform.h"
+#include "PEImage.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	Persistent record of what was generated for a DLL. The key hashes the
+	export directory, the tables and strings it references, the section
+	flags used for code/data classification, the machine type and the
+	generator options. When the key and every recorded output still match,
+	parsing and generation can be skipped entirely.
+*/
+class ProxyCache
+{
+public:
+	/* Bump whenever generated output changes for the same input */
+	static constexpr UINT32 Version = 6;
+
+	static UINT64 HashBytes(
+		_In_ const void* Data,
+		_In_ SIZE_T      Size,
+		_In_ UINT64      Seed
+	);
+
+	/* Returns false if the image has no usable export directory */
+	static bool ComputeKey(
+		_In_  const PEImage&   Image,
+		_In_  std::string_view Options,
+		_Out_ UINT64*          Key
+	);
+
+	ProxyCache(
+		_In_ std::filesystem::path Path
+	) : Path( Path )
+	{
+
+	}
+
+	/* True if the cache file holds Key and every output it lists still has the recorded size and content hash, NumberOfExports is what the outputs were generated from */
+	bool IsUpToDate(
+		_In_  UINT64  Key,
+		_Out_ SIZE_T* NumberOfExports
+	) const;
+
+	bool Store(
+		_In_ UINT64                                      Key,
+		_In_ SIZE_T                                      NumberOfExports,
+		_In_ const std::vector< std::filesystem::path >& Outputs
+	) const;
+
+private:
+	std::filesystem::path Path;
+};
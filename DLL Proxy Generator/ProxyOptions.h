@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "ForwarderResolver.h"
+#include "ExportCache.h"
+
+/*
+	Options that shape the generated proxy, shared by single, batch and
+	cached runs.
+*/
+struct ProxyOptions
+{
+	std::string VSProjectName;
+	std::string ForwardDLL;
+	std::string DLLName; // Replaces the name taken from the DLL path, needed for stdin
+	std::string DiffDLL; // Earlier build to report export changes against, never changes output
+	bool        Verbose           = false;
+	bool        GenerateVSProject = false;
+	bool        PreferDef         = false;
+	bool        UseCache          = false;
+	bool        LazyResolve       = false;
+	bool        Instrument        = false;
+	bool        WriteManifest     = false;
+	bool        Native            = false;
+	bool        ObjectStubs       = false;
+	bool        ImportLibrary     = false;
+	bool        ParallelEmit      = true;
+	SIZE_T      AsmShards         = 1;
+	std::string ForwarderSearchDir;
+	std::string ApiSetSchema;
+
+	/* Built once from ForwarderSearchDir and ApiSetSchema and shared by every DLL of a batch */
+	std::shared_ptr< ForwarderResolver > Resolver;
+
+	/* Export tables the daemon keeps between requests, never part of the output */
+	std::shared_ptr< ExportCache > ParsedExports;
+
+	/* Everything that changes generated output, feeds the regeneration cache key. DLLName is the name actually used */
+	std::string GetCacheKeyText(
+		_In_ const std::string& DLLName
+	) const
+	{
+		const std::string Flags = std::to_string( GenerateVSProject ) + std::to_string( PreferDef ) + std::to_string( LazyResolve ) + std::to_string( Instrument ) + std::to_string( WriteManifest ) + std::to_string( Native ) + std::to_string( ObjectStubs ) + std::to_string( ImportLibrary );
+
+		std::string Text;
+
+		/* Length prefixed, a separator inside a name or path cant make two option sets read the same */
+		for ( const auto& Field : { DLLName, VSProjectName, ForwardDLL, Flags, std::to_string( AsmShards ), ForwarderSearchDir, ApiSetSchema } )
+			Text += std::to_string( Field.size() ) + ":" + Field;
+
+		return Text;
+	}
+};
@@ -0,0 +1,200 @@
+#include "RunStats.h"
+#include "OutputBuffer.h"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined( _WIN32 )
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+bool                  RunStats::Enabled    = false;
+UINT64                RunStats::EnableTime = 0;
+std::atomic< UINT64 > RunStats::FilesWritten( 0 );
+std::atomic< UINT64 > RunStats::BytesWritten( 0 );
+std::atomic< UINT64 > RunStats::FilesUnchanged( 0 );
+std::atomic< UINT64 > RunStats::Allocations( 0 );
+std::atomic< UINT64 > RunStats::AllocatedBytes( 0 );
+
+struct PhaseTotal
+{
+	const char* Name;
+	UINT64      Nanoseconds;
+	UINT64      Calls;
+};
+
+/* Phases are few and recorded once per DLL or emitter, a locked list in first seen order is plenty */
+static std::mutex                PhaseLock;
+static std::vector< PhaseTotal > Phases;
+
+void RunStats::Enable()
+{
+	EnableTime = Now();
+	Enabled    = true;
+}
+
+void RunStats::AddTime(
+	_In_ const char* Phase,
+	_In_ UINT64      Nanoseconds,
+	_In_ UINT64      Calls
+)
+{
+	std::lock_guard< std::mutex > Guard( PhaseLock );
+
+	for ( auto& Total : Phases )
+	{
+		if ( strcmp( Total.Name, Phase ) == 0 )
+		{
+			Total.Nanoseconds += Nanoseconds;
+			Total.Calls       += Calls;
+			return;
+		}
+	}
+
+	Phases.push_back( { Phase, Nanoseconds, Calls } );
+}
+
+UINT64 RunStats::GetPeakResidentBytes()
+{
+#if defined( _WIN32 )
+	PROCESS_MEMORY_COUNTERS Counters;
+
+	if ( !GetProcessMemoryInfo( GetCurrentProcess(), &Counters, sizeof( Counters ) ) )
+		return 0;
+
+	return Counters.PeakWorkingSetSize;
+#else
+	struct rusage Usage;
+
+	if ( getrusage( RUSAGE_SELF, &Usage ) != 0 )
+		return 0;
+
+#if defined( __APPLE__ )
+	return (UINT64)Usage.ru_maxrss;
+#else
+	return (UINT64)Usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+void RunStats::PrintSummary()
+{
+	const double WallMilliseconds = ( Now() - EnableTime ) / 1e6;
+
+	std::vector< PhaseTotal > Snapshot;
+
+	{
+		std::lock_guard< std::mutex > Guard( PhaseLock );
+		Snapshot = Phases;
+	}
+
+	printf( "%-24s %10s %12s %12s\n", "Phase", "Calls", "Total ms", "Avg us" );
+
+	for ( const auto& Total : Snapshot )
+		printf( "%-24s %10llu %12.3f %12.3f\n", Total.Name, (unsigned long long)Total.Calls, Total.Nanoseconds / 1e6, Total.Calls ? Total.Nanoseconds / 1e3 / Total.Calls : 0.0 );
+
+	printf( "Wall %.3f ms, phase totals are summed over threads\n", WallMilliseconds );
+	printf( "Wrote %llu bytes to %llu files, %llu unchanged\n", (unsigned long long)BytesWritten.load(), (unsigned long long)FilesWritten.load(), (unsigned long long)FilesUnchanged.load() );
+	printf( "%llu allocations, %llu bytes allocated\n", (unsigned long long)Allocations.load(), (unsigned long long)AllocatedBytes.load() );
+	printf( "Peak RSS %.1f MB\n", GetPeakResidentBytes() / ( 1024.0 * 1024.0 ) );
+}
+
+bool RunStats::WriteJSON(
+	_In_ const std::filesystem::path& Path
+)
+{
+	/* Taken before the report itself adds to the counters */
+	const auto WallNanoseconds = Now() - EnableTime;
+	const auto Files           = FilesWritten.load();
+	const auto Bytes           = BytesWritten.load();
+	const auto Unchanged       = FilesUnchanged.load();
+	const auto Count           = Allocations.load();
+	const auto CountBytes      = AllocatedBytes.load();
+
+	std::vector< PhaseTotal > Snapshot;
+
+	{
+		std::lock_guard< std::mutex > Guard( PhaseLock );
+		Snapshot = Phases;
+	}
+
+	OutputBuffer Report( 4096 );
+
+	if ( !Report.Open( Path ) )
+		return false;
+
+	Report << "{\"wall_ns\":" << WallNanoseconds << ",\"phases\":[";
+
+	for ( SIZE_T Index = 0; Index < Snapshot.size(); Index++ )
+	{
+		if ( Index != 0 )
+			Report << ',';
+
+		Report << "{\"name\":\"" << Snapshot[ Index ].Name << "\",\"calls\":" << Snapshot[ Index ].Calls << ",\"ns\":" << Snapshot[ Index ].Nanoseconds << '}';
+	}
+
+	Report << "],\"files_written\":" << Files << ",\"bytes_written\":" << Bytes << ",\"files_unchanged\":" << Unchanged;
+	Report << ",\"allocations\":" << Count << ",\"allocated_bytes\":" << CountBytes;
+	Report << ",\"peak_rss_bytes\":" << GetPeakResidentBytes() << "}\n";
+
+	if ( !Report.Close() )
+	{
+		printf( "Failed to write stats to %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Every allocation in the program goes through here so --stats can count
+	them. The array forms forward to this one by default. The nothrow form
+	is replaced too, sanitizer runtimes provide their own and std::stable_sort
+	hands its blocks to our delete.
+*/
+void* operator new( size_t Size )
+{
+	RunStats::AddAllocation( Size );
+
+	for ( ;; )
+	{
+		void* Block = malloc( Size ? Size : 1 );
+
+		if ( Block != NULL )
+			return Block;
+
+		auto Handler = std::get_new_handler();
+
+		if ( Handler == NULL )
+			throw std::bad_alloc();
+
+		Handler();
+	}
+}
+
+void operator delete( void* Block ) noexcept
+{
+	free( Block );
+}
+
+void* operator new( size_t Size, const std::nothrow_t& ) noexcept
+{
+	RunStats::AddAllocation( Size );
+
+	return malloc( Size ? Size : 1 );
+}
+
+void operator delete( void* Block, size_t ) noexcept
+{
+	free( Block );
+}
+
+void operator delete( void* Block, const std::nothrow_t& ) noexcept
+{
+	free( Block );
+}
\ No newline at end of file
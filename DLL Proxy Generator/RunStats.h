@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Platform.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+/*
+	Process wide phase timings and resource counters for --timings and
+	--stats. Everything is off until Enable is called, after that each
+	phase accumulates its total time and call count, so a batch run sums
+	the work of every thread into one report.
+
+	Phases nest, the export walk includes the time spent classifying RVAs.
+*/
+class RunStats
+{
+public:
+	/* Records the time between construction and destruction against Phase */
+	class Timer
+	{
+	public:
+		Timer(
+			_In_ const char* Phase
+		) : Phase( Phase ), Start( RunStats::IsEnabled() ? RunStats::Now() : 0 )
+		{
+
+		}
+
+		~Timer()
+		{
+			if ( RunStats::IsEnabled() )
+				RunStats::AddTime( this->Phase, RunStats::Now() - this->Start );
+		}
+
+		Timer( const Timer& ) = delete;
+		Timer& operator=( const Timer& ) = delete;
+
+	private:
+		const char* Phase;
+		UINT64      Start;
+	};
+
+	/* Call once before any work starts, counting allocations begins here */
+	static void Enable();
+
+	/* Stops timing and counting, totals so far are kept. Only call while no other thread is working */
+	static void Disable()
+	{
+		Enabled = false;
+	}
+
+	static bool IsEnabled()
+	{
+		return Enabled;
+	}
+
+	/* Monotonic nanoseconds */
+	static UINT64 Now()
+	{
+		return (UINT64)std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	static void AddTime(
+		_In_ const char* Phase,
+		_In_ UINT64      Nanoseconds,
+		_In_ UINT64      Calls = 1
+	);
+
+	static void AddFileWritten(
+		_In_ SIZE_T Bytes
+	)
+	{
+		if ( !Enabled )
+			return;
+
+		FilesWritten.fetch_add( 1, std::memory_order_relaxed );
+		BytesWritten.fetch_add( Bytes, std::memory_order_relaxed );
+	}
+
+	/* An output left as it was because it already held the generated text */
+	static void AddFileUnchanged()
+	{
+		if ( !Enabled )
+			return;
+
+		FilesUnchanged.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	/* Called from the replaced operator new, must not allocate */
+	static void AddAllocation(
+		_In_ SIZE_T Size
+	)
+	{
+		if ( !Enabled )
+			return;
+
+		Allocations.fetch_add( 1, std::memory_order_relaxed );
+		AllocatedBytes.fetch_add( Size, std::memory_order_relaxed );
+	}
+
+	static UINT64 GetAllocations()
+	{
+		return Allocations.load( std::memory_order_relaxed );
+	}
+
+	static UINT64 GetAllocatedBytes()
+	{
+		return AllocatedBytes.load( std::memory_order_relaxed );
+	}
+
+	/* Peak working set of the process, 0 if the platform cant tell */
+	static UINT64 GetPeakResidentBytes();
+
+	static void PrintSummary();
+
+	static bool WriteJSON(
+		_In_ const std::filesystem::path& Path
+	);
+
+private:
+	static bool                  Enabled;
+	static UINT64                EnableTime;
+	static std::atomic< UINT64 > FilesWritten;
+	static std::atomic< UINT64 > BytesWritten;
+	static std::atomic< UINT64 > FilesUnchanged;
+	static std::atomic< UINT64 > Allocations;
+	static std::atomic< UINT64 > AllocatedBytes;
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "Platform.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Fixed size work stealing pool. Every worker owns a deque, it pops its own
+	work from the back and steals from the front of the others when it runs dry
+	so one slow DLL never holds up the rest of a batch.
+*/
+class ThreadPool
+{
+public:
+	typedef std::function< void() > Task;
+
+	ThreadPool(
+		_In_ SIZE_T NumberOfThreads
+	) : Queued( 0 ), Pending( 0 ), NextQueue( 0 ), Stopping( false )
+	{
+		if ( NumberOfThreads == 0 )
+			NumberOfThreads = 1;
+
+		for ( SIZE_T QueueIndex = 0; QueueIndex < NumberOfThreads; QueueIndex++ )
+			this->Queues.push_back( std::make_unique< WorkQueue >() );
+
+		for ( SIZE_T WorkerIndex = 0; WorkerIndex < NumberOfThreads; WorkerIndex++ )
+			this->Workers.emplace_back( &ThreadPool::WorkerMain, this, WorkerIndex );
+	}
+
+	~ThreadPool()
+	{
+		this->Wait();
+
+		{
+			std::lock_guard< std::mutex > Guard( this->SleepLock );
+			this->Stopping = true;
+		}
+
+		this->WakeUp.notify_all();
+
+		for ( auto& Worker : this->Workers )
+			Worker.join();
+	}
+
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	SIZE_T GetThreadCount() const
+	{
+		return this->Workers.size();
+	}
+
+	void Submit(
+		_In_ Task Work
+	)
+	{
+		/* Work spawned by a worker stays local, everything else is dealt round robin */
+		auto QueueIndex = CurrentWorker() != NoWorker ? CurrentWorker() : this->NextQueue++ % this->Queues.size();
+		auto& Queue     = *this->Queues[ QueueIndex ];
+
+		this->Pending++;
+
+		{
+			std::lock_guard< std::mutex > Guard( Queue.Lock );
+			Queue.Tasks.push_back( std::move( Work ) );
+		}
+
+		{
+			std::lock_guard< std::mutex > Guard( this->SleepLock );
+			this->Queued++;
+		}
+
+		this->WakeUp.notify_one();
+	}
+
+	/* Blocks until every submitted task has finished */
+	void Wait()
+	{
+		std::unique_lock< std::mutex > Guard( this->SleepLock );
+
+		this->Idle.wait( Guard, [ this ]() { return this->Pending == 0; } );
+	}
+
+private:
+	struct WorkQueue
+	{
+		std::mutex         Lock;
+		std::deque< Task > Tasks;
+	};
+
+	static const SIZE_T NoWorker = ~(SIZE_T)0;
+
+	static SIZE_T& CurrentWorker()
+	{
+		static thread_local SIZE_T WorkerIndex = NoWorker;
+		return WorkerIndex;
+	}
+
+	bool TryPop(
+		_In_  SIZE_T WorkerIndex,
+		_Out_ Task&  Work
+	)
+	{
+		for ( SIZE_T Offset = 0; Offset < this->Queues.size(); Offset++ )
+		{
+			auto& Queue = *this->Queues[ ( WorkerIndex + Offset ) % this->Queues.size() ];
+
+			std::lock_guard< std::mutex > Guard( Queue.Lock );
+
+			if ( Queue.Tasks.empty() )
+				continue;
+
+			if ( Offset == 0 )
+			{
+				Work = std::move( Queue.Tasks.back() );
+				Queue.Tasks.pop_back();
+			}
+			else
+			{
+				Work = std::move( Queue.Tasks.front() );
+				Queue.Tasks.pop_front();
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void WorkerMain(
+		_In_ SIZE_T WorkerIndex
+	)
+	{
+		CurrentWorker() = WorkerIndex;
+
+		while ( true )
+		{
+			{
+				std::unique_lock< std::mutex > Guard( this->SleepLock );
+
+				this->WakeUp.wait( Guard, [ this ]() { return this->Stopping || this->Queued > 0; } );
+
+				if ( this->Queued == 0 )
+					return;
+
+				this->Queued--;
+			}
+
+			/* Queued counted this task so some queue is guaranteed to hold one */
+			Task Work;
+
+			while ( !this->TryPop( WorkerIndex, Work ) )
+				std::this_thread::yield();
+
+			Work();
+
+			if ( --this->Pending == 0 )
+			{
+				std::lock_guard< std::mutex > Guard( this->SleepLock );
+				this->Idle.notify_all();
+			}
+		}
+	}
+
+	std::vector< std::unique_ptr< WorkQueue > > Queues;
+	std::vector< std::thread >                  Workers;
+	std::mutex                                  SleepLock;
+	std::condition_variable                     WakeUp;
+	std::condition_variable                     Idle;
+	SIZE_T                                      Queued;
+	std::atomic< SIZE_T >                       Pending;
+	std::atomic< SIZE_T >                       NextQueue;
+	bool                                        Stopping;
+};
@@ -1,11 +1,12 @@
 #pragma once
 
+#include "Platform.h"
 #include <string>
+#include <vector>
+#include <memory>
 #include <filesystem>
 #include <sstream>
-#include <fstream>
-#include <basetsd.h>
-#include <winnt.h>
+#include "OutputBuffer.h"
 
 class VSFile
 {
@@ -36,13 +37,13 @@ public:
 	{
 		std::stringstream ss;
 
-		ss << "\t\t<MASM Include=\"" << this->Name << "\">" << std::endl;
-		ss << "\t\t\t<FileType>Document</FileType>" << std::endl;
-		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Debug|Win32\'\">true</UseSafeExceptionHandlers>" << std::endl;
-		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Release|Win32\'\">true</UseSafeExceptionHandlers>" << std::endl;
-		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Debug|x64\'\">false</UseSafeExceptionHandlers>" << std::endl;
-		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Release|x64\'\">false</UseSafeExceptionHandlers>" << std::endl;
-		ss << "\t\t</MASM>" << std::endl;
+		ss << "\t\t<MASM Include=\"" << this->Name << "\">\n";
+		ss << "\t\t\t<FileType>Document</FileType>\n";
+		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Debug|Win32\'\">true</UseSafeExceptionHandlers>\n";
+		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Release|Win32\'\">true</UseSafeExceptionHandlers>\n";
+		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Debug|x64\'\">false</UseSafeExceptionHandlers>\n";
+		ss << "\t\t\t<UseSafeExceptionHandlers Condition=\"\'$(Configuration)|$(Platform)\' == \'Release|x64\'\">false</UseSafeExceptionHandlers>\n";
+		ss << "\t\t</MASM>\n";
 
 		return ss.str();
 	}
@@ -80,6 +81,23 @@ public:
 	}
 };
 
+/* Prebuilt objects go straight to the linker */
+class VSObjectFile : public VSFile
+{
+public:
+	VSObjectFile(
+		_In_  std::string Name
+	) : VSFile( Name )
+	{
+
+	}
+
+	virtual std::string GetEntryText()
+	{
+		return "\t\t<Object Include=\"" + this->Name + "\"/>\n";
+	}
+};
+
 class VSProjectConfig
 {
 public:
@@ -133,16 +151,14 @@ public:
 
 	bool GenerateProjectFile(std::filesystem::path Out)
 	{
-		std::ofstream Stream;
-
-		Stream.open( Out );
+		OutputBuffer Stream;
 
-		if ( !Stream.is_open() )
+		if ( !Stream.Open( Out ) )
 			return false;
 
-		Stream << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << std::endl;
-		Stream << "<Project DefaultTargets=\"Build\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">" << std::endl;
-		Stream << "\t<ItemGroup Label=\"ProjectConfigurations\">" << std::endl;
+		Stream << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+		Stream << "<Project DefaultTargets=\"Build\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n";
+		Stream << "\t<ItemGroup Label=\"ProjectConfigurations\">\n";
 
 		auto Configs = this->GetConfigs();
 
@@ -151,126 +167,126 @@ public:
 
 		for ( auto& Config : Configs )
 		{
-			Stream << "\t<ProjectConfiguration Include=\"" << Config.IncludeName << "\">" << std::endl;
-			Stream << "\t\t<Configuration>" << Config.Type << "</Configuration>" << std::endl;
-			Stream << "\t\t<Platform>" << Config.PlatformName << "</Platform>" << std::endl;
-			Stream << "\t</ProjectConfiguration>" << std::endl;
+			Stream << "\t<ProjectConfiguration Include=\"" << Config.IncludeName << "\">\n";
+			Stream << "\t\t<Configuration>" << Config.Type << "</Configuration>\n";
+			Stream << "\t\t<Platform>" << Config.PlatformName << "</Platform>\n";
+			Stream << "\t</ProjectConfiguration>\n";
 		}
 
-		Stream << "\t</ItemGroup>" << std::endl;
+		Stream << "\t</ItemGroup>\n";
 
-		Stream << "\t<PropertyGroup Label=\"Globals\">" << std::endl;
-		Stream << "\t<VCProjectVersion>16.0</VCProjectVersion>" << std::endl;
-		Stream << "\t<ProjectGuid>{3ff28f45-6628-4023-bba2-734b67252be9}</ProjectGuid>" << std::endl;
-		Stream << "\t<RootNamespace>{3ff28f45-6628-4023-bba2-734b67252be9}</RootNamespace>" << std::endl;
-		Stream << "\t<WindowsTargetPlatformVersion>10.0</WindowsTargetPlatformVersion>" << std::endl;
-		Stream << "\t</PropertyGroup>" << std::endl;
+		Stream << "\t<PropertyGroup Label=\"Globals\">\n";
+		Stream << "\t<VCProjectVersion>16.0</VCProjectVersion>\n";
+		Stream << "\t<ProjectGuid>{3ff28f45-6628-4023-bba2-734b67252be9}</ProjectGuid>\n";
+		Stream << "\t<RootNamespace>{3ff28f45-6628-4023-bba2-734b67252be9}</RootNamespace>\n";
+		Stream << "\t<WindowsTargetPlatformVersion>10.0</WindowsTargetPlatformVersion>\n";
+		Stream << "\t</PropertyGroup>\n";
 
-		Stream << "\t<Import Project=\"$(VCTargetsPath)\Microsoft.Cpp.Default.props\"/>" << std::endl;
+		Stream << "\t<Import Project=\"$(VCTargetsPath)\Microsoft.Cpp.Default.props\"/>\n";
 
 		for ( auto& Config : Configs )
 		{
 			if ( Config.Type == "Debug" )
 			{
-				Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">" << std::endl;
-				Stream << "\t\t<ConfigurationType>DynamicLibrary</ConfigurationType>" << std::endl;
-				Stream << "\t\t<UseDebugLibraries>true</UseDebugLibraries>" << std::endl;
-				Stream << "\t\t<PlatformToolset>v142</PlatformToolset>" << std::endl;
-				Stream << "\t\t<CharacterSet>Unicode</CharacterSet>" << std::endl;
-				Stream << "\t</PropertyGroup>" << std::endl;
+				Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">\n";
+				Stream << "\t\t<ConfigurationType>DynamicLibrary</ConfigurationType>\n";
+				Stream << "\t\t<UseDebugLibraries>true</UseDebugLibraries>\n";
+				Stream << "\t\t<PlatformToolset>v142</PlatformToolset>\n";
+				Stream << "\t\t<CharacterSet>Unicode</CharacterSet>\n";
+				Stream << "\t</PropertyGroup>\n";
 			}
 			else
 			{
-				Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">" << std::endl;
-				Stream << "\t\t<ConfigurationType>DynamicLibrary</ConfigurationType>" << std::endl;
-				Stream << "\t\t<UseDebugLibraries>false</UseDebugLibraries>" << std::endl;
-				Stream << "\t\t<PlatformToolset>v142</PlatformToolset>" << std::endl;
-				Stream << "\t\t<WholeProgramOptimization>true</WholeProgramOptimization>" << std::endl;
-				Stream << "\t\t<CharacterSet>Unicode</CharacterSet>" << std::endl;
-				Stream << "\t</PropertyGroup>" << std::endl;
+				Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">\n";
+				Stream << "\t\t<ConfigurationType>DynamicLibrary</ConfigurationType>\n";
+				Stream << "\t\t<UseDebugLibraries>false</UseDebugLibraries>\n";
+				Stream << "\t\t<PlatformToolset>v142</PlatformToolset>\n";
+				Stream << "\t\t<WholeProgramOptimization>true</WholeProgramOptimization>\n";
+				Stream << "\t\t<CharacterSet>Unicode</CharacterSet>\n";
+				Stream << "\t</PropertyGroup>\n";
 			}
 		}
 
-		Stream << "\t<Import Project=\"$(VCTargetsPath)\Microsoft.Cpp.props\" />" << std::endl;
-		Stream << "\t<ImportGroup Label=\"ExtensionSettings\">" << std::endl;
-		Stream << "\t\t<Import Project=\"$(VCTargetsPath)\\BuildCustomizations\\masm.props\"/>" << std::endl;
-		Stream << "\t</ImportGroup>" << std::endl;
-		Stream << "\t<ImportGroup Label=\"Shared\">" << std::endl;
-		Stream << "\t</ImportGroup>" << std::endl;
+		Stream << "\t<Import Project=\"$(VCTargetsPath)\Microsoft.Cpp.props\" />\n";
+		Stream << "\t<ImportGroup Label=\"ExtensionSettings\">\n";
+		Stream << "\t\t<Import Project=\"$(VCTargetsPath)\\BuildCustomizations\\masm.props\"/>\n";
+		Stream << "\t</ImportGroup>\n";
+		Stream << "\t<ImportGroup Label=\"Shared\">\n";
+		Stream << "\t</ImportGroup>\n";
 
 		for ( auto& Config : Configs )
 		{
-			Stream << "\t<ImportGroup Label=\"PropertySheets\" Condition=\"\'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\">" << std::endl;
-			Stream << "\t\t<Import Project=\"$(UserRootDir)\\Microsoft.Cpp.$(Platform).user.props\" Condition=\"exists(\'$(UserRootDir)\\Microsoft.Cpp.$(Platform).user.props\')\" Label=\"LocalAppDataPlatform\" />" << std::endl;
-			Stream << "\t</ImportGroup>" << std::endl;
+			Stream << "\t<ImportGroup Label=\"PropertySheets\" Condition=\"\'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\">\n";
+			Stream << "\t\t<Import Project=\"$(UserRootDir)\\Microsoft.Cpp.$(Platform).user.props\" Condition=\"exists(\'$(UserRootDir)\\Microsoft.Cpp.$(Platform).user.props\')\" Label=\"LocalAppDataPlatform\" />\n";
+			Stream << "\t</ImportGroup>\n";
 		}
 
-		Stream << "\t<PropertyGroup Label=\"UserMacros\"\/>" << std::endl;
+		Stream << "\t<PropertyGroup Label=\"UserMacros\"\/>\n";
 
 		for ( auto& Config : Configs )
 		{
-			Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">" << std::endl;
-			Stream << "\t\t<LinkIncremental>true</LinkIncremental>" << std::endl;
-			Stream << "\t</PropertyGroup>" << std::endl;
+			Stream << "\t<PropertyGroup Condition=\"'$(Configuration)|$(Platform)\'==\'" << Config.IncludeName << "\'\" Label=\"Configuration\">\n";
+			Stream << "\t\t<LinkIncremental>true</LinkIncremental>\n";
+			Stream << "\t</PropertyGroup>\n";
 		}
 
 		for ( auto& Config : Configs )
 		{
-			Stream << "\t<ItemDefinitionGroup Condition=\"\'$(Configuration)|$(Platform)\' == \'" << Config.IncludeName << "\'\">" << std::endl;
-			Stream << "\t\t<ClCompile>" << std::endl;
-			Stream << "\t\t\t<WarningLevel>Level3</WarningLevel>" << std::endl;
-			Stream << "\t\t\t<SDLCheck>true</SDLCheck>" << std::endl;
-			Stream << "\t\t\t<ConformanceMode>true</ConformanceMode>" << std::endl;
-			Stream << "\t\t\t<PrecompiledHeader>NotUsing</PrecompiledHeader>" << std::endl;
-			Stream << "\t\t</ClCompile>" << std::endl;
+			Stream << "\t<ItemDefinitionGroup Condition=\"\'$(Configuration)|$(Platform)\' == \'" << Config.IncludeName << "\'\">\n";
+			Stream << "\t\t<ClCompile>\n";
+			Stream << "\t\t\t<WarningLevel>Level3</WarningLevel>\n";
+			Stream << "\t\t\t<SDLCheck>true</SDLCheck>\n";
+			Stream << "\t\t\t<ConformanceMode>true</ConformanceMode>\n";
+			Stream << "\t\t\t<PrecompiledHeader>NotUsing</PrecompiledHeader>\n";
+			Stream << "\t\t</ClCompile>\n";
 			
-			Stream << "\t\t<Link>" << std::endl;
-			Stream << "\t\t\t<SubSystem>Windows</SubSystem>" << std::endl;
+			Stream << "\t\t<Link>\n";
+			Stream << "\t\t\t<SubSystem>Windows</SubSystem>\n";
 
 			if ( Config.Type == "Debug" )
-				Stream << "\t\t\t<GenerateDebugInformation>true</GenerateDebugInformation>" << std::endl;
+				Stream << "\t\t\t<GenerateDebugInformation>true</GenerateDebugInformation>\n";
 			else
-				Stream << "\t\t\t<GenerateDebugInformation>false</GenerateDebugInformation>" << std::endl;
+				Stream << "\t\t\t<GenerateDebugInformation>false</GenerateDebugInformation>\n";
 
 			if( DefinitionFile.size() > 0 )
-				Stream << "\t\t\t<ModuleDefinitionFile>"<< DefinitionFile << "</ModuleDefinitionFile>" << std::endl;
+				Stream << "\t\t\t<ModuleDefinitionFile>"<< DefinitionFile << "</ModuleDefinitionFile>\n";
 			
-			Stream << "\t\t</Link>" << std::endl;
-			Stream << "\t</ItemDefinitionGroup>" << std::endl;
+			Stream << "\t\t</Link>\n";
+			Stream << "\t</ItemDefinitionGroup>\n";
 		}
 
-		Stream << "\t<ItemGroup>" << std::endl;
+		Stream << "\t<ItemGroup>\n";
 
 		for ( auto File : this->Files )
 		{
-			Stream << File->GetEntryText() << std::endl;
+			Stream << File->GetEntryText() << "\n";
 		}
 
-		Stream << "\t</ItemGroup>" << std::endl;
+		Stream << "\t</ItemGroup>\n";
 
 		if ( DefinitionFile.size() > 0 )
 		{
-			Stream << "\t<ItemGroup>" << std::endl;
-			Stream << "\t\t<None Include=\"" << DefinitionFile << "\"/>" << std::endl;
-			Stream << "\t</ItemGroup>" << std::endl;
+			Stream << "\t<ItemGroup>\n";
+			Stream << "\t\t<None Include=\"" << DefinitionFile << "\"/>\n";
+			Stream << "\t</ItemGroup>\n";
 		}
 
-		Stream << "\t<Import Project=\"$(VCTargetsPath)\\Microsoft.Cpp.targets\" />" << std::endl;
+		Stream << "\t<Import Project=\"$(VCTargetsPath)\\Microsoft.Cpp.targets\" />\n";
 
-		Stream << "\t<ImportGroup Label=\"ExtensionTargets\">" << std::endl;
-		Stream << "\t\t<Import Project=\"$(VCTargetsPath)\\BuildCustomizations\\masm.targets\"/>" << std::endl;
-		Stream << "\t</ImportGroup>" << std::endl;
+		Stream << "\t<ImportGroup Label=\"ExtensionTargets\">\n";
+		Stream << "\t\t<Import Project=\"$(VCTargetsPath)\\BuildCustomizations\\masm.targets\"/>\n";
+		Stream << "\t</ImportGroup>\n";
 
-		Stream << "</Project>" << std::endl;
+		Stream << "</Project>\n";
 
-		return true;
+		return Stream.Close();
 	}
 
 	bool Generate()
 	{
 		/*TODO: Generate .sln?*/
 
-		if ( !this->GenerateProjectFile( OutDir / Name += ".vcxproj" ) )
+		if ( !this->GenerateProjectFile( this->GetProjectFilePath() ) )
 		{
 			printf( "Failed To Generate Project File\n" );
 			return false;
@@ -284,6 +300,11 @@ public:
 		return this->OutDir;
 	}
 
+	std::filesystem::path GetProjectFilePath() const
+	{
+		return this->OutDir / ( this->Name + ".vcxproj" );
+	}
+
 	template <typename T, typename... TArgs>
 	inline std::shared_ptr< T > AddFile( TArgs&&... Args )
 	{
@@ -0,0 +1,313 @@
+#include "FixtureBuilder.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+/* Layout of the images Build writes, sections go .text, .data then .rdata */
+static const UINT32 NtOffset         = 0x40;
+static const UINT32 SectionAlignment = 0x1000;
+static const UINT32 FileAlignment    = 0x200;
+static const UINT32 NumberOfSections = 3;
+
+static UINT32 AlignUp(
+	_In_ UINT32 Value,
+	_In_ UINT32 Alignment
+)
+{
+	return ( Value + Alignment - 1 ) & ~( Alignment - 1 );
+}
+
+template< typename T >
+static void Poke(
+	_Inout_ std::string& Buffer,
+	_In_    SIZE_T       Offset,
+	_In_    const T&     Value
+)
+{
+	memcpy( &Buffer[ Offset ], &Value, sizeof( T ) );
+}
+
+FixtureSpec FixtureBuilder::GetDefaultSpec(
+	_In_ UINT16 Machine,
+	_In_ UINT32 NumberOfExports
+)
+{
+	FixtureSpec Spec = {};
+
+	Spec.Machine          = Machine;
+	Spec.NumberOfExports  = NumberOfExports;
+	Spec.OrdinalBase      = 1;
+	Spec.NoNamePercent    = 10;
+	Spec.DataPercent      = 5;
+	Spec.ForwardedPercent = 5;
+	Spec.GapPercent       = 2;
+	Spec.MinNameLength    = 8;
+	Spec.MaxNameLength    = 32;
+	Spec.Seed             = 1;
+
+	return Spec;
+}
+
+FixtureBuilder::FixtureBuilder(
+	_In_ const FixtureSpec& Spec
+) : Spec( Spec ), NumberOfFunctions( 0 )
+{
+	static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_";
+
+	/* Raw mt19937 output is specified by the standard, the distributions are not */
+	std::mt19937 Random( Spec.Seed );
+
+	auto Roll = [ & ]( UINT32 Percent )
+	{
+		return Random() % 100 < Percent;
+	};
+
+	const UINT32 MaxNumberOfFunctions = GetMaxNumberOfFunctions( Spec.OrdinalBase );
+	const UINT32 NumberOfExports      = std::min( Spec.NumberOfExports, MaxNumberOfFunctions );
+	const UINT32 NameLengthRange      = Spec.MaxNameLength > Spec.MinNameLength ? Spec.MaxNameLength - Spec.MinNameLength + 1 : 1;
+
+	this->Exports.reserve( NumberOfExports );
+
+	for ( UINT32 Index = 0; Index < NumberOfExports; Index++ )
+	{
+		/* Only leave a gap while the remaining exports still fit below the last ordinal */
+		if ( Roll( Spec.GapPercent ) && this->NumberOfFunctions + NumberOfExports - Index < MaxNumberOfFunctions )
+			this->NumberOfFunctions++;
+
+		Export Entry;
+
+		Entry.OrdinalIndex = this->NumberOfFunctions++;
+		Entry.Ordinal      = Spec.OrdinalBase + Entry.OrdinalIndex;
+		Entry.IsData       = false;
+
+		/* The index prefix keeps names unique, random characters pad it out to the rolled length */
+		if ( !Roll( Spec.NoNamePercent ) )
+		{
+			char Prefix[ 16 ];
+
+			snprintf( Prefix, sizeof( Prefix ), "Fx%05X_", Index );
+
+			const UINT32 Length = Spec.MinNameLength + Random() % NameLengthRange;
+
+			Entry.Name = Prefix;
+
+			while ( Entry.Name.size() < Length )
+				Entry.Name.push_back( Alphabet[ Random() % ( sizeof( Alphabet ) - 1 ) ] );
+		}
+
+		if ( Roll( Spec.ForwardedPercent ) )
+		{
+			if ( Entry.Name.size() && Random() % 10 )
+				Entry.Forwarder = "FIXTURE_TARGET." + Entry.Name;
+			else
+				Entry.Forwarder = "FIXTURE_TARGET.#" + std::to_string( Entry.Ordinal );
+		}
+		else
+		{
+			Entry.IsData = Roll( Spec.DataPercent );
+		}
+
+		this->Exports.push_back( std::move( Entry ) );
+	}
+}
+
+bool FixtureBuilder::Build(
+	_Inout_ std::string& Image
+) const
+{
+	if ( this->Spec.Machine != IMAGE_FILE_MACHINE_AMD64 && this->Spec.Machine != IMAGE_FILE_MACHINE_I386 )
+	{
+		printf( "Fixtures are only built for AMD64 and I386, not machine %04X\n", this->Spec.Machine );
+		return false;
+	}
+
+	if ( this->Spec.NumberOfExports > GetMaxNumberOfFunctions( this->Spec.OrdinalBase ) )
+	{
+		printf( "Ordinal base %u leaves room for %u exports, %u were asked for\n", this->Spec.OrdinalBase, GetMaxNumberOfFunctions( this->Spec.OrdinalBase ), this->Spec.NumberOfExports );
+		return false;
+	}
+
+	const bool   IsAMD64        = this->Spec.Machine == IMAGE_FILE_MACHINE_AMD64;
+	const UINT32 OptionalSize   = IsAMD64 ? sizeof( IMAGE_OPTIONAL_HEADER64 ) : sizeof( IMAGE_OPTIONAL_HEADER32 );
+	const UINT32 OptionalOffset = NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER );
+	const UINT32 SectionOffset  = OptionalOffset + OptionalSize;
+	const UINT32 SizeOfHeaders  = AlignUp( SectionOffset + NumberOfSections * sizeof( IMAGE_SECTION_HEADER ), FileAlignment );
+
+	/* Code and data only hold one slot per export, size them first so .rdata can be laid out at its final RVA */
+	UINT32 NumberOfCode = 0;
+	UINT32 NumberOfData = 0;
+
+	for ( const auto& Entry : this->Exports )
+	{
+		if ( Entry.Forwarder.size() )
+			continue;
+
+		if ( Entry.IsData )
+			NumberOfData++;
+		else
+			NumberOfCode++;
+	}
+
+	/* Sections without raw data confuse some tools, keep one byte in each */
+	std::string Code( std::max< UINT32 >( NumberOfCode, 1 ), '\xC3' );
+	std::string ReadWrite( std::max< UINT32 >( NumberOfData * sizeof( UINT64 ), 1 ), '\0' );
+
+	const UINT32 TextVA  = SectionAlignment;
+	const UINT32 DataVA  = TextVA + AlignUp( (UINT32)Code.size(), SectionAlignment );
+	const UINT32 RDataVA = DataVA + AlignUp( (UINT32)ReadWrite.size(), SectionAlignment );
+
+	/* The loader binary searches the name pointer table so names go in byte order */
+	std::vector< const Export* > Named;
+
+	for ( const auto& Entry : this->Exports )
+	{
+		if ( Entry.Name.size() )
+			Named.push_back( &Entry );
+	}
+
+	std::sort( Named.begin(), Named.end(), []( const Export* Left, const Export* Right ) { return Left->Name < Right->Name; } );
+
+	const UINT32 AddressOfFunctions    = sizeof( IMAGE_EXPORT_DIRECTORY );
+	const UINT32 AddressOfNames        = AddressOfFunctions + this->NumberOfFunctions * sizeof( UINT32 );
+	const UINT32 AddressOfNameOrdinals = AddressOfNames + (UINT32)Named.size() * sizeof( UINT32 );
+
+	std::string ReadOnly( AddressOfNameOrdinals + Named.size() * sizeof( UINT16 ), '\0' );
+
+	IMAGE_EXPORT_DIRECTORY Directory = {};
+
+	Directory.TimeDateStamp         = this->Spec.Seed;
+	Directory.Name                  = RDataVA + (UINT32)ReadOnly.size();
+	Directory.Base                  = this->Spec.OrdinalBase;
+	Directory.NumberOfFunctions     = this->NumberOfFunctions;
+	Directory.NumberOfNames         = (DWORD)Named.size();
+	Directory.AddressOfFunctions    = RDataVA + AddressOfFunctions;
+	Directory.AddressOfNames        = RDataVA + AddressOfNames;
+	Directory.AddressOfNameOrdinals = RDataVA + AddressOfNameOrdinals;
+
+	Poke( ReadOnly, 0, Directory );
+	ReadOnly.append( "fixture.dll", sizeof( "fixture.dll" ) );
+
+	for ( UINT32 NameIndex = 0; NameIndex < Named.size(); NameIndex++ )
+	{
+		Poke< UINT32 >( ReadOnly, AddressOfNames + NameIndex * sizeof( UINT32 ), RDataVA + (UINT32)ReadOnly.size() );
+		Poke< UINT16 >( ReadOnly, AddressOfNameOrdinals + NameIndex * sizeof( UINT16 ), (UINT16)Named[ NameIndex ]->OrdinalIndex );
+		ReadOnly.append( Named[ NameIndex ]->Name.c_str(), Named[ NameIndex ]->Name.size() + 1 );
+	}
+
+	/* Gaps keep a zero RVA, everything else points at a ret, a data slot or its forwarder string */
+	UINT32 CodeIndex = 0;
+	UINT32 DataIndex = 0;
+
+	for ( const auto& Entry : this->Exports )
+	{
+		const SIZE_T Slot = AddressOfFunctions + Entry.OrdinalIndex * sizeof( UINT32 );
+
+		if ( Entry.Forwarder.size() )
+		{
+			Poke< UINT32 >( ReadOnly, Slot, RDataVA + (UINT32)ReadOnly.size() );
+			ReadOnly.append( Entry.Forwarder.c_str(), Entry.Forwarder.size() + 1 );
+		}
+		else if ( Entry.IsData )
+		{
+			Poke< UINT32 >( ReadOnly, Slot, DataVA + DataIndex * sizeof( UINT64 ) );
+			Poke< UINT64 >( ReadWrite, DataIndex * sizeof( UINT64 ), Entry.Ordinal );
+			DataIndex++;
+		}
+		else
+		{
+			Poke< UINT32 >( ReadOnly, Slot, TextVA + CodeIndex++ );
+		}
+	}
+
+	const UINT32 ExportSize  = (UINT32)ReadOnly.size();
+	const UINT32 SizeOfImage = RDataVA + AlignUp( ExportSize, SectionAlignment );
+
+	struct SectionData
+	{
+		const char*        Name;
+		UINT32             VirtualAddress;
+		const std::string* Data;
+		UINT32             Characteristics;
+	};
+
+	const SectionData Sections[ NumberOfSections ] =
+	{
+		{ ".text",  TextVA,  &Code,      IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ },
+		{ ".data",  DataVA,  &ReadWrite, IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE },
+		{ ".rdata", RDataVA, &ReadOnly,  IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ },
+	};
+
+	std::string Headers( SizeOfHeaders, '\0' );
+
+	IMAGE_DOS_HEADER DosHeader = {};
+
+	DosHeader.e_magic  = IMAGE_DOS_SIGNATURE;
+	DosHeader.e_lfanew = NtOffset;
+
+	Poke( Headers, 0, DosHeader );
+	Poke< UINT32 >( Headers, NtOffset, IMAGE_NT_SIGNATURE );
+
+	IMAGE_FILE_HEADER FileHeader = {};
+
+	FileHeader.Machine              = this->Spec.Machine;
+	FileHeader.NumberOfSections     = NumberOfSections;
+	FileHeader.TimeDateStamp        = this->Spec.Seed;
+	FileHeader.SizeOfOptionalHeader = (UINT16)OptionalSize;
+	FileHeader.Characteristics      = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+
+	Poke( Headers, NtOffset + sizeof( UINT32 ), FileHeader );
+
+	/* Both layouts share every field written here apart from where they sit */
+	auto WriteOptional = [ & ]( auto OptionalHeader, UINT16 Magic, UINT64 ImageBase )
+	{
+		OptionalHeader.Magic                                         = Magic;
+		OptionalHeader.ImageBase                                     = (decltype( OptionalHeader.ImageBase ))ImageBase;
+		OptionalHeader.SectionAlignment                              = SectionAlignment;
+		OptionalHeader.FileAlignment                                 = FileAlignment;
+		OptionalHeader.MajorOperatingSystemVersion                   = 6;
+		OptionalHeader.MajorSubsystemVersion                         = 6;
+		OptionalHeader.SizeOfImage                                   = SizeOfImage;
+		OptionalHeader.SizeOfHeaders                                 = SizeOfHeaders;
+		OptionalHeader.Subsystem                                     = 2;
+		OptionalHeader.NumberOfRvaAndSizes                           = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+		OptionalHeader.DataDirectory[ IMAGE_DIRECTORY_ENTRY_EXPORT ] = { RDataVA, ExportSize };
+
+		Poke( Headers, OptionalOffset, OptionalHeader );
+	};
+
+	if ( IsAMD64 )
+		WriteOptional( IMAGE_OPTIONAL_HEADER64{}, IMAGE_NT_OPTIONAL_HDR64_MAGIC, 0x180000000ULL );
+	else
+		WriteOptional( IMAGE_OPTIONAL_HEADER32{}, IMAGE_NT_OPTIONAL_HDR32_MAGIC, 0x10000000ULL );
+
+	UINT32 PointerToRawData = SizeOfHeaders;
+
+	for ( UINT32 Index = 0; Index < NumberOfSections; Index++ )
+	{
+		IMAGE_SECTION_HEADER Section = {};
+
+		memcpy( Section.Name, Sections[ Index ].Name, strlen( Sections[ Index ].Name ) );
+
+		Section.Misc.VirtualSize = (UINT32)Sections[ Index ].Data->size();
+		Section.VirtualAddress   = Sections[ Index ].VirtualAddress;
+		Section.SizeOfRawData    = AlignUp( (UINT32)Sections[ Index ].Data->size(), FileAlignment );
+		Section.PointerToRawData = PointerToRawData;
+		Section.Characteristics  = Sections[ Index ].Characteristics;
+
+		Poke( Headers, SectionOffset + Index * sizeof( IMAGE_SECTION_HEADER ), Section );
+
+		PointerToRawData += Section.SizeOfRawData;
+	}
+
+	const SIZE_T ImageStart = Image.size();
+
+	Image.append( Headers );
+
+	for ( const auto& Section : Sections )
+	{
+		Image.append( *Section.Data );
+		Image.resize( AlignUp( (UINT32)( Image.size() - ImageStart ), FileAlignment ) + ImageStart, '\0' );
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+
+/*
+	What a synthetic DLL should export. Percentages are per export, a gap
+	leaves an unused ordinal in front of the export it was rolled for.
+*/
+struct FixtureSpec
+{
+	UINT16 Machine;
+	UINT32 NumberOfExports;
+	UINT32 OrdinalBase;
+	UINT32 NoNamePercent;
+	UINT32 DataPercent;
+	UINT32 ForwardedPercent;
+	UINT32 GapPercent;
+	UINT32 MinNameLength;
+	UINT32 MaxNameLength;
+	UINT32 Seed;
+};
+
+/*
+	Builds export heavy DLL images for the benchmark and the tests. Every
+	roll comes from a seeded mt19937 so one spec gives the
+	same bytes on every platform and run.
+
+	Code exports point at a ret each in .text, data exports at their own
+	slot in .data and forwarder strings sit inside the export directory
+	like the linker puts them.
+*/
+class FixtureBuilder
+{
+public:
+	struct Export
+	{
+		UINT32      Ordinal;
+		UINT32      OrdinalIndex;
+		std::string Name;
+		std::string Forwarder;
+		bool        IsData;
+	};
+
+	/* Ordinals are 16 bit, the last one is OrdinalBase + NumberOfFunctions - 1 */
+	static constexpr UINT32 MaxOrdinal = 0xFFFF;
+
+	/* Ordinal slots, gaps included, that fit above OrdinalBase */
+	static UINT32 GetMaxNumberOfFunctions(
+		_In_ UINT32 OrdinalBase
+	)
+	{
+		return OrdinalBase > MaxOrdinal ? 0 : MaxOrdinal - OrdinalBase + 1;
+	}
+
+	/* 10% NONAME, 5% data, 5% forwarded, 2% gaps and 8 to 32 character names */
+	static FixtureSpec GetDefaultSpec(
+		_In_ UINT16 Machine,
+		_In_ UINT32 NumberOfExports
+	);
+
+	FixtureBuilder(
+		_In_ const FixtureSpec& Spec
+	);
+
+	/* Exports as the parser should report them, in ordinal order */
+	const std::vector< Export >& GetExports() const
+	{
+		return this->Exports;
+	}
+
+	/* Ordinal slots including gaps, what NumberOfFunctions is set to */
+	UINT32 GetNumberOfFunctions() const
+	{
+		return this->NumberOfFunctions;
+	}
+
+	/* Appends the finished image to Image */
+	bool Build(
+		_Inout_ std::string& Image
+	) const;
+
+private:
+	FixtureSpec           Spec;
+	std::vector< Export > Exports;
+	UINT32                NumberOfFunctions;
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "Platform.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <lyra/lyra.hpp>
+
+#include "FixtureBuilder.h"
+
+/* Export counts of the --suite set, the top one close to the 16 bit ordinal limit */
+static const UINT32 SuiteSizes[] = { 1000, 5000, 10000, 25000, 50000, 65000 };
+
+bool WriteFixture(
+	_In_ const FixtureSpec&           Spec,
+	_In_ const std::filesystem::path& Path
+)
+{
+	FixtureBuilder Builder( Spec );
+	std::string    Image;
+
+	if ( !Builder.Build( Image ) )
+		return false;
+
+	std::ofstream Stream( Path, std::ios::out | std::ios::trunc | std::ios::binary );
+
+	Stream.write( Image.data(), Image.size() );
+	Stream.close();
+
+	if ( Stream.fail() )
+	{
+		printf( "Failed to write %s\n", Path.string().c_str() );
+		return false;
+	}
+
+	printf( "%s: %u exports over %u ordinals, %zu bytes\n", Path.string().c_str(), (UINT32)Builder.GetExports().size(), Builder.GetNumberOfFunctions(), Image.size() );
+
+	return true;
+}
+
+/* x86 and x64 fixtures of every suite size named fixture_<machine>_<exports>.dll */
+int WriteSuite(
+	_In_ const FixtureSpec&           Spec,
+	_In_ const std::filesystem::path& OutDir
+)
+{
+	std::error_code Error;
+
+	std::filesystem::create_directories( OutDir, Error );
+
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		for ( const auto NumberOfExports : SuiteSizes )
+		{
+			auto SuiteSpec = Spec;
+
+			SuiteSpec.Machine         = Machine;
+			SuiteSpec.NumberOfExports = NumberOfExports;
+
+			const auto Name = "fixture_" + std::string( Machine == IMAGE_FILE_MACHINE_AMD64 ? "x64" : "x86" ) + "_" + std::to_string( NumberOfExports ) + ".dll";
+
+			if ( !WriteFixture( SuiteSpec, OutDir / Name ) )
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, const char* argv[])
+{
+	auto        Spec         = FixtureBuilder::GetDefaultSpec( IMAGE_FILE_MACHINE_AMD64, 1000 );
+	std::string Machine      = "x64";
+	std::string OutPath;
+	bool        Suite        = false;
+	bool        ShowHelp     = false;
+
+	auto CommandLineParser = lyra::cli();
+
+	CommandLineParser.add_argument( lyra::help( ShowHelp ) );
+	CommandLineParser.add_argument( lyra::opt ( Machine,               "MACHINE" ) [ "-m" ] [ "--machine" ]   ( "x86 for a PE32 image or x64 for PE32+, defaults to x64" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.NumberOfExports,  "N" )       [ "-e" ] [ "--exports" ]   ( "Number of exports, at most 65536 minus the ordinal base" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.OrdinalBase,      "N" )       [ "--base" ]               ( "Ordinal base" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.NoNamePercent,    "PERCENT" ) [ "--noname" ]             ( "Share of exports only reachable by ordinal" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.DataPercent,      "PERCENT" ) [ "--data" ]               ( "Share of exports pointing into .data" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.ForwardedPercent, "PERCENT" ) [ "--forwarded" ]          ( "Share of exports forwarded to FIXTURE_TARGET" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.GapPercent,       "PERCENT" ) [ "--gaps" ]               ( "Chance of an unused ordinal before each export" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.MinNameLength,    "N" )       [ "--min-name" ]           ( "Shortest export name" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.MaxNameLength,    "N" )       [ "--max-name" ]           ( "Longest export name" ) );
+	CommandLineParser.add_argument( lyra::opt ( Spec.Seed,             "SEED" )    [ "-s" ] [ "--seed" ]      ( "Seed for every roll, the same seed gives the same image" ) );
+	CommandLineParser.add_argument( lyra::opt ( Suite )                            [ "--suite" ]              ( "Write x86 and x64 fixtures of 1000 to 65000 exports into OUTPUT as a directory" ) );
+	CommandLineParser.add_argument( lyra::arg ( OutPath,               "OUTPUT" )                             ( "DLL to write, or the directory for --suite" ).required() );
+
+	auto ParsedArgs = CommandLineParser.parse( { argc, argv } );
+
+	if ( !ParsedArgs )
+	{
+		std::cerr << ParsedArgs.errorMessage() << std::endl;
+		return 1;
+	}
+
+	if ( ShowHelp )
+	{
+		std::cout << CommandLineParser << std::endl;
+		return 0;
+	}
+
+	if ( Machine == "x86" )
+	{
+		Spec.Machine = IMAGE_FILE_MACHINE_I386;
+	}
+	else if ( Machine == "x64" )
+	{
+		Spec.Machine = IMAGE_FILE_MACHINE_AMD64;
+	}
+	else
+	{
+		printf( "Machine must be x86 or x64\n" );
+		return 1;
+	}
+
+	if ( Spec.MinNameLength > Spec.MaxNameLength )
+	{
+		printf( "--min-name is longer than --max-name\n" );
+		return 1;
+	}
+
+	if ( Suite )
+		return WriteSuite( Spec, OutPath );
+
+	return WriteFixture( Spec, OutPath ) ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,843 @@
+#include "Platform.h"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "PEImage.h"
+#include "ExportEntry.h"
+#include "ExportDiff.h"
+#include "ExportIndex.h"
+#include "RunStats.h"
+#include "FixtureBuilder.h"
+
+/*
+	Reader tests over small DLL images built here. Malformed cases patch one
+	header field of a good image, every case is copied into an allocation of
+	exactly its size so running under AddressSanitizer catches any read past
+	the end.
+*/
+static UINT32 NumberOfChecks   = 0;
+static UINT32 NumberOfFailures = 0;
+
+void Check(
+	_In_ bool        Condition,
+	_In_ const char* Description
+)
+{
+	NumberOfChecks++;
+
+	if ( Condition )
+		return;
+
+	NumberOfFailures++;
+	printf( "FAILED: %s\n", Description );
+}
+
+template < typename T >
+void Poke(
+	_Inout_ std::string& Image,
+	_In_    SIZE_T       Offset,
+	_In_    T            Value
+)
+{
+	memcpy( &Image[ Offset ], &Value, sizeof( Value ) );
+}
+
+/* Layout of the images BuildImage writes */
+const UINT32 NtOffset        = 0x40;
+const UINT32 SizeOfHeaders   = 0x400;
+const UINT32 FileAlignment   = 0x200;
+const UINT32 ExportSectionVA = 0x1000;
+
+std::string GetExportName(
+	_In_ UINT32 Index
+)
+{
+	return "Export" + std::to_string( Index );
+}
+
+/*
+	A DLL with one .rdata section holding an export directory of
+	NumberOfExports named functions, ordinal base 1.
+*/
+std::string BuildImage(
+	_In_ UINT16 Machine,
+	_In_ UINT32 NumberOfExports
+)
+{
+	const bool   IsAMD64          = Machine == IMAGE_FILE_MACHINE_AMD64;
+	const SIZE_T OptionalSize     = IsAMD64 ? sizeof( IMAGE_OPTIONAL_HEADER64 ) : sizeof( IMAGE_OPTIONAL_HEADER32 );
+	const SIZE_T OptionalOffset   = NtOffset + sizeof( UINT32 ) + sizeof( IMAGE_FILE_HEADER );
+	const SIZE_T SectionOffset    = OptionalOffset + OptionalSize;
+	const UINT32 FunctionsOffset  = sizeof( IMAGE_EXPORT_DIRECTORY );
+	const UINT32 NamesOffset      = FunctionsOffset + NumberOfExports * sizeof( UINT32 );
+	const UINT32 OrdinalsOffset   = NamesOffset + NumberOfExports * sizeof( UINT32 );
+	const UINT32 StringsOffset    = OrdinalsOffset + NumberOfExports * sizeof( UINT16 );
+
+	/* Export directory, tables and strings, as laid out in the section */
+	std::string Section( StringsOffset, '\0' );
+
+	IMAGE_EXPORT_DIRECTORY Directory = {};
+
+	Directory.Name                  = ExportSectionVA + (UINT32)Section.size();
+	Directory.Base                  = 1;
+	Directory.NumberOfFunctions     = NumberOfExports;
+	Directory.NumberOfNames         = NumberOfExports;
+	Directory.AddressOfFunctions    = ExportSectionVA + FunctionsOffset;
+	Directory.AddressOfNames        = ExportSectionVA + NamesOffset;
+	Directory.AddressOfNameOrdinals = ExportSectionVA + OrdinalsOffset;
+
+	Section.append( "TEST.dll", sizeof( "TEST.dll" ) );
+	Poke( Section, 0, Directory );
+
+	for ( UINT32 Index = 0; Index < NumberOfExports; Index++ )
+	{
+		Poke< UINT32 >( Section, FunctionsOffset + Index * sizeof( UINT32 ), 0x2000 + Index * 16 );
+		Poke< UINT32 >( Section, NamesOffset + Index * sizeof( UINT32 ), ExportSectionVA + (UINT32)Section.size() );
+		Poke< UINT16 >( Section, OrdinalsOffset + Index * sizeof( UINT16 ), (UINT16)Index );
+
+		const auto Name = GetExportName( Index );
+
+		Section.append( Name.c_str(), Name.size() + 1 );
+	}
+
+	const auto ExportSize  = (UINT32)Section.size();
+	const auto SizeOfRaw   = ( ExportSize + FileAlignment - 1 ) & ~( FileAlignment - 1 );
+	std::string Image( SizeOfHeaders + SizeOfRaw, '\0' );
+
+	IMAGE_DOS_HEADER DosHeader = {};
+
+	DosHeader.e_magic  = IMAGE_DOS_SIGNATURE;
+	DosHeader.e_lfanew = NtOffset;
+
+	Poke( Image, 0, DosHeader );
+	Poke< UINT32 >( Image, NtOffset, IMAGE_NT_SIGNATURE );
+
+	IMAGE_FILE_HEADER FileHeader = {};
+
+	FileHeader.Machine              = Machine;
+	FileHeader.NumberOfSections     = 1;
+	FileHeader.SizeOfOptionalHeader = (UINT16)OptionalSize;
+	FileHeader.Characteristics      = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+
+	Poke( Image, NtOffset + sizeof( UINT32 ), FileHeader );
+
+	/* Both layouts share every field written here apart from where they sit */
+	auto WriteOptional = [ & ]( auto OptionalHeader, UINT16 Magic )
+	{
+		OptionalHeader.Magic                                         = Magic;
+		OptionalHeader.SectionAlignment                              = 0x1000;
+		OptionalHeader.FileAlignment                                 = FileAlignment;
+		OptionalHeader.SizeOfImage                                   = ExportSectionVA + ( ( ExportSize + 0xFFF ) & ~0xFFF );
+		OptionalHeader.SizeOfHeaders                                 = SizeOfHeaders;
+		OptionalHeader.NumberOfRvaAndSizes                           = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+		OptionalHeader.DataDirectory[ IMAGE_DIRECTORY_ENTRY_EXPORT ] = { ExportSectionVA, ExportSize };
+
+		Poke( Image, OptionalOffset, OptionalHeader );
+	};
+
+	if ( IsAMD64 )
+		WriteOptional( IMAGE_OPTIONAL_HEADER64{}, IMAGE_NT_OPTIONAL_HDR64_MAGIC );
+	else
+		WriteOptional( IMAGE_OPTIONAL_HEADER32{}, IMAGE_NT_OPTIONAL_HDR32_MAGIC );
+
+	IMAGE_SECTION_HEADER SectionHeader = {};
+
+	memcpy( SectionHeader.Name, ".rdata", 6 );
+	SectionHeader.Misc.VirtualSize = ExportSize;
+	SectionHeader.VirtualAddress   = ExportSectionVA;
+	SectionHeader.SizeOfRawData    = SizeOfRaw;
+	SectionHeader.PointerToRawData = SizeOfHeaders;
+	SectionHeader.Characteristics  = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ;
+
+	Poke( Image, SectionOffset, SectionHeader );
+
+	Image.replace( SizeOfHeaders, Section.size(), Section );
+
+	return Image;
+}
+
+SIZE_T GetFileHeaderOffset()
+{
+	return NtOffset + sizeof( UINT32 );
+}
+
+SIZE_T GetOptionalOffset()
+{
+	return GetFileHeaderOffset() + sizeof( IMAGE_FILE_HEADER );
+}
+
+SIZE_T GetSectionOffset(
+	_In_ UINT16 Machine
+)
+{
+	return GetOptionalOffset() + ( Machine == IMAGE_FILE_MACHINE_AMD64 ? sizeof( IMAGE_OPTIONAL_HEADER64 ) : sizeof( IMAGE_OPTIONAL_HEADER32 ) );
+}
+
+SIZE_T GetDirectoryOffset(
+	_In_ UINT16 Machine
+)
+{
+	return Machine == IMAGE_FILE_MACHINE_AMD64 ? offsetof( IMAGE_OPTIONAL_HEADER64, DataDirectory ) : offsetof( IMAGE_OPTIONAL_HEADER32, DataDirectory );
+}
+
+/* Reads every export name through the reader, false as soon as anything is out of bounds */
+bool ReadExportNames(
+	_In_  const PEImage&              Image,
+	_Out_ std::vector< std::string >& Names
+)
+{
+	Names.clear();
+
+	const auto Entry = Image.GetDataDirectory( IMAGE_DIRECTORY_ENTRY_EXPORT );
+
+	if ( Entry == NULL )
+		return false;
+
+	const auto Directory = Image.RvaToPointer< IMAGE_EXPORT_DIRECTORY >( Entry->VirtualAddress );
+
+	if ( Directory == NULL )
+		return false;
+
+	const auto Functions = Image.RvaToPointer< UINT32 >( Directory->AddressOfFunctions, Directory->NumberOfFunctions );
+	const auto NameRVAs  = Image.RvaToPointer< UINT32 >( Directory->AddressOfNames, Directory->NumberOfNames );
+	const auto Ordinals  = Image.RvaToPointer< UINT16 >( Directory->AddressOfNameOrdinals, Directory->NumberOfNames );
+
+	if ( Functions == NULL || NameRVAs == NULL || Ordinals == NULL || Image.RvaToString( Directory->Name ) == NULL )
+		return false;
+
+	for ( UINT32 Index = 0; Index < Directory->NumberOfNames; Index++ )
+	{
+		const auto Name = Image.RvaToString( NameRVAs[ Index ] );
+
+		if ( Name == NULL || Ordinals[ Index ] >= Directory->NumberOfFunctions )
+			return false;
+
+		Names.push_back( Name );
+	}
+
+	return true;
+}
+
+/* Opens a heap copy of the first Size bytes, true if the headers, the export names and the export walk all read */
+bool ParseCopy(
+	_In_ const std::string& Image,
+	_In_ SIZE_T             Size,
+	_In_ bool*              HeadersValid = NULL
+)
+{
+	std::vector< UINT8 >       Copy( Image.begin(), Image.begin() + Size );
+	std::vector< std::string > Names;
+	PEImage                    Parsed;
+	ExportTable                Entries;
+
+	const bool Opened = Parsed.Open( Copy.data(), Copy.size() );
+
+	if ( HeadersValid != NULL )
+		*HeadersValid = Opened;
+
+	return Opened && ReadExportNames( Parsed, Names ) && ExportEntry::GetExportEntries( Parsed, Entries, false, NULL );
+}
+
+/* Applies Patch to a copy of Image and parses it */
+bool ParsePatched(
+	_In_ const std::string&                    Image,
+	_In_ std::function< void( std::string& ) > Patch,
+	_In_ bool*                                 HeadersValid = NULL
+)
+{
+	auto Patched = Image;
+
+	Patch( Patched );
+
+	return ParseCopy( Patched, Patched.size(), HeadersValid );
+}
+
+void TestRoundTrips()
+{
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		for ( const UINT32 NumberOfExports : { 0u, 1u, 500u } )
+		{
+			const auto                 Image = BuildImage( Machine, NumberOfExports );
+			PEImage                    Parsed;
+			std::vector< std::string > Names;
+
+			Check( Parsed.Open( Image.data(), Image.size() ), "built image opens" );
+			Check( Parsed.GetMachine() == Machine, "machine type round trips" );
+			Check( Parsed.IsDLL(), "DLL flag round trips" );
+			Check( Parsed.GetSections().size() == 1 && Parsed.GetSections()[ 0 ].VirtualAddress == ExportSectionVA, "section table round trips" );
+			Check( ReadExportNames( Parsed, Names ) && Names.size() == NumberOfExports, "export names read" );
+
+			bool Matches = Names.size() == NumberOfExports;
+
+			for ( UINT32 Index = 0; Matches && Index < NumberOfExports; Index++ )
+				Matches = Names[ Index ] == GetExportName( Index );
+
+			Check( Matches, "export names round trip" );
+
+			/* Headers are addressable by RVA, the zero fill past the raw data is not */
+			Check( Parsed.RvaToPointer< IMAGE_DOS_HEADER >( 0 ) == (const void*)Image.data(), "RVA 0 maps to the headers" );
+			Check( Parsed.RvaToPointer( SizeOfHeaders - 1, 2 ) == NULL, "read crossing the end of the headers is rejected" );
+			Check( Parsed.RvaToPointer( ExportSectionVA + Parsed.GetSections()[ 0 ].SizeOfRawData, 1 ) == NULL, "RVA past the raw data is rejected" );
+			Check( Parsed.RvaToPointer< UINT32 >( ExportSectionVA, SIZE_MAX / 2 ) == NULL, "count overflowing the byte size is rejected" );
+		}
+	}
+}
+
+/* Builds Spec with FixtureBuilder and checks the export walk reports exactly what it generated */
+void TestFixtureRoundTrip(
+	_In_ const FixtureSpec& Spec,
+	_In_ const char*        Description
+)
+{
+	FixtureBuilder Builder( Spec );
+	std::string    Image;
+	PEImage        Parsed;
+	ExportTable    Entries;
+	UINT16         MachineType = 0;
+
+	Check( Builder.Build( Image ), Description );
+	Check( Parsed.Open( Image.data(), Image.size() ), Description );
+	Check( ExportEntry::GetExportEntries( Parsed, Entries, false, &MachineType ), Description );
+	Check( MachineType == Spec.Machine, Description );
+
+	const auto& Expected = Builder.GetExports();
+
+	bool Matches = Entries.size() == Expected.size();
+
+	for ( SIZE_T Index = 0; Matches && Index < Expected.size(); Index++ )
+	{
+		const auto  Export = Entries[ Index ];
+		const auto& Want   = Expected[ Index ];
+
+		Matches = Export.GetOrdinal() == Want.Ordinal &&
+			Export.GetOrdinalIndex() == Want.OrdinalIndex &&
+			Export.GetName() == Want.Name &&
+			Export.GetForwardedName() == Want.Forwarder &&
+			Export.IsForwarded() == ( Want.Forwarder.size() != 0 ) &&
+			Export.IsData() == Want.IsData;
+	}
+
+	Check( Matches, Description );
+}
+
+void TestFixtureRoundTrips()
+{
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		auto Spec = FixtureBuilder::GetDefaultSpec( Machine, 2000 );
+
+		TestFixtureRoundTrip( Spec, "default fixture mix round trips" );
+
+		Spec.NoNamePercent    = 100;
+		Spec.ForwardedPercent = 0;
+		TestFixtureRoundTrip( Spec, "NONAME only fixture round trips" );
+
+		Spec = FixtureBuilder::GetDefaultSpec( Machine, 500 );
+		Spec.GapPercent       = 60;
+		Spec.DataPercent      = 40;
+		Spec.ForwardedPercent = 30;
+		Spec.OrdinalBase      = 100;
+		TestFixtureRoundTrip( Spec, "gaps, data and forwarders with ordinal base 100 round trip" );
+
+		/* Ordinal base 1 leaves room for ordinals 1 to 65535, gaps have to give way near the top */
+		Spec = FixtureBuilder::GetDefaultSpec( Machine, FixtureBuilder::GetMaxNumberOfFunctions( 1 ) );
+		TestFixtureRoundTrip( Spec, "65535 exports with gaps round trip" );
+
+		Spec = FixtureBuilder::GetDefaultSpec( Machine, FixtureBuilder::GetMaxNumberOfFunctions( 0 ) );
+		Spec.OrdinalBase = 0;
+		TestFixtureRoundTrip( Spec, "65536 exports from ordinal 0 round trip" );
+
+		TestFixtureRoundTrip( FixtureBuilder::GetDefaultSpec( Machine, 0 ), "empty export directory round trips" );
+
+		Spec = FixtureBuilder::GetDefaultSpec( Machine, FixtureBuilder::GetMaxNumberOfFunctions( 100 ) + 1 );
+		Spec.OrdinalBase = 100;
+
+		std::string Image;
+
+		Check( !FixtureBuilder( Spec ).Build( Image ), "exports past ordinal 65535 are refused" );
+
+		bool LastOrdinalFits = true;
+
+		Spec = FixtureBuilder::GetDefaultSpec( Machine, FixtureBuilder::GetMaxNumberOfFunctions( 100 ) );
+		Spec.OrdinalBase = 100;
+		Spec.GapPercent  = 50;
+
+		const FixtureBuilder Gaps( Spec );
+
+		for ( const auto& Export : Gaps.GetExports() )
+			LastOrdinalFits = LastOrdinalFits && Export.Ordinal <= FixtureBuilder::MaxOrdinal;
+
+		Check( LastOrdinalFits, "gaps never push an ordinal past 65535" );
+	}
+}
+
+/* Every prefix shorter than the headers must fail cleanly, none may read past the end */
+void TestTruncated()
+{
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		const auto Image         = BuildImage( Machine, 200 );
+		const auto SectionOffset = GetSectionOffset( Machine );
+
+		bool HeadersRejected = true;
+
+		for ( SIZE_T Size = 0; Size < SectionOffset; Size++ )
+		{
+			bool HeadersValid = false;
+
+			ParseCopy( Image, Size, &HeadersValid );
+			HeadersRejected = HeadersRejected && !HeadersValid;
+		}
+
+		Check( HeadersRejected, "images cut inside the optional header are rejected" );
+
+		/* Past the headers the parse may fail or not, it just has to stay in bounds */
+		for ( SIZE_T Size = SectionOffset; Size < Image.size(); Size += 7 )
+			ParseCopy( Image, Size );
+
+		Check( ParseCopy( Image, 154 ) == false, "154 byte truncated image is rejected" );
+		Check( ParseCopy( Image, Image.size() ), "untruncated image parses" );
+	}
+}
+
+void TestMalformedHeaders()
+{
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		const auto   Image               = BuildImage( Machine, 100 );
+		const auto   FileHeader          = GetFileHeaderOffset();
+		const auto   Optional            = GetOptionalOffset();
+		const SIZE_T DirectoryOffset     = GetDirectoryOffset( Machine );
+		const SIZE_T NumberOfRvaOffset   = Machine == IMAGE_FILE_MACHINE_AMD64 ? offsetof( IMAGE_OPTIONAL_HEADER64, NumberOfRvaAndSizes ) : offsetof( IMAGE_OPTIONAL_HEADER32, NumberOfRvaAndSizes );
+		const SIZE_T SizeOfOptionalField = FileHeader + offsetof( IMAGE_FILE_HEADER, SizeOfOptionalHeader );
+		bool         HeadersValid        = true;
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, 0, 0 ); }, &HeadersValid );
+		Check( !HeadersValid, "bad DOS signature is rejected" );
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< INT32 >( Patched, offsetof( IMAGE_DOS_HEADER, e_lfanew ), -4 ); }, &HeadersValid );
+		Check( !HeadersValid, "negative e_lfanew is rejected" );
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< INT32 >( Patched, offsetof( IMAGE_DOS_HEADER, e_lfanew ), (INT32)Patched.size() - 8 ); }, &HeadersValid );
+		Check( !HeadersValid, "e_lfanew at the end of the file is rejected" );
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, NtOffset, 0 ); }, &HeadersValid );
+		Check( !HeadersValid, "bad NT signature is rejected" );
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, Optional, 0x1234 ); }, &HeadersValid );
+		Check( !HeadersValid, "unknown optional header magic is rejected" );
+
+		for ( const SIZE_T SizeOfOptionalHeader : { (SIZE_T)0, (SIZE_T)1, (SIZE_T)2, DirectoryOffset - 1 } )
+		{
+			ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, SizeOfOptionalField, (UINT16)SizeOfOptionalHeader ); }, &HeadersValid );
+			Check( !HeadersValid, "optional header smaller than its fixed fields is rejected" );
+		}
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, SizeOfOptionalField, 0xFFFF ); }, &HeadersValid );
+		Check( !HeadersValid, "optional header larger than the file is rejected" );
+
+		/* Headers only, SizeOfOptionalHeader says the optional header runs past the end */
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Patched.resize( Optional + DirectoryOffset ); }, &HeadersValid );
+		Check( !HeadersValid, "file ending before the data directories is rejected" );
+
+		Check( ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Optional + NumberOfRvaOffset, 0xFFFFFFFF ); } ), "NumberOfRvaAndSizes past 16 is clamped" );
+
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Optional + NumberOfRvaOffset, 0 ); }, &HeadersValid ) && HeadersValid, "no data directories means no exports" );
+
+		/* Directories only count as far as the optional header reaches, even with NumberOfRvaAndSizes saying more */
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, SizeOfOptionalField, (UINT16)DirectoryOffset ); }, &HeadersValid ), "optional header without room for directories has no exports" );
+
+		ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT16 >( Patched, FileHeader + offsetof( IMAGE_FILE_HEADER, NumberOfSections ), 0xFFFF ); }, &HeadersValid );
+		Check( !HeadersValid, "section table past the end is rejected" );
+	}
+}
+
+void TestMalformedExports()
+{
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		const auto   Image     = BuildImage( Machine, 100 );
+		const SIZE_T ExportRVA = GetOptionalOffset() + GetDirectoryOffset( Machine );
+		const SIZE_T Directory = SizeOfHeaders;
+
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, ExportRVA, 0x7FFFFFF0 ); } ), "export directory outside every section is rejected" );
+
+		/* The walk may reject the image, but the directory size is reserved for strings before it gets that far */
+		{
+			auto        Patched = Image;
+			PEImage     Parsed;
+			ExportTable Entries;
+
+			Poke< UINT32 >( Patched, ExportRVA + sizeof( UINT32 ), 0xF0000000 );
+
+			Check( Parsed.Open( Patched.data(), Patched.size() ), "huge export directory size opens" );
+
+			ExportEntry::GetExportEntries( Parsed, Entries, false, NULL );
+
+			Check( Entries.GetMemoryUsage() < 2 * Patched.size(), "huge export directory size is not reserved" );
+		}
+
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Directory + offsetof( IMAGE_EXPORT_DIRECTORY, NumberOfFunctions ), 0x40000001 ); } ), "function count past the end is rejected" );
+
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Directory + offsetof( IMAGE_EXPORT_DIRECTORY, NumberOfNames ), 0xFFFFFFFF ); } ), "name count past the end is rejected" );
+
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Directory + offsetof( IMAGE_EXPORT_DIRECTORY, AddressOfNames ), 0x7FFFFFF0 ); } ), "name table outside every section is rejected" );
+
+		/* The last name ends the export data, cutting the file before its terminator leaves it unterminated */
+		Check( !ParsePatched( Image, [ & ]( std::string& Patched )
+		{
+			const auto Name = GetExportName( 99 );
+			const auto End  = Patched.rfind( Name ) + Name.size();
+
+			Poke< UINT32 >( Patched, GetSectionOffset( Machine ) + offsetof( IMAGE_SECTION_HEADER, SizeOfRawData ), (UINT32)( End - SizeOfHeaders ) );
+			Patched.resize( End );
+		} ), "name running off the end of the file is rejected" );
+	}
+}
+
+bool WriteFile(
+	_In_ const std::filesystem::path& Path,
+	_In_ const std::string&           Contents
+)
+{
+	std::ofstream Stream( Path, std::ios::out | std::ios::trunc | std::ios::binary );
+
+	Stream.write( Contents.data(), Contents.size() );
+	Stream.close();
+
+	return !Stream.fail();
+}
+
+std::string ReadFile(
+	_In_ const std::filesystem::path& Path
+)
+{
+	std::ifstream Stream( Path, std::ios::in | std::ios::binary );
+
+	return std::string( ( std::istreambuf_iterator< char >( Stream ) ), std::istreambuf_iterator< char >() );
+}
+
+/* True if the image record at ImageIndex holds exactly the exports of Table */
+bool IndexMatches(
+	_In_ const ExportIndex& Index,
+	_In_ UINT32             ImageIndex,
+	_In_ const ExportTable& Table
+)
+{
+	const auto& Indexed = Index.GetImage( ImageIndex );
+
+	if ( Indexed.NumberOfExports != Table.size() || Indexed.OrdinalBase != Table.GetOrdinalBase() || Indexed.Machine != Table.GetMachine() )
+		return false;
+
+	for ( UINT32 Row = 0; Row < Indexed.NumberOfExports; Row++ )
+	{
+		const auto& Entry  = Index.GetExport( Indexed.FirstExport + Row );
+		const auto  Export = Table[ Row ];
+
+		if ( Entry.Ordinal != Export.GetOrdinal() ||
+			 Index.GetName( Entry ) != Export.GetName() ||
+			 Index.GetString( Entry.ForwarderOffset ) != Export.GetForwardedName() ||
+			 ( ( Entry.Flags & ExportIndex::ExportFlagData ) != 0 ) != Export.IsData() )
+			return false;
+	}
+
+	return true;
+}
+
+/*
+	Builds an index over fixture DLLs written to a temporary directory, reads
+	it back, rebuilds it and then opens damaged copies of it. Damaged copies
+	have to be refused by Open or read as empty, never index out of bounds.
+*/
+void TestExportIndex()
+{
+	const auto      Directory = std::filesystem::temp_directory_path() / ( "DLLProxyTests" + std::to_string( RunStats::Now() ) );
+	const auto      IndexPath = Directory / "Exports.index";
+	std::error_code Error;
+
+	std::filesystem::create_directories( Directory, Error );
+
+	std::vector< std::filesystem::path > DLLPaths;
+	std::vector< ExportTable >           Tables;
+
+	for ( const UINT16 Machine : { IMAGE_FILE_MACHINE_I386, IMAGE_FILE_MACHINE_AMD64 } )
+	{
+		std::string Image;
+
+		Tables.emplace_back();
+		DLLPaths.push_back( Directory / ( "Fixture" + std::to_string( Machine ) + ".dll" ) );
+
+		Check( FixtureBuilder( FixtureBuilder::GetDefaultSpec( Machine, 300 ) ).Build( Image ), "index fixture builds" );
+		Check( WriteFile( DLLPaths.back(), Image ), "index fixture is written" );
+		Check( ExportEntry::GetExportEntries( Image.data(), Image.size(), Tables.back(), false, NULL ), "index fixture parses" );
+	}
+
+	/* Kept as a failed image so it isnt parsed again until it changes */
+	DLLPaths.push_back( Directory / "NotADLL.dll" );
+	Check( WriteFile( DLLPaths.back(), "not a DLL" ), "unreadable DLL is written" );
+
+	ExportIndex::BuildStats Stats;
+
+	Check( ExportIndex::Build( IndexPath, DLLPaths, 2, &Stats ) && Stats.Parsed == 3 && Stats.Reused == 0 && Stats.Failed == 1, "index builds" );
+
+	/* Closed before every rebuild, Windows cant replace a mapped file */
+	for ( const char* Pass : { "built", "rebuilt" } )
+	{
+		ExportIndex Index;
+
+		Check( Index.Open( IndexPath ) && Index.GetNumberOfImages() == 3, Pass );
+
+		if ( !Index.IsOpen() )
+			break;
+
+		Check( IndexMatches( Index, 0, Tables[ 0 ] ) && IndexMatches( Index, 1, Tables[ 1 ] ), "indexed exports round trip" );
+		Check( ( Index.GetImage( 2 ).Flags & ExportIndex::ImageFlagFailed ) != 0 && Index.GetImage( 2 ).NumberOfExports == 0, "unreadable DLL is indexed as failed" );
+
+		/* Both fixtures share their generated names, every posting has to lead back to the name it is filed under */
+		bool PostingsMatch = true;
+
+		for ( const auto Export : Tables[ 0 ] )
+		{
+			if ( !Export.HasName() )
+				continue;
+
+			const auto Name     = Index.FindName( Export.GetName() );
+			const auto Postings = Name != NULL ? Index.GetPostings( *Name ) : std::make_pair( (const ExportIndex::Posting*)NULL, 0u );
+
+			PostingsMatch = PostingsMatch && Postings.second != 0;
+
+			for ( UINT32 PostingIndex = 0; PostingsMatch && PostingIndex < Postings.second; PostingIndex++ )
+				PostingsMatch = Index.GetName( Index.GetExport( Postings.first[ PostingIndex ].ExportIndex ) ) == Export.GetName();
+		}
+
+		Check( PostingsMatch, "every indexed name finds its exports" );
+		Check( Index.FindName( "NotExportedAnywhere" ) == NULL, "unknown name is not found" );
+
+		Index.Close();
+
+		if ( Pass == std::string( "built" ) )
+			Check( ExportIndex::Build( IndexPath, DLLPaths, 2, &Stats ) && Stats.Parsed == 0 && Stats.Reused == 3, "unchanged DLLs are reused on rebuild" );
+	}
+
+	const auto Good = ReadFile( IndexPath );
+
+	ExportIndex::Header Header = {};
+
+	if ( Good.size() >= sizeof( Header ) )
+		memcpy( &Header, Good.data(), sizeof( Header ) );
+
+	ExportIndex::Posting FirstPosting = {};
+	ExportIndex::Image   PostedImage  = {};
+	ExportIndex::Name    FirstName    = {};
+	std::string          FirstText;
+
+	if ( Header.NumberOfPostings != 0 && Header.NumberOfNames != 0 )
+	{
+		memcpy( &FirstPosting, Good.data() + Header.PostingsOffset, sizeof( FirstPosting ) );
+		memcpy( &PostedImage, Good.data() + Header.ImagesOffset + FirstPosting.ImageIndex * sizeof( PostedImage ), sizeof( PostedImage ) );
+		memcpy( &FirstName, Good.data() + Header.NamesOffset, sizeof( FirstName ) );
+
+		FirstText = Good.data() + Header.StringsOffset + FirstName.StringOffset;
+	}
+
+	/* Writes a patched copy of the index and opens it, Index is left open for the caller to read */
+	const auto OpenPatched = [ & ]( ExportIndex& Index, std::function< void( std::string& ) > Patch )
+	{
+		const auto Path    = Directory / "Damaged.index";
+		auto       Patched = Good;
+
+		Index.Close();
+		Patch( Patched );
+
+		return WriteFile( Path, Patched ) && Index.Open( Path );
+	};
+
+	ExportIndex Damaged;
+
+	Check( FirstText.size() != 0 && OpenPatched( Damaged, []( std::string& ) {} ), "unpatched copy opens" );
+
+	Check( !OpenPatched( Damaged, []( std::string& Patched ) { Patched.resize( sizeof( ExportIndex::Header ) - 1 ); } ), "truncated header is rejected" );
+
+	Check( !OpenPatched( Damaged, []( std::string& Patched ) { Poke< UINT32 >( Patched, offsetof( ExportIndex::Header, Version ), ExportIndex::Version + 1 ); } ), "other version is rejected" );
+
+	Check( !OpenPatched( Damaged, []( std::string& Patched ) { Poke< UINT32 >( Patched, offsetof( ExportIndex::Header, NumberOfExports ), 0x7FFFFFFF ); } ), "export count past the end is rejected" );
+
+	Check( !OpenPatched( Damaged, [ & ]( std::string& Patched ) { Patched[ Header.StringsOffset + Header.StringsSize - 1 ] = 'x'; } ), "unterminated string pool is rejected" );
+
+	Check( !OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.ImagesOffset + offsetof( ExportIndex::Image, NumberOfExports ), Header.NumberOfExports + 1 ); } ), "image exports past the end are rejected" );
+
+	Check( !OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.PostingsOffset + offsetof( ExportIndex::Posting, ImageIndex ), Header.NumberOfImages ); } ), "posting of a missing image is rejected" );
+
+	Check( !OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.PostingsOffset + offsetof( ExportIndex::Posting, ExportIndex ), PostedImage.FirstExport + PostedImage.NumberOfExports ); } ), "posting past its image's exports is rejected" );
+
+	Check( !OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.PostingsOffset + offsetof( ExportIndex::Posting, ExportIndex ), PostedImage.FirstExport - 1 ); } ), "posting before its image's exports is rejected" );
+
+	/* Offsets read lazily are bounded on every read instead */
+	Check( OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.ExportsOffset + offsetof( ExportIndex::Export, ForwarderOffset ), 0xFFFFFFF0 ); } ) &&
+		   Damaged.GetString( Damaged.GetExport( 0 ).ForwarderOffset ).empty(), "forwarder offset past the strings reads as no forwarder" );
+
+	Check( OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.ExportsOffset + offsetof( ExportIndex::Export, NameId ), Header.NumberOfNames ); } ) &&
+		   Damaged.GetName( Damaged.GetExport( 0 ) ).empty(), "name id past the names reads as no name" );
+
+	Check( OpenPatched( Damaged, [ & ]( std::string& Patched ) { Poke< UINT32 >( Patched, Header.NamesOffset + offsetof( ExportIndex::Name, FirstPosting ), 0xFFFFFFFF ); } ) &&
+		   Damaged.FindName( FirstText ) != NULL && Damaged.GetPostings( *Damaged.FindName( FirstText ) ).second == 0, "postings past the end read as none" );
+
+	Damaged.Close();
+
+	/* A previous index that cant be read is not fatal, everything is parsed again */
+	Check( WriteFile( IndexPath, "damaged" ), "damaged index is written" );
+	Check( ExportIndex::Build( IndexPath, DLLPaths, 2, &Stats ) && Stats.Parsed == 3 && Stats.Reused == 0, "damaged index is rebuilt from scratch" );
+
+	std::filesystem::remove_all( Directory, Error );
+}
+
+/* One export of a diff case, an empty forwarder means code or data at a made up RVA */
+struct DiffRow
+{
+	UINT32      Ordinal;
+	const char* Name;
+	const char* Forwarder;
+	bool        IsData;
+};
+
+struct DiffCase
+{
+	const char*                       Description;
+	std::vector< DiffRow >            Old;
+	std::vector< DiffRow >            New;
+	std::vector< ExportDiff::Change > Expected;
+	SIZE_T                            Unchanged;
+};
+
+/* Rows have to be given in ordinal order, the way the export walk fills a table */
+ExportTable BuildDiffTable(
+	_In_ const std::vector< DiffRow >& Rows
+)
+{
+	ExportTable Table;
+
+	Table.SetOrdinalBase( 1 );
+
+	for ( const auto& Row : Rows )
+		Table.Add( Row.Ordinal - 1, 0x1000 + Row.Ordinal * 16, Row.Name, Row.Forwarder, Row.IsData );
+
+	return Table;
+}
+
+void TestExportDiff()
+{
+	using Diff = ExportDiff;
+
+	const std::vector< DiffCase > Cases =
+	{
+		{ "identical tables have no changes",
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{},
+			2 },
+		{ "new name is added",
+			{ { 1, "A", "", false } },
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{ { Diff::Added, "B", "", 0, 2 } },
+			1 },
+		{ "missing name is removed",
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{ { 1, "A", "", false } },
+			{ { Diff::Removed, "B", "", 2, 0 } },
+			1 },
+		{ "new name on an old ordinal is a rename",
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{ { 1, "A", "", false }, { 2, "C", "", false } },
+			{ { Diff::Renamed, "C", "B", 2, 2 } },
+			1 },
+		{ "swapped ordinals are moves, sorted by new ordinal",
+			{ { 1, "A", "", false }, { 2, "B", "", false } },
+			{ { 1, "B", "", false }, { 2, "A", "", false } },
+			{ { Diff::OrdinalChanged, "B", "", 2, 1 }, { Diff::OrdinalChanged, "A", "", 1, 2 } },
+			0 },
+		{ "NONAME exports pair by ordinal",
+			{ { 1, "", "", false }, { 2, "A", "", false } },
+			{ { 1, "", "", false }, { 2, "A", "", false }, { 3, "", "", false } },
+			{ { Diff::Added, "", "", 0, 3 } },
+			2 },
+		{ "NONAME export that gains a name is a rename",
+			{ { 1, "", "", false } },
+			{ { 1, "A", "", false } },
+			{ { Diff::Renamed, "A", "", 1, 1 } },
+			0 },
+		{ "named export that loses its name is a rename",
+			{ { 1, "A", "", false } },
+			{ { 1, "", "", false } },
+			{ { Diff::Renamed, "", "A", 1, 1 } },
+			0 },
+		{ "removed NONAME export",
+			{ { 1, "A", "", false }, { 2, "", "", false } },
+			{ { 1, "A", "", false } },
+			{ { Diff::Removed, "", "", 2, 0 } },
+			1 },
+		{ "forwarders start, stop and change",
+			{ { 1, "A", "", false }, { 2, "B", "X.B", false }, { 3, "C", "X.C", false }, { 4, "D", "X.D", false } },
+			{ { 1, "A", "Y.A", false }, { 2, "B", "", false }, { 3, "C", "Z.C", false }, { 4, "D", "X.D", false } },
+			{ { Diff::BecameForwarded, "A", "Y.A", 1, 1 }, { Diff::StoppedForwarding, "B", "X.B", 2, 2 }, { Diff::ForwarderChanged, "C", "Z.C", 3, 3 } },
+			1 },
+		{ "code and data swap",
+			{ { 1, "A", "", false }, { 2, "B", "", true } },
+			{ { 1, "A", "", true }, { 2, "B", "", false } },
+			{ { Diff::BecameData, "A", "", 1, 1 }, { Diff::BecameCode, "B", "", 2, 2 } },
+			0 },
+		{ "renamed forwarder also reports its new target",
+			{ { 1, "A", "X.A", false } },
+			{ { 1, "B", "X.B", false } },
+			{ { Diff::Renamed, "B", "A", 1, 1 }, { Diff::ForwarderChanged, "B", "X.B", 1, 1 } },
+			0 },
+	};
+
+	for ( const auto& Case : Cases )
+	{
+		const auto Old = BuildDiffTable( Case.Old );
+		const auto New = BuildDiffTable( Case.New );
+
+		ExportDiff Compared;
+
+		Compared.Compare( Old, New );
+
+		const auto& Changes = Compared.GetChanges();
+
+		bool Matches = Changes.size() == Case.Expected.size() && Compared.GetUnchanged() == Case.Unchanged;
+
+		for ( SIZE_T Index = 0; Matches && Index < Changes.size(); Index++ )
+		{
+			const auto& Got  = Changes[ Index ];
+			const auto& Want = Case.Expected[ Index ];
+
+			Matches = Got.Type == Want.Type &&
+				Got.Name == Want.Name &&
+				Got.Detail == Want.Detail &&
+				Got.OldOrdinal == Want.OldOrdinal &&
+				Got.NewOrdinal == Want.NewOrdinal;
+		}
+
+		Check( Matches, Case.Description );
+	}
+}
+
+int main()
+{
+	TestRoundTrips();
+	TestFixtureRoundTrips();
+	TestTruncated();
+	TestMalformedHeaders();
+	TestMalformedExports();
+	TestExportIndex();
+	TestExportDiff();
+
+	printf( "%u checks, %u failed\n", NumberOfChecks, NumberOfFailures );
+
+	return NumberOfFailures ? 1 : 0;
+}
\ No newline at end of file